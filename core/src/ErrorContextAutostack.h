@@ -52,17 +52,39 @@
 #define __ECA_FUNC__ ""
 #endif
 
+/**
+ * Records the enclosing call-site on the given session's error context stack for the lifetime of the object.
+ * Defined inline, as it is instantiated by every API call.
+ */
 class ErrorContextAutostack
 {
 private:
     FieldmlSession *errorSession;
     
 public:
-    ErrorContextAutostack( FieldmlSession *_errorSession, const char *file, const int line, const char *function );
+    ErrorContextAutostack( FieldmlSession *_errorSession, const char *file, const int line, const char *function ) :
+        errorSession( _errorSession )
+    {
+        if( errorSession != NULL )
+        {
+            errorSession->pushErrorContext( file, line, function );
+        }
+    }
     
-    ~ErrorContextAutostack();
+    ~ErrorContextAutostack()
+    {
+        if( errorSession != NULL )
+        {
+            errorSession->popErrorContext();
+        }
+    }
 };
 
+#ifdef FIELDML_NO_ERROR_CONTEXT
+//Error messages will not include a call trace.
+#define ERROR_AUTOSTACK( errorHandler ) ((void)0)
+#else
 #define ERROR_AUTOSTACK( errorHandler ) ErrorContextAutostack _tracer( errorHandler, __FILE__, __LINE__, __ECA_FUNC__ )
+#endif
 
 #endif //H_ERROR_CONTEXT_AUTOSTACK
@@ -64,6 +64,43 @@ template <typename T> T *checkedCast(FieldmlSession *session, const FmlObjectHan
     return (T *)object;
 }
 
+
+void copyBinds( SimpleMap<FmlObjectHandle, FmlObjectHandle> &source, SimpleMap<FmlObjectHandle, FmlObjectHandle> &target, FmlObjectHandle handleOffset )
+{
+    if( source.hasDefault() )
+    {
+        target.setDefault( FieldmlObject::moveHandle( source.getDefault(), handleOffset ) );
+    }
+    
+    for( int i = 0; i < source.size(); i++ )
+    {
+        target.set( FieldmlObject::moveHandle( source.getKey( i ), handleOffset ), FieldmlObject::moveHandle( source.getValue( i ), handleOffset ) );
+    }
+}
+
+
+void copyEvaluators( SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> &source, SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> &target, FmlObjectHandle handleOffset )
+{
+    if( source.hasDefault() )
+    {
+        target.setDefault( FieldmlObject::moveHandle( source.getDefault(), handleOffset ) );
+    }
+    
+    for( int i = 0; i < source.getRangeCount(); i++ )
+    {
+        target.setRange( source.getRangeMin( i ), source.getRangeMax( i ), FieldmlObject::moveHandle( source.getRangeValue( i ), handleOffset ) );
+    }
+}
+
+
+void copyArguments( const set<FmlObjectHandle> &source, set<FmlObjectHandle> &target, FmlObjectHandle handleOffset )
+{
+    for( set<FmlObjectHandle>::const_iterator i = source.begin(); i != source.end(); i++ )
+    {
+        target.insert( target.end(), FieldmlObject::moveHandle( *i, handleOffset ) );
+    }
+}
+
 } //End namespace EvaluatorsUtil
 
 Evaluator::Evaluator( const std::string _name, FieldmlRegion* _region, FieldmlHandleType _type, FmlObjectHandle _valueType, bool _isVirtual ) :
@@ -103,6 +140,15 @@ ConstantEvaluator::ConstantEvaluator( const std::string _name, FieldmlRegion* _r
 }
 
 
+FieldmlObject *ConstantEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    ConstantEvaluator *copy = new ConstantEvaluator( name, newRegion, valueString, moveHandle( valueType, handleOffset ) );
+    copy->intValue = intValue;
+    
+    return copy;
+}
+
+
 bool ConstantEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     return false;
@@ -127,6 +173,16 @@ ReferenceEvaluator::ReferenceEvaluator
 }
 
 
+FieldmlObject *ReferenceEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    ReferenceEvaluator *copy = new ReferenceEvaluator( name, newRegion, moveHandle( sourceEvaluator, handleOffset ), moveHandle( valueType, handleOffset ), isVirtual );
+    copy->intValue = intValue;
+    EvaluatorsUtil::copyBinds( binds, copy->binds, handleOffset );
+    
+    return copy;
+}
+
+
 bool ReferenceEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     delegates.insert( sourceEvaluator );
@@ -151,6 +207,16 @@ ArgumentEvaluator::ArgumentEvaluator(const std::string _name, FieldmlRegion* _re
 }
 
 
+FieldmlObject *ArgumentEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    ArgumentEvaluator *copy = new ArgumentEvaluator( name, newRegion, moveHandle( valueType, handleOffset ), isVirtual );
+    copy->intValue = intValue;
+    EvaluatorsUtil::copyArguments( arguments, copy->arguments, handleOffset );
+    
+    return copy;
+}
+
+
 bool ArgumentEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     return false;
@@ -169,6 +235,16 @@ ExternalEvaluator::ExternalEvaluator( const std::string _name, FieldmlRegion* _r
 }
 
 
+FieldmlObject *ExternalEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    ExternalEvaluator *copy = new ExternalEvaluator( name, newRegion, moveHandle( valueType, handleOffset ), isVirtual );
+    copy->intValue = intValue;
+    EvaluatorsUtil::copyArguments( arguments, copy->arguments, handleOffset );
+    
+    return copy;
+}
+
+
 bool ExternalEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     return false;
@@ -217,6 +293,18 @@ PiecewiseEvaluator::PiecewiseEvaluator( const std::string _name, FieldmlRegion*
 }
 
 
+FieldmlObject *PiecewiseEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    PiecewiseEvaluator *copy = new PiecewiseEvaluator( name, newRegion, moveHandle( valueType, handleOffset ), isVirtual );
+    copy->intValue = intValue;
+    copy->indexEvaluator = moveHandle( indexEvaluator, handleOffset );
+    EvaluatorsUtil::copyBinds( binds, copy->binds, handleOffset );
+    EvaluatorsUtil::copyEvaluators( evaluators, copy->evaluators, handleOffset );
+    
+    return copy;
+}
+
+
 bool PiecewiseEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     const set<FmlObjectHandle> &evaluatorValues = evaluators.getValues();
@@ -246,6 +334,18 @@ AggregateEvaluator::AggregateEvaluator( const std::string _name, FieldmlRegion*
 }
 
 
+FieldmlObject *AggregateEvaluator::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    AggregateEvaluator *copy = new AggregateEvaluator( name, newRegion, moveHandle( valueType, handleOffset ), isVirtual );
+    copy->intValue = intValue;
+    copy->indexEvaluator = moveHandle( indexEvaluator, handleOffset );
+    EvaluatorsUtil::copyBinds( binds, copy->binds, handleOffset );
+    EvaluatorsUtil::copyEvaluators( evaluators, copy->evaluators, handleOffset );
+    
+    return copy;
+}
+
+
 bool AggregateEvaluator::addDelegates( set<FmlObjectHandle> &delegates )
 {
     const set<FmlObjectHandle> &evaluatorValues = evaluators.getValues();
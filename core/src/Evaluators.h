@@ -49,6 +49,7 @@
 #include "fieldml_api.h"
 #include "fieldml_structs.h"
 #include "SimpleMap.h"
+#include "SimpleRangeMap.h"
 #include "FieldmlSession.h"
 
 class Evaluator :
@@ -73,6 +74,8 @@ public:
     
     ConstantEvaluator( const std::string _name, FieldmlRegion* _region, const std::string _literal, FmlObjectHandle _valueType );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static ConstantEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -89,6 +92,8 @@ public:
 
     ReferenceEvaluator( const std::string _name, FieldmlRegion* _region, FmlObjectHandle _evaluator, FmlObjectHandle _valueType, bool _isVirtual );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static ReferenceEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -102,10 +107,12 @@ public:
     FmlObjectHandle indexEvaluator;
     
     SimpleMap<FmlObjectHandle, FmlObjectHandle> binds;
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> evaluators;
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> evaluators;
     
     PiecewiseEvaluator( const std::string name, FieldmlRegion* region, FmlObjectHandle valueType, bool _isVirtual );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static PiecewiseEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -117,12 +124,14 @@ class AggregateEvaluator :
 {
 public:
     SimpleMap<FmlObjectHandle, FmlObjectHandle> binds;
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> evaluators;
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> evaluators;
     
     FmlObjectHandle indexEvaluator;
     
     AggregateEvaluator( const std::string _name, FieldmlRegion* _region, FmlObjectHandle _valueType, bool _isVirtual );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static AggregateEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -137,6 +146,8 @@ public:
     
     ArgumentEvaluator( const std::string name, FieldmlRegion* region, FmlObjectHandle _valueType, bool _isVirtual );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static ArgumentEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -151,6 +162,8 @@ public:
     
     ExternalEvaluator( const std::string name, FieldmlRegion* region, FmlObjectHandle _valueType, bool _isVirtual );
     
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual bool addDelegates( std::set<FmlObjectHandle> &delegates );
     
     static ExternalEvaluator *checkedCast( FieldmlSession *session, FmlObjectHandle objectHandle );
@@ -39,16 +39,20 @@
  *
  */
 
+#include <climits>
 #include <cstring>
 #include <cstdio>
 #include <list>
+#include <map>
 #include <sstream>
 
 #include <libxml/globals.h>
 #include <libxml/xmlerror.h>
 #include <libxml/parser.h>
 #include <libxml/xmlmemory.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xmlschemas.h>
+#include <libxml/threads.h>
 
 #include "ErrorContextAutostack.h"
 #include "Util.h"
@@ -60,6 +64,9 @@
 
 using namespace std;
 
+//The size of the parts read from a callback by the push parser.
+static const int PUSH_CHUNK_SIZE = 16384;
+
 //========================================================================
 
 struct ParseState
@@ -69,10 +76,21 @@ struct ParseState
     std::list<xmlNodePtr> parseStack;
     std::list<xmlNodePtr> unparsedNodes;
     
+    //Lookup tables for unparsedNodes, so that resolving a forward reference does not require a scan of the document.
+    std::map<xmlNodePtr, std::list<xmlNodePtr>::iterator> unparsedIndex;
+    std::map<std::string, xmlNodePtr> unparsedNames;
+    
     //14102011 CPL Currently, mesh shapes depends on an evaluator which typically depends on mesh-argument which depends on mesh.
     //To work around this cyclic dependency, the shapes attribute is analysed after rest of the document has been parsed.
     //In the long term, shapes will be a bound-type property of a mesh-type domain, so the problem will neatly vanish.
     std::list<pair<FmlObjectHandle,std::string> > shapesHACK;
+    
+    //Streaming only. An object that refers to a name that has not been defined yet is copied into deferredDoc, and
+    //kept in deferredNodes, keyed by its position in the document, until one of the names it is waiting for appears.
+    xmlDocPtr deferredDoc;
+    std::map<int, xmlNodePtr> deferredNodes;
+    std::map<std::string, std::list<int> > waitingNodes;
+    std::list<std::string> definedNames;
 };
 
 //========================================================================
@@ -89,6 +107,23 @@ public:
 
 //========================================================================
 
+static bool formatContextError( char *message, const char *msg, va_list vargs )
+{
+    int retval = vsnprintf( message, 255, msg, vargs );
+    if( retval <= 0 )
+    {
+        return false;
+    }
+    
+    //libxml likes to put \n at the end of its error messages
+    if( ( retval < 255 ) && ( message[retval-1] == '\n' ) )
+    {
+        message[retval-1] = 0;
+    }
+    return true;
+}
+
+
 static void addContextError( void *context, const char *msg, ... )
 {
     FieldmlErrorHandler *errorHandler = (FieldmlErrorHandler*)context;
@@ -97,63 +132,113 @@ static void addContextError( void *context, const char *msg, ... )
 
     va_list vargs;
     va_start( vargs, msg );  
-    int retval = vsnprintf( message, 255, msg, vargs );  
+    bool isFormatted = formatContextError( message, msg, vargs );
     va_end( vargs);
     
-    if( retval > 0 )
+    if( isFormatted )
     {
-        //libxml likes to put \n at the end of its error messages
-        if( message[retval-1] == '\n' )
-        {
-            message[retval-1] = 0;
-        }
         errorHandler->logError( message );
     }
 }
 
-//========================================================================
 
-static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr buffer, const char *resourceName )
+/**
+ * As addContextError, but the error is only recorded, and printed in debug mode. Used for libxml2's generic errors,
+ * which are internal detail that accompanies an error already reported.
+ */
+static void addGenericError( void *context, const char *msg, ... )
 {
-    xmlSchemaPtr schemas = NULL;
-    xmlSchemaParserCtxtPtr sctxt;
-    xmlSchemaValidCtxtPtr vctxt;
+    FieldmlErrorHandler *errorHandler = (FieldmlErrorHandler*)context;
+
+    char message[256];
+
+    va_list vargs;
+    va_start( vargs, msg );  
+    bool isFormatted = formatContextError( message, msg, vargs );
+    va_end( vargs);
     
-    LIBXML_TEST_VERSION
+    if( isFormatted )
+    {
+        errorHandler->logError( std::string( message ) );
+    }
+}
 
-    xmlSubstituteEntitiesDefault( 1 );
+//========================================================================
 
-    if( buffer == NULL )
+static void addReaderError( void *context, const char *msg, xmlParserSeverities severity, xmlTextReaderLocatorPtr /*locator*/ )
+{
+    if( severity != XML_PARSER_SEVERITY_WARNING )
     {
-        return 1;
+        addContextError( context, "%s", msg );
     }
+}
 
-    sctxt = xmlSchemaNewMemParserCtxt( FML_STRING_FIELDML_XSD, strlen( FML_STRING_FIELDML_XSD ) );
+
+/**
+ * Returns the compiled FieldML schema. The schema is compiled the first time it is needed, and then shared by every
+ * document parsed in the process. Sessions may be parsed on different threads, so the first use is made under
+ * libxml2's library lock.
+ */
+static xmlSchemaPtr getSchema( FieldmlErrorHandler *errorHandler )
+{
+    static xmlSchemaPtr schema = NULL;
+    
+    xmlLockLibrary();
+    if( schema != NULL )
+    {
+        xmlUnlockLibrary();
+        return schema;
+    }
+    
+    xmlSchemaParserCtxtPtr sctxt = xmlSchemaNewMemParserCtxt( FML_STRING_FIELDML_XSD, strlen( FML_STRING_FIELDML_XSD ) );
     xmlSchemaSetParserErrors( sctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
-    schemas = xmlSchemaParse( sctxt );
-    if( schemas == NULL )
+    schema = xmlSchemaParse( sctxt );
+    if( schema == NULL )
     {
         xmlGenericError( xmlGenericErrorContext, "Internal schema failed to compile\n" );
     }
     xmlSchemaFreeParserCtxt( sctxt );
+    xmlUnlockLibrary();
+    
+    return schema;
+}
 
-    vctxt = xmlSchemaNewValidCtxt( schemas );
-    xmlSchemaSetValidErrors( vctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
-
-    int result = xmlSchemaValidateStream( vctxt, buffer, (xmlCharEncoding)0, NULL, NULL );
-
-    xmlSchemaFreeValidCtxt( vctxt );
 
-    xmlSchemaFree( schemas );
+static void logValidationError( FieldmlErrorHandler *errorHandler, const char *resourceName )
+{
+    string errorMessage = "Validation error in ";
+    errorMessage += resourceName;
     
     xmlErrorPtr err = xmlGetLastError();
     if( ( err != NULL ) && ( err->message != NULL ) )
     {
-        string errorMessage = "Validation error in ";
-        errorMessage += resourceName;
         errorMessage += ": ";
         errorMessage += err->message;
-        errorHandler->logError( errorMessage );
+    }
+    
+    errorHandler->logError( errorMessage );
+}
+
+
+static int validate( FieldmlErrorHandler *errorHandler, xmlDocPtr doc, const char *resourceName )
+{
+    xmlSchemaPtr schema = getSchema( errorHandler );
+    if( schema == NULL )
+    {
+        return 1;
+    }
+
+    xmlSchemaValidCtxtPtr vctxt = xmlSchemaNewValidCtxt( schema );
+    xmlSchemaSetValidErrors( vctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
+
+    xmlResetLastError();
+    int result = xmlSchemaValidateDoc( vctxt, doc );
+
+    xmlSchemaFreeValidCtxt( vctxt );
+    
+    if( result != 0 )
+    {
+        logValidationError( errorHandler, resourceName );
     }
     
     return result;
@@ -195,6 +280,33 @@ int getIntAttribute( xmlNodePtr node, const xmlChar *attribute, int defaultValue
 
 static int parseObjectNode( xmlNodePtr objectNode, ParseState &state );
 
+static void addUnparsedNode( xmlNodePtr node, ParseState &state )
+{
+    state.unparsedNodes.push_front( node );
+    state.unparsedIndex[node] = state.unparsedNodes.begin();
+
+    const char *name = getStringAttribute( node, NAME_ATTRIB );
+    if( name != NULL )
+    {
+        state.unparsedNames[name] = node;
+        xmlFree(const_cast<char *>(name));
+    }
+}
+
+
+static void removeUnparsedNode( xmlNodePtr node, ParseState &state )
+{
+    std::map<xmlNodePtr, std::list<xmlNodePtr>::iterator>::iterator loc = state.unparsedIndex.find( node );
+    if( loc == state.unparsedIndex.end() )
+    {
+        return;
+    }
+
+    state.unparsedNodes.erase( loc->second );
+    state.unparsedIndex.erase( loc );
+}
+
+
 FmlObjectHandle getObjectAttribute( xmlNodePtr node, const xmlChar *attribute, ParseState &state )
 {
     const char *objectName = getStringAttribute( node, attribute );
@@ -203,16 +315,10 @@ FmlObjectHandle getObjectAttribute( xmlNodePtr node, const xmlChar *attribute, P
         return FML_INVALID_HANDLE;
     }
 
-    for( std::list<xmlNodePtr>::iterator i = state.unparsedNodes.begin(); i != state.unparsedNodes.end(); i++ )
+    std::map<std::string, xmlNodePtr>::const_iterator i = state.unparsedNames.find( objectName );
+    if( ( i != state.unparsedNames.end() ) && ( state.unparsedIndex.count( i->second ) != 0 ) )
     {
-        const char *nodeObjectName = getStringAttribute( *i, NAME_ATTRIB );
-        if( strcmp( objectName, nodeObjectName ) == 0 )
-        {
-            parseObjectNode( *i, state );
-            break;
-        }
-        if (nodeObjectName)
-        	xmlFree(const_cast<char *>(nodeObjectName));
+        parseObjectNode( i->second, state );
     }
 
     FmlObjectHandle objectHandle = Fieldml_GetObjectByName( state.session, objectName );
@@ -1426,9 +1532,7 @@ static int parseObjectNode( xmlNodePtr objectNode, ParseState &state )
 
     state.parseStack.pop_back();
 
-    std::list<xmlNodePtr>::iterator loc = find( state.unparsedNodes.begin(), state.unparsedNodes.end(), objectNode );
-
-    state.unparsedNodes.erase( loc );
+    removeUnparsedNode( objectNode, state );
 
     return err;
 }
@@ -1453,15 +1557,15 @@ static int parseDataNode( xmlNodePtr objectNode, ParseState &state )
 
         state.parseStack.pop_back();
 
-        std::list<xmlNodePtr>::iterator loc = find( state.unparsedNodes.begin(), state.unparsedNodes.end(), objectNode );
-
-        state.unparsedNodes.erase( loc );
+        removeUnparsedNode( objectNode, state );
 
     }
 
     return err;
 }
 
+static int setMeshShapes( ParseState &state );
+
 static int parseDoc( xmlDocPtr doc, ParseState &state )
 {
     xmlNodePtr fieldmlNode = xmlDocGetRootElement( doc );
@@ -1483,7 +1587,7 @@ static int parseDoc( xmlDocPtr doc, ParseState &state )
         }
         else
         {
-            state.unparsedNodes.insert( state.unparsedNodes.begin(), cur );
+            addUnparsedNode( cur, state );
         }
         cur = xmlNextElementSibling( cur );
     }
@@ -1504,6 +1608,12 @@ static int parseDoc( xmlDocPtr doc, ParseState &state )
         parseObjectNode( state.unparsedNodes.back(), state );
     }
     
+    return setMeshShapes( state );
+}
+
+
+static int setMeshShapes( ParseState &state )
+{
     for( std::list<pair<FmlObjectHandle,string> >::const_iterator i = state.shapesHACK.begin(); i != state.shapesHACK.end(); i++ )
     {
         FmlObjectHandle shapesEvaluator = Fieldml_GetObjectByName( state.session, i->second.c_str() );
@@ -1518,23 +1628,326 @@ static int parseDoc( xmlDocPtr doc, ParseState &state )
 }
 
 
-int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session )
+//========================================================================
+//
+// Streaming
+//
+//========================================================================
+
+static bool isReferenceAttribute( xmlNodePtr node, const xmlChar *attribute )
 {
-    LIBXML_TEST_VERSION
+    if( checkName( node, SHAPES_TAG ) )
+    {
+        //Mesh shapes are only resolved once the whole document has been read.
+        return false;
+    }
+    
+    if( xmlStrEqual( attribute, NAME_ATTRIB ) )
+    {
+        //Entries in an argument list use the name of the argument they refer to.
+        return checkName( node, ARGUMENT_TAG );
+    }
+    
+    return xmlStrEqual( attribute, VALUE_TYPE_ATTRIB ) ||
+        xmlStrEqual( attribute, EVALUATOR_ATTRIB ) ||
+        xmlStrEqual( attribute, ARGUMENT_ATTRIB ) ||
+        xmlStrEqual( attribute, SOURCE_ATTRIB ) ||
+        xmlStrEqual( attribute, DEFAULT_ATTRIB ) ||
+        xmlStrEqual( attribute, DATA_ATTRIB ) ||
+        xmlStrEqual( attribute, KEY_DATA_ATTRIB ) ||
+        xmlStrEqual( attribute, VALUE_DATA_ATTRIB ) ||
+        xmlStrEqual( attribute, ORDER_ATTRIB );
+}
 
-    xmlSubstituteEntitiesDefault( 1 );
 
-    xmlParserInputBufferPtr buffer = xmlParserInputBufferCreateFilename( filename, XML_CHAR_ENCODING_NONE );
-    if( buffer == NULL )
+/**
+ * Finds the first object referred to by the given node or its descendants that does not exist yet.
+ */
+static bool findMissingReference( xmlNodePtr node, ParseState &state, string &missingName )
+{
+    for( xmlAttrPtr attribute = node->properties; attribute != NULL; attribute = attribute->next )
+    {
+        if( ( attribute->ns != NULL ) || !isReferenceAttribute( node, attribute->name ) )
+        {
+            continue;
+        }
+        
+        const char *name = getStringAttribute( node, attribute->name );
+        bool isMissing = ( name != NULL ) && ( Fieldml_GetObjectByName( state.session, name ) == FML_INVALID_HANDLE );
+        if( isMissing )
+        {
+            missingName = name;
+        }
+        xmlFree(const_cast<char *>(name));
+        
+        if( isMissing )
+        {
+            return true;
+        }
+    }
+    
+    for( xmlNodePtr child = xmlFirstElementChild( node ); child != NULL; child = xmlNextElementSibling( child ) )
+    {
+        if( findMissingReference( child, state, missingName ) )
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+
+/**
+ * Queues the names of the objects defined by the given node, so that anything waiting for them can be parsed.
+ */
+static void addDefinedNames( xmlNodePtr node, ParseState &state )
+{
+    if( state.waitingNodes.empty() )
+    {
+        return;
+    }
+    
+    const char *name = getStringAttribute( node, NAME_ATTRIB );
+    if( name == NULL )
+    {
+        name = getStringAttribute( node, LOCAL_NAME_ATTRIB );
+    }
+    if( name != NULL )
+    {
+        state.definedNames.push_back( name );
+        xmlFree(const_cast<char *>(name));
+    }
+    
+    for( xmlNodePtr child = xmlFirstElementChild( node ); child != NULL; child = xmlNextElementSibling( child ) )
+    {
+        addDefinedNames( child, state );
+    }
+}
+
+
+/**
+ * Parses the given top-level object, unless it refers to an object that has not been defined yet, in which case a
+ * copy is put aside until that object appears. Deferred nodes are owned by the parse state until they are parsed.
+ */
+static void parseStreamedNode( xmlNodePtr node, int order, bool isDeferred, ParseState &state )
+{
+    string missingName;
+    if( findMissingReference( node, state, missingName ) )
+    {
+        state.waitingNodes[missingName].push_back( order );
+        state.deferredNodes[order] = isDeferred ? node : xmlDocCopyNode( node, state.deferredDoc, 1 );
+        return;
+    }
+    
+    parseObjectNode( node, state );
+    addDefinedNames( node, state );
+    
+    if( isDeferred )
+    {
+        xmlFreeNode( node );
+    }
+}
+
+
+static void parseWaitingNodes( ParseState &state )
+{
+    while( !state.definedNames.empty() )
+    {
+        std::map<std::string, std::list<int> >::iterator waiting = state.waitingNodes.find( state.definedNames.front() );
+        state.definedNames.pop_front();
+        if( waiting == state.waitingNodes.end() )
+        {
+            continue;
+        }
+        
+        std::list<int> orders;
+        orders.swap( waiting->second );
+        state.waitingNodes.erase( waiting );
+        
+        for( std::list<int>::const_iterator i = orders.begin(); i != orders.end(); i++ )
+        {
+            std::map<int, xmlNodePtr>::iterator deferred = state.deferredNodes.find( *i );
+            if( deferred == state.deferredNodes.end() )
+            {
+                continue;
+            }
+            
+            xmlNodePtr node = deferred->second;
+            state.deferredNodes.erase( deferred );
+            parseStreamedNode( node, *i, true, state );
+        }
+    }
+}
+
+
+/**
+ * Creates objects as the document is read. Each top-level object is expanded on its own, and released by the
+ * reader once it has been parsed, so the document is never held in memory as a whole.
+ */
+static int parseStream( xmlTextReaderPtr reader, const char *resourceName, ParseState &state )
+{
+    int result = xmlTextReaderRead( reader );
+    while( ( result == 1 ) && ( ( xmlTextReaderNodeType( reader ) != XML_READER_TYPE_ELEMENT ) || ( xmlTextReaderDepth( reader ) < 1 ) ) )
+    {
+        result = xmlTextReaderRead( reader );
+    }
+    
+    if( ( result != 1 ) || !xmlStrEqual( xmlTextReaderConstLocalName( reader ), REGION_TAG ) )
     {
-        errorHandler->logError( "Failed to create XML buffer", filename );
+        state.errorHandler->logError( "Failed to parse XML", resourceName );
         return 1;
     }
     
-    int err = validate( errorHandler, buffer, filename );
-    if( err != 0 )
+    state.deferredDoc = xmlNewDoc( (const xmlChar*)"1.0" );
+    
+    ImportParser importParser;
+    int order = 0;
+    
+    if( !xmlTextReaderIsEmptyElement( reader ) )
     {
-        return err;
+        result = xmlTextReaderRead( reader );
+    }
+    while( ( result == 1 ) && ( xmlTextReaderDepth( reader ) > 1 ) )
+    {
+        if( xmlTextReaderNodeType( reader ) != XML_READER_TYPE_ELEMENT )
+        {
+            result = xmlTextReaderRead( reader );
+            continue;
+        }
+        
+        xmlNodePtr node = xmlTextReaderExpand( reader );
+        if( node == NULL )
+        {
+            result = -1;
+            break;
+        }
+        
+        if( checkName( node, IMPORT_TAG ) )
+        {
+            importParser.parseNode( node, state );
+            addDefinedNames( node, state );
+        }
+        else
+        {
+            parseStreamedNode( node, order++, false, state );
+        }
+        parseWaitingNodes( state );
+        
+        result = xmlTextReaderNext( reader );
+    }
+    
+    if( result == -1 )
+    {
+        state.errorHandler->logError( "Failed to parse XML", resourceName );
+    }
+    
+    //Whatever is left refers to objects that were never defined, and is parsed in document order to report it.
+    while( !state.deferredNodes.empty() )
+    {
+        xmlNodePtr node = state.deferredNodes.begin()->second;
+        state.deferredNodes.erase( state.deferredNodes.begin() );
+        
+        parseObjectNode( node, state );
+        addDefinedNames( node, state );
+        xmlFreeNode( node );
+        
+        parseWaitingNodes( state );
+    }
+    
+    xmlFreeDoc( state.deferredDoc );
+    state.deferredDoc = NULL;
+    
+    if( result == -1 )
+    {
+        return 1;
+    }
+    
+    return setMeshShapes( state );
+}
+
+
+static int parseReader( xmlTextReaderPtr reader, const char *resourceName, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions )
+{
+    if( reader == NULL )
+    {
+        errorHandler->logError( "Failed to create XML reader", resourceName );
+        return 1;
+    }
+    
+    xmlTextReaderSetErrorHandler( reader, addReaderError, errorHandler );
+    
+    //The streaming validator reports some failures, such as a truncated document, as generic errors. They belong to
+    //this document, so they are recorded with its other errors instead of going to stderr.
+    xmlGenericErrorFunc genericError = xmlGenericError;
+    void *genericErrorContext = xmlGenericErrorContext;
+    xmlSetGenericErrorFunc( errorHandler, addGenericError );
+    
+    //The schema is checked as the document is read, rather than in a separate pass.
+    bool isValidated = ( parseOptions & FML_PARSE_TRUSTED ) == 0;
+    if( isValidated )
+    {
+        xmlSchemaPtr schema = getSchema( errorHandler );
+        if( ( schema == NULL ) || ( xmlTextReaderSetSchema( reader, schema ) != 0 ) )
+        {
+            errorHandler->logError( "Failed to set up validation", resourceName );
+            xmlFreeTextReader( reader );
+            xmlSetGenericErrorFunc( genericErrorContext, genericError );
+            return 1;
+        }
+    }
+    
+    ParseState state;
+    
+    state.errorHandler = errorHandler;
+    state.session = session;
+    int err = parseStream( reader, resourceName, state );
+    
+    if( isValidated && ( xmlTextReaderIsValid( reader ) != 1 ) )
+    {
+        logValidationError( errorHandler, resourceName );
+        err = 1;
+    }
+    
+    xmlFreeTextReader( reader );
+    xmlSetGenericErrorFunc( genericErrorContext, genericError );
+    
+    return err;
+}
+
+
+static int parseDocument( xmlDocPtr doc, const char *resourceName, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions )
+{
+    if( ( parseOptions & FML_PARSE_TRUSTED ) == 0 )
+    {
+        int err = validate( errorHandler, doc, resourceName );
+        if( err != 0 )
+        {
+            xmlFreeDoc( doc );
+            return err;
+        }
+    }
+    
+    ParseState state;
+    
+    state.errorHandler = errorHandler;
+    state.session = session;
+    int err = parseDoc( doc, state );
+    xmlFreeDoc( doc );
+    
+    return err;
+}
+
+
+int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions )
+{
+    LIBXML_TEST_VERSION
+
+    xmlSubstituteEntitiesDefault( 1 );
+
+    if( ( parseOptions & FML_PARSE_STREAMING ) != 0 )
+    {
+        return parseReader( xmlReaderForFile( filename, NULL, XML_PARSE_NOENT ), filename, errorHandler, session, parseOptions );
     }
 
     xmlParserCtxtPtr ctxt; /* the parser context */
@@ -1550,43 +1963,38 @@ int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *err
     /* parse the file, activating the DTD validation option */
     doc = xmlCtxtReadFile( ctxt, filename, NULL, 0 );
     /* check if parsing suceeded */
+    int err = 0;
     if (doc == NULL)
     {
         errorHandler->logError( "Failed to parse XML file", filename );
     }
     else
     {
-        ParseState state;
-        
-        state.errorHandler = errorHandler;
-        state.session = session;
-        parseDoc( doc, state );
-        xmlFreeDoc( doc );
+        err = parseDocument( doc, filename, errorHandler, session, parseOptions );
     }
     /* free up the parser context */
     xmlFreeParserCtxt( ctxt );
     
-    return 0;
+    return err;
 }
 
 
-int FieldmlDOM::parseFieldmlString( const char *string, const char *stringDescription, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session )
+int FieldmlDOM::parseFieldmlString( const char *string, size_t length, const char *stringDescription, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions )
 {
     LIBXML_TEST_VERSION
 
     xmlSubstituteEntitiesDefault( 1 );
 
-    xmlParserInputBufferPtr buffer = xmlParserInputBufferCreateMem( string, strlen( string ), XML_CHAR_ENCODING_NONE );
-    if( buffer == NULL )
+    //NOTE: libxml2 takes buffer sizes as ints.
+    if( length > INT_MAX )
     {
-        errorHandler->logError( "Failed to create XML buffer", stringDescription );
+        errorHandler->logError( "XML buffer too large", stringDescription );
         return 1;
     }
     
-    int err = validate( errorHandler, buffer, stringDescription );
-    if( err != 0 )
+    if( ( parseOptions & FML_PARSE_STREAMING ) != 0 )
     {
-        return err;
+        return parseReader( xmlReaderForMemory( string, (int)length, url, NULL, XML_PARSE_NOENT ), stringDescription, errorHandler, session, parseOptions );
     }
 
     xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
@@ -1596,22 +2004,84 @@ int FieldmlDOM::parseFieldmlString( const char *string, const char *stringDescri
         return 1;
     }
 
-    xmlDocPtr doc = xmlCtxtReadMemory( ctxt, string, strlen( string ), url, NULL, 0 );
+    xmlDocPtr doc = xmlCtxtReadMemory( ctxt, string, (int)length, url, NULL, 0 );
+    int err = 0;
     if( doc == NULL )
     {
         errorHandler->logError( "Failed to parse XML", stringDescription );
     }
     else
     {
-        ParseState state;
-        
-        state.errorHandler = errorHandler;
-        state.session = session;
-        parseDoc( doc, state );
-        xmlFreeDoc( doc );
+        err = parseDocument( doc, stringDescription, errorHandler, session, parseOptions );
     }
 
     xmlFreeParserCtxt( ctxt );
     
-    return 0;
+    return err;
+}
+
+
+int FieldmlDOM::parseFieldmlCallback( FmlReadCallback callback, void *context, const char *description, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions )
+{
+    LIBXML_TEST_VERSION
+
+    xmlSubstituteEntitiesDefault( 1 );
+
+    if( ( parseOptions & FML_PARSE_STREAMING ) != 0 )
+    {
+        return parseReader( xmlReaderForIO( callback, NULL, context, url, NULL, XML_PARSE_NOENT ), description, errorHandler, session, parseOptions );
+    }
+    
+    char chunk[PUSH_CHUNK_SIZE];
+    int length = callback( context, chunk, PUSH_CHUNK_SIZE );
+    if( length < 0 )
+    {
+        errorHandler->logError( "Failed to read XML", description );
+        return 1;
+    }
+    
+    //The push parser needs the first bytes up front to detect the encoding.
+    xmlParserCtxtPtr ctxt = xmlCreatePushParserCtxt( NULL, NULL, chunk, length, url );
+    if( ctxt == NULL )
+    {
+        errorHandler->logError( "Failed to allocate parser context", description );
+        return 1;
+    }
+    
+    bool readOk = true;
+    while( length > 0 )
+    {
+        length = callback( context, chunk, PUSH_CHUNK_SIZE );
+        if( length < 0 )
+        {
+            readOk = false;
+        }
+        else if( length > 0 )
+        {
+            xmlParseChunk( ctxt, chunk, length, 0 );
+        }
+    }
+    xmlParseChunk( ctxt, NULL, 0, 1 );
+    
+    xmlDocPtr doc = ctxt->myDoc;
+    ctxt->myDoc = NULL;
+    
+    int err = 0;
+    if( !readOk || !ctxt->wellFormed || ( doc == NULL ) )
+    {
+        errorHandler->logError( "Failed to parse XML", description );
+        if( doc != NULL )
+        {
+            xmlFreeDoc( doc );
+        }
+        err = 1;
+    }
+    else
+    {
+        err = parseDocument( doc, description, errorHandler, session, parseOptions );
+    }
+
+    xmlFreeParserCtxt( ctxt );
+    
+    return err;
 }
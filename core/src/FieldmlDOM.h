@@ -48,9 +48,14 @@
 
 namespace FieldmlDOM
 {
-    int parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session );
+    int parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions = FML_PARSE_DEFAULT );
 
-    int parseFieldmlString( const char *string, const char *stringDescription, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session );
+    int parseFieldmlString( const char *string, size_t length, const char *stringDescription, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions = FML_PARSE_DEFAULT );
+
+    /**
+     * Parses a document supplied a part at a time by the given callback. Each part is parsed as soon as it is read.
+     */
+    int parseFieldmlCallback( FmlReadCallback callback, void *context, const char *description, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, int parseOptions = FML_PARSE_DEFAULT );
 }
 
 #endif // H_FIELDMLDOM
@@ -118,6 +118,13 @@ const string FieldmlRegion::getName()
 void FieldmlRegion::addLocalObject( FmlObjectHandle handle )
 {
     localObjects.push_back( handle );
+    localObjectBits.setBit( handle, true );
+    
+    FieldmlObject *object = store.getObject( handle );
+    if( object != NULL )
+    {
+        localNames.insert( pair<string, FmlObjectHandle>( object->name, handle ) );
+    }
 }
 
 
@@ -132,42 +139,27 @@ const bool FieldmlRegion::hasLocalObject( FmlObjectHandle handle, bool allowVirt
         }
     }
     
-    if( FmlUtil::contains( localObjects, handle ) )
+    if( localObjectBits.getBit( handle ) )
     {
         return true;
     }
     
-    if( allowImport )
-    {
-        for( vector<ImportInfo*>::iterator i = imports.begin(); i != imports.end(); i++ )
-        {
-            ImportInfo *info = *i;
-            
-            if( info == NULL )
-            {
-                continue;
-            }
-            
-            if( info->hasObject( handle ) )
-            {
-                return true;
-            }
-        }
-    }
-    
-    return false;
+    return allowImport && importedObjectBits.getBit( handle );
+}
+
+
+const vector<FmlObjectHandle> &FieldmlRegion::getLocalObjects()
+{
+    return localObjects;
 }
 
 
 const FmlObjectHandle FieldmlRegion::getNamedObject( const string name )
 {
-    for( vector<FmlObjectHandle>::iterator i = localObjects.begin(); i != localObjects.end(); i++ )
+    map<string, FmlObjectHandle>::const_iterator local = localNames.find( name );
+    if( local != localNames.end() )
     {
-        FieldmlObject *object = store.getObject( *i );
-        if( object->name == name )
-        {
-            return *i;
-        }
+        return local->second;
     }
     
     for( vector<ImportInfo*>::iterator i = imports.begin(); i != imports.end(); i++ )
@@ -192,7 +184,7 @@ const FmlObjectHandle FieldmlRegion::getNamedObject( const string name )
 
 const string FieldmlRegion::getObjectName( FmlObjectHandle handle )
 {
-    if( FmlUtil::contains( localObjects, handle ) )
+    if( localObjectBits.getBit( handle ) )
     {
         FieldmlObject *object = store.getObject( handle );
         return object->name;
@@ -243,6 +235,10 @@ void FieldmlRegion::addImport( int importSourceIndex, string localName, string r
     }
     
     import->addImport( localName, remoteName, handle );
+    if( import->hasObject( handle ) )
+    {
+        importedObjectBits.setBit( handle, true );
+    }
 }
 
 
@@ -43,9 +43,11 @@
 #define H_FIELDML_REGION
 
 #include <vector>
+#include <map>
 
 #include "ObjectStore.h"
 #include "ImportInfo.h"
+#include "SimpleBitset.h"
 #include "fieldml_structs.h"
 
 class FieldmlRegion
@@ -59,6 +61,13 @@ private:
     
     std::vector<FmlObjectHandle> localObjects;
     
+    //Indexed by handle, so that locality tests do not have to search localObjects or the imports.
+    SimpleBitset localObjectBits;
+    
+    SimpleBitset importedObjectBits;
+    
+    std::map<std::string, FmlObjectHandle> localNames;
+    
     std::vector<ImportInfo*> imports;
     
     ObjectStore &store;
@@ -74,6 +83,11 @@ public:
 
     const bool hasLocalObject( FmlObjectHandle handle, bool allowVirtual, bool allowImport );
 
+    /**
+     * Returns the region's local objects, in the order they were added.
+     */
+    const std::vector<FmlObjectHandle> &getLocalObjects();
+
     const FmlObjectHandle getNamedObject( const std::string name );
     
     const std::string getObjectName( FmlObjectHandle handle );
@@ -40,6 +40,12 @@
  */
 
 #include <algorithm>
+#include <iterator>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <libxml/threads.h>
 
 #include "string_const.h"
 #include "Util.h"
@@ -53,6 +59,48 @@ using namespace std;
 
 static vector<FieldmlSession *> sessions;
 
+//A hidden session holding the parsed internal library, which lives for the life of the process.
+static FieldmlSession *librarySession = NULL;
+
+static bool librarySessionCreated = false;
+
+
+/**
+ * Gets the canonical path of the given file, and the time it was last modified and its size. Returns false if the file
+ * cannot be found, in which case the path is left as given.
+ */
+static bool getFileInfo( const string filename, string &path, time_t &modified, off_t &size )
+{
+    path = filename;
+    modified = 0;
+    size = 0;
+    
+    struct stat info;
+    if( stat( filename.c_str(), &info ) != 0 )
+    {
+        return false;
+    }
+    modified = info.st_mtime;
+    size = info.st_size;
+    
+#ifdef WIN32
+    char resolved[_MAX_PATH];
+    if( _fullpath( resolved, filename.c_str(), _MAX_PATH ) != NULL )
+    {
+        path = resolved;
+    }
+#else
+    char *resolved = realpath( filename.c_str(), NULL );
+    if( resolved != NULL )
+    {
+        path = resolved;
+        free( resolved );
+    }
+#endif
+    
+    return true;
+}
+
 FieldmlSession *FieldmlSession::handleToSession( FmlSessionHandle handle )
 {
     if( ( handle < 0 ) || ( (unsigned int)handle >= sessions.size() ) )
@@ -88,6 +136,9 @@ FieldmlSession::FieldmlSession()
     handle = addSession( this );
     lastError = FML_ERR_NO_ERROR;
     lastDescription = "";
+    contextDepth = 0;
+    analysisGeneration = 0;
+    parseOptions = FML_PARSE_DEFAULT;
     
     region = NULL;
 }
@@ -96,6 +147,10 @@ FieldmlSession::FieldmlSession()
 FieldmlSession::~FieldmlSession()
 {
     for_each( regions.begin(), regions.end(), FmlUtil::delete_object() );
+    for( vector<pair<unsigned int, FieldmlRegion*> >::iterator i = replacedRegions.begin(); i != replacedRegions.end(); i++ )
+    {
+        delete i->second;
+    }
     
     sessions[handle] = NULL;
 }
@@ -147,6 +202,20 @@ int FieldmlSession::getRegionIndex( string href, string name )
 }
 
 
+int FieldmlSession::getRegionIndex( FieldmlRegion *region )
+{
+    for( unsigned int i = 0; i < regions.size(); i++ )
+    {
+        if( regions[i] == region )
+        {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+
 FieldmlRegion *FieldmlSession::getRegion( int index )
 {
     if( ( index < 0 ) || ( (unsigned int)index >= regions.size() ) )
@@ -158,6 +227,87 @@ FieldmlRegion *FieldmlSession::getRegion( int index )
 }
 
 
+/**
+ * Returns the library session, creating it on first use. Sessions may import the library on different threads, so
+ * this is done under libxml2's library lock, which the schema is also compiled under. The lock is recursive, so the
+ * library can still be validated while it is held.
+ */
+FieldmlSession *FieldmlSession::getLibrarySession()
+{
+    xmlLockLibrary();
+    if( !librarySessionCreated )
+    {
+        librarySession = createLibrarySession();
+        librarySessionCreated = true;
+    }
+    FieldmlSession *session = librarySession;
+    xmlUnlockLibrary();
+    
+    return session;
+}
+
+
+FieldmlSession *FieldmlSession::createLibrarySession()
+{
+    FieldmlSession *session = new FieldmlSession();
+    FieldmlRegion *libraryRegion = session->parseResourceRegion( FML_INTERNAL_LIBRARY_NAME, "", FML_INTERNAL_LIBRARY_NAME );
+    if( libraryRegion == NULL )
+    {
+        //Sessions fall back to parsing the library themselves, so that any errors are reported to them.
+        removeSession( session->getSessionHandle() );
+        return NULL;
+    }
+
+    //Check up front that every object can be copied, as a partial copy cannot be undone.
+    for( int i = 0; i < session->objects.getCount(); i++ )
+    {
+        FieldmlObject *copy = session->objects.getObject( i )->clone( libraryRegion, 0 );
+        if( copy == NULL )
+        {
+            removeSession( session->getSessionHandle() );
+            return NULL;
+        }
+        delete copy;
+    }
+    
+    //Parsing goes through the public API, so the session needs a handle while the library is read, but it is then
+    //hidden so that callers can neither see nor destroy it.
+    sessions[session->handle] = NULL;
+    
+    return session;
+}
+
+
+FieldmlRegion *FieldmlSession::copyLibraryRegion( string name )
+{
+    FieldmlSession *library = getLibrarySession();
+    if( library == NULL )
+    {
+        return NULL;
+    }
+    
+    //The library session holds nothing but the library, so its handles all move on by the same amount.
+    FieldmlRegion *libraryRegion = library->getRegion( 0 );
+    const FmlObjectHandle handleOffset = objects.getCount();
+    FieldmlRegion *resourceRegion = new FieldmlRegion( FML_INTERNAL_LIBRARY_NAME, name, "", objects );
+    
+    for( int i = 0; i < library->objects.getCount(); i++ )
+    {
+        objects.addObject( library->objects.getObject( i )->clone( resourceRegion, handleOffset ) );
+    }
+    
+    const vector<FmlObjectHandle> &localObjects = libraryRegion->getLocalObjects();
+    for( vector<FmlObjectHandle>::const_iterator i = localObjects.begin(); i != localObjects.end(); i++ )
+    {
+        resourceRegion->addLocalObject( FieldmlObject::moveHandle( *i, handleOffset ) );
+    }
+    
+    regions.push_back( resourceRegion );
+    
+    return resourceRegion;
+}
+
+
 FieldmlRegion *FieldmlSession::addResourceRegion( string href, string name )
 {
     if( href.length() == 0 )
@@ -165,15 +315,91 @@ FieldmlRegion *FieldmlSession::addResourceRegion( string href, string name )
         return NULL;
     }
     
+    string path = href;
+    time_t modified = 0;
+    off_t size = 0;
+    if( href != FML_INTERNAL_LIBRARY_NAME )
+    {
+        getFileInfo( makeFilename( ( region != NULL ) ? region->getRoot() : "", href ), path, modified, size );
+    }
+    
     //NOTE: This will be insufficient when the region name starts being used.
-    if( FmlUtil::contains( importHrefStack, href ) )
+    const pair<string, string> key( path, name );
+    map<pair<string, string>, ResourceRegion>::iterator cached = resourceRegions.find( key );
+    FieldmlRegion *staleRegion = NULL;
+    if( cached != resourceRegions.end() )
+    {
+        if( ( cached->second.modified == modified ) && ( cached->second.size == size ) )
+        {
+            return cached->second.region;
+        }
+        staleRegion = cached->second.region;
+    }
+    
+    FieldmlRegion *resourceRegion = NULL;
+    if( href == FML_INTERNAL_LIBRARY_NAME )
+    {
+        resourceRegion = copyLibraryRegion( name );
+    }
+    if( resourceRegion == NULL )
+    {
+        resourceRegion = parseResourceRegion( href, name, path );
+    }
+    
+    if( resourceRegion != NULL )
+    {
+        if( staleRegion != NULL )
+        {
+            replaceRegion( staleRegion, resourceRegion );
+        }
+        
+        ResourceRegion &entry = resourceRegions[key];
+        entry.region = resourceRegion;
+        entry.modified = modified;
+        entry.size = size;
+    }
+    
+    return resourceRegion;
+}
+
+
+FieldmlRegion *FieldmlSession::addBufferRegion( string baseUrl, const char *buffer, size_t length )
+{
+    DocumentSource source;
+    source.buffer = buffer;
+    source.length = length;
+    source.callback = NULL;
+    source.context = NULL;
+    
+    return parseResourceRegion( baseUrl, "", baseUrl, &source );
+}
+
+
+FieldmlRegion *FieldmlSession::addCallbackRegion( string baseUrl, FmlReadCallback callback, void *context )
+{
+    DocumentSource source;
+    source.buffer = NULL;
+    source.length = 0;
+    source.callback = callback;
+    source.context = context;
+    
+    return parseResourceRegion( baseUrl, "", baseUrl, &source );
+}
+
+
+FieldmlRegion *FieldmlSession::parseResourceRegion( string href, string name, string path, const DocumentSource *source )
+{
+    if( FmlUtil::contains( importPathStack, path ) )
     {
         addError( "Recursive import involving " + href );
         return NULL;
     }
     
-    importHrefStack.push_back( href );
+    importPathStack.push_back( path );
 
+    const unsigned int regionCount = regions.size();
+    const unsigned int replacedCount = replacedRegions.size();
+    const int objectCount = objects.getCount();
     FieldmlRegion *resourceRegion = new FieldmlRegion( href, name, "", objects );
     FieldmlRegion *currentRegion = region;
     region = resourceRegion;
@@ -182,22 +408,39 @@ FieldmlRegion *FieldmlSession::addResourceRegion( string href, string name )
     //TODO Go and fetch the actual document if possible.
     if( href == FML_INTERNAL_LIBRARY_NAME )
     {
-        result = FieldmlDOM::parseFieldmlString( FML_STRING_INTERNAL_LIBRARY, "Internal library", FML_INTERNAL_LIBRARY_NAME, this, getSessionHandle() );
+        result = FieldmlDOM::parseFieldmlString( FML_STRING_INTERNAL_LIBRARY, strlen( FML_STRING_INTERNAL_LIBRARY ), "Internal library", FML_INTERNAL_LIBRARY_NAME, this, getSessionHandle(), parseOptions );
     }
     else
     {
-        string filename = makeFilename( region->getRoot(), href );
-        result = FieldmlDOM::parseFieldmlFile( filename.c_str(), this, getSessionHandle() );
+        //Imports made by this document are relative to it.
+        region->setRoot( getDirectory( path ) );
+        
+        const char *url = ( href.length() > 0 ) ? href.c_str() : NULL;
+        if( source == NULL )
+        {
+            result = FieldmlDOM::parseFieldmlFile( path.c_str(), this, getSessionHandle(), parseOptions );
+        }
+        else if( source->callback != NULL )
+        {
+            result = FieldmlDOM::parseFieldmlCallback( source->callback, source->context, "Callback", url, this, getSessionHandle(), parseOptions );
+        }
+        else
+        {
+            result = FieldmlDOM::parseFieldmlString( source->buffer, source->length, "Memory buffer", url, this, getSessionHandle(), parseOptions );
+        }
     }
     
-    importHrefStack.pop_back();
+    importPathStack.pop_back();
     
     region = currentRegion;
 
     if( ( result != 0 ) || ( getErrorCount() != 0 ) )
     {
+        //A streamed document is only known to be invalid once it has been read, so anything made from it, including
+        //the documents it imported, is dropped here.
         delete resourceRegion;
         resourceRegion = NULL;
+        discardFrom( regionCount, replacedCount, objectCount );
     }
     else
     {
@@ -208,15 +451,107 @@ FieldmlRegion *FieldmlSession::addResourceRegion( string href, string name )
 }
 
 
-void FieldmlSession::pushErrorContext( const char *file, const int line, const char *function )
+/**
+ * Returns the objects that belong to the given region.
+ */
+static vector<FmlObjectHandle> getRegionObjects( ObjectStore &objects, FieldmlRegion *region )
 {
-    contextStack.push_back( pair<string, int>( string( function ) + string( ":" ) + string( file ), line ) );
+    vector<FmlObjectHandle> handles;
+    for( int i = 0; i < objects.getCount(); i++ )
+    {
+        if( objects.getObject( i )->region == region )
+        {
+            handles.push_back( i );
+        }
+    }
+    
+    return handles;
 }
 
 
-void FieldmlSession::popErrorContext()
+/**
+ * Puts a newer reading of a document in place of the stale one, so that later imports of it, whether by href or by
+ * import source index, find the new objects. Objects already imported from the stale region stay valid, so it is kept
+ * until the session is destroyed, but its objects are no longer found by declared name.
+ */
+void FieldmlSession::replaceRegion( FieldmlRegion *staleRegion, FieldmlRegion *freshRegion )
 {
-    contextStack.pop_back();
+    const int slot = getRegionIndex( staleRegion );
+    if( ( slot < 0 ) || ( regions.back() != freshRegion ) )
+    {
+        return;
+    }
+    
+    regions.pop_back();
+    regions[slot] = freshRegion;
+    replacedRegions.push_back( pair<unsigned int, FieldmlRegion*>( slot, staleRegion ) );
+    
+    objects.setRetired( getRegionObjects( objects, staleRegion ), true );
+}
+
+
+/**
+ * Deletes the regions and objects added, and undoes the regions replaced, since the session held the given number of
+ * each, along with any cached imports and dependency analyses that might refer to them.
+ */
+void FieldmlSession::discardFrom( unsigned int regionCount, unsigned int replacedCount, int objectCount )
+{
+    while( replacedRegions.size() > replacedCount )
+    {
+        const pair<unsigned int, FieldmlRegion*> replaced = replacedRegions.back();
+        replacedRegions.pop_back();
+        
+        //The cached reading is known to be out of date, so the document is read again the next time it is imported.
+        FieldmlRegion *freshRegion = regions[replaced.first];
+        for( map<pair<string, string>, ResourceRegion>::iterator i = resourceRegions.begin(); i != resourceRegions.end(); i++ )
+        {
+            if( i->second.region == freshRegion )
+            {
+                i->second.region = replaced.second;
+                i->second.modified = 0;
+                i->second.size = -1;
+            }
+        }
+        
+        delete freshRegion;
+        regions[replaced.first] = replaced.second;
+        objects.setRetired( getRegionObjects( objects, replaced.second ), false );
+    }
+    
+    if( regionCount < regions.size() )
+    {
+        set<FieldmlRegion*> discarded( regions.begin() + regionCount, regions.end() );
+        
+        map<pair<string, string>, ResourceRegion>::iterator i = resourceRegions.begin();
+        while( i != resourceRegions.end() )
+        {
+            if( discarded.count( i->second.region ) != 0 )
+            {
+                resourceRegions.erase( i++ );
+            }
+            else
+            {
+                i++;
+            }
+        }
+        
+        for_each( regions.begin() + regionCount, regions.end(), FmlUtil::delete_object() );
+        regions.erase( regions.begin() + regionCount, regions.end() );
+    }
+    
+    if( objectCount < objects.getCount() )
+    {
+        analyses.clear();
+        analysisDependents.clear();
+        objects.truncate( objectCount );
+    }
+}
+
+
+void FieldmlSession::printErrorContext( FILE *stream, int index )
+{
+    const ErrorContext &context = contextStack[index];
+    fprintf( stream, "%s:%s:%d", context.function, context.file, context.line );
 }
 
 
@@ -230,9 +565,12 @@ FmlErrorNumber FieldmlSession::setError( const FmlErrorNumber error, const strin
         if( debug )
         {
             fprintf( stderr, "FIELDML %s (%s): Error %d: %s\n", FML_VERSION_STRING, __DATE__, error, description.c_str() );
-            for( unsigned int i = 0; i < contextStack.size(); i++ )
+            const int recordedDepth = ( contextDepth < MAX_ERROR_CONTEXT_DEPTH ) ? contextDepth : MAX_ERROR_CONTEXT_DEPTH;
+            for( int i = 0; i < recordedDepth; i++ )
             {
-                printf( "   at %s:%d\n", contextStack[i].first.c_str(), contextStack[i].second );
+                printf( "   at " );
+                printErrorContext( stdout, i );
+                printf( "\n" );
             }
         }
     }
@@ -295,6 +633,18 @@ void FieldmlSession::setDebug( const int debugValue )
 }
 
 
+void FieldmlSession::setParseOptions( const int options )
+{
+    parseOptions = options;
+}
+
+
+int FieldmlSession::getParseOptions()
+{
+    return parseOptions;
+}
+
+
 FmlSessionHandle FieldmlSession::getSessionHandle()
 {
     return handle;
@@ -306,7 +656,13 @@ void FieldmlSession::logError( const string error )
     addError( error );
     if( debug )
     {
-			fprintf( stderr, "FIELDML %s (%s): Error %s at %s:%d\n", FML_VERSION_STRING, __DATE__, error.c_str(), contextStack.back().first.c_str(), contextStack.back().second );
+        fprintf( stderr, "FIELDML %s (%s): Error %s", FML_VERSION_STRING, __DATE__, error.c_str() );
+        if( ( contextDepth > 0 ) && ( contextDepth <= MAX_ERROR_CONTEXT_DEPTH ) )
+        {
+            fprintf( stderr, " at " );
+            printErrorContext( stderr, contextDepth - 1 );
+        }
+        fprintf( stderr, "\n" );
     }
         
 }
@@ -350,61 +706,104 @@ FieldmlObject *FieldmlSession::getObject( const FmlObjectHandle handle )
 }
 
 
-bool FieldmlSession::getDelegateEvaluators( const set<FmlObjectHandle> &evaluators, vector<FmlObjectHandle> &stack, set<FmlObjectHandle> &delegates )
+void FieldmlSession::addAnalysisDependent( FmlObjectHandle handle, FmlObjectHandle dependent, int generation )
 {
-    for( set<FmlObjectHandle>::const_iterator i = evaluators.begin(); i != evaluators.end(); i++ )
-    {
-        if( !getDelegateEvaluators( *i, stack, delegates ) )
-        {
-            return false;
-        }
-        delegates.insert( *i );
-    }
-    return true;
+    analysisDependents[handle].push_back( pair<FmlObjectHandle, int>( dependent, generation ) );
 }
 
-    
-bool FieldmlSession::getDelegateEvaluators( FmlObjectHandle handle, vector<FmlObjectHandle> &stack, set<FmlObjectHandle> &delegates )
+
+FieldmlSession::DependencyAnalysis *FieldmlSession::getDelegateAnalysis( FmlObjectHandle handle )
 {
-    set<FmlObjectHandle> evaluators;
-    
-    if( handle == FML_INVALID_HANDLE )
+    map<FmlObjectHandle, DependencyAnalysis>::iterator cached = analyses.find( handle );
+    if( cached != analyses.end() )
     {
-        //Convenience so that callers don't have to check
-        return true;
+        return &cached->second;
     }
     
-    if( FmlUtil::contains( stack, handle ) )
+    if( FmlUtil::contains( analysisStack, handle ) )
     {
         //Recursive dependency!
-        return false;
+        return NULL;
     }
     
-    //TODO: Figure out why this works even though there's no popping happening.
-    stack.push_back( handle );
+    vector<FmlObjectHandle> delegates;
+    set<FmlObjectHandle> direct;
     
     Evaluator *evaluator = Evaluator::checkedCast( this, handle );
-    
-    if( evaluator != NULL )
+    if( ( evaluator != NULL ) && evaluator->addDelegates( direct ) )
     {
-        if( evaluator->addDelegates( evaluators ) )
+        analysisStack.push_back( handle );
+        for( set<FmlObjectHandle>::const_iterator i = direct.begin(); i != direct.end(); i++ )
         {
-            if( !getDelegateEvaluators( evaluators, stack, delegates ) )
+            if( *i == FML_INVALID_HANDLE )
             {
-                return false;
+                continue;
             }
+            
+            const DependencyAnalysis *delegate = getDelegateAnalysis( *i );
+            if( delegate == NULL )
+            {
+                analysisStack.pop_back();
+                return NULL;
+            }
+            
+            delegates.push_back( *i );
+            delegates.insert( delegates.end(), delegate->delegates.begin(), delegate->delegates.end() );
         }
+        analysisStack.pop_back();
+        
+        sort( delegates.begin(), delegates.end() );
+        delegates.erase( unique( delegates.begin(), delegates.end() ), delegates.end() );
     }
     
-    return true;
+    DependencyAnalysis &analysis = analyses[handle];
+    analysis.generation = ++analysisGeneration;
+    analysis.hasArguments = false;
+    analysis.delegates.swap( delegates );
+    
+    addAnalysisDependent( handle, handle, analysis.generation );
+    for( vector<FmlObjectHandle>::const_iterator i = analysis.delegates.begin(); i != analysis.delegates.end(); i++ )
+    {
+        addAnalysisDependent( *i, handle, analysis.generation );
+    }
+    
+    return &analysis;
 }
 
 
-bool FieldmlSession::getDelegateEvaluators( FmlObjectHandle handle, set<FmlObjectHandle> &delegates )
+const vector<FmlObjectHandle> *FieldmlSession::getDelegateEvaluators( FmlObjectHandle handle )
 {
-    vector<FmlObjectHandle> stack;
+    const DependencyAnalysis *analysis = getDelegateAnalysis( handle );
+    if( analysis == NULL )
+    {
+        return NULL;
+    }
+    
+    return &analysis->delegates;
+}
+
+
+void FieldmlSession::invalidateDependencies( FmlObjectHandle handle )
+{
+    map<FmlObjectHandle, DependentList>::iterator dependents = analysisDependents.find( handle );
+    if( dependents == analysisDependents.end() )
+    {
+        return;
+    }
+    
+    DependentList stale;
+    stale.swap( dependents->second );
+    analysisDependents.erase( dependents );
     
-    return getDelegateEvaluators( handle, stack, delegates );
+    for( DependentList::const_iterator i = stale.begin(); i != stale.end(); i++ )
+    {
+        //Entries for analyses that have since been redone are left alone.
+        map<FmlObjectHandle, DependencyAnalysis>::iterator analysis = analyses.find( i->first );
+        if( ( analysis != analyses.end() ) && ( analysis->second.generation == i->second ) )
+        {
+            analyses.erase( analysis );
+        }
+    }
 }
 
 
@@ -415,7 +814,7 @@ void FieldmlSession::mergeArguments( const SimpleMap<FmlObjectHandle, FmlObjectH
     {
         if( FmlUtil::contains( delegateUsed, i->first ) )
         {
-            getArguments( i->second, tmpUnbound, delegateUsed, true );
+            addArguments( i->second, tmpUnbound, delegateUsed, true );
 
             ArgumentEvaluator *arg = (ArgumentEvaluator*)getObject( i->first );
             for( set<FmlObjectHandle>::const_iterator i = arg->arguments.begin(); i != arg->arguments.end(); i++ )
@@ -440,33 +839,57 @@ void FieldmlSession::mergeArguments( const SimpleMap<FmlObjectHandle, FmlObjectH
 }
 
 
-void FieldmlSession::getArguments( const set<FmlObjectHandle> &handles, set<FmlObjectHandle> &unbound, set<FmlObjectHandle> &used )
+void FieldmlSession::addArguments( const set<FmlObjectHandle> &handles, set<FmlObjectHandle> &unbound, set<FmlObjectHandle> &used )
 {
     for( set<FmlObjectHandle>::const_iterator i = handles.begin(); i != handles.end(); i++ )
     {
-        getArguments( *i, unbound, used, true );
+        addArguments( *i, unbound, used, true );
     }
 }
 
 
-void FieldmlSession::getArguments( FmlObjectHandle handle, set<FmlObjectHandle> &unbound, set<FmlObjectHandle> &used, bool addSelf )
+void FieldmlSession::addArguments( FmlObjectHandle handle, set<FmlObjectHandle> &unbound, set<FmlObjectHandle> &used, bool addSelf )
 {
-    FieldmlObject *object = getObject( handle );
-    set<FmlObjectHandle> tmpUnbound, tmpUsed;
-    
     if( handle == FML_INVALID_HANDLE )
     {
         //Convenience so that callers don't have to check
         return;
     }
     
+    const DependencyAnalysis *analysis = getArgumentAnalysis( handle );
+    if( analysis == NULL )
+    {
+        return;
+    }
+    
+    unbound.insert( analysis->unbound.begin(), analysis->unbound.end() );
+    used.insert( analysis->used.begin(), analysis->used.end() );
+    
+    FieldmlObject *object = getObject( handle );
+    if( addSelf && ( object->objectType == FHT_ARGUMENT_EVALUATOR ) )
+    {
+        used.insert( handle );
+        unbound.insert( handle );
+    }
+}
+
+
+FieldmlSession::DependencyAnalysis *FieldmlSession::getArgumentAnalysis( FmlObjectHandle handle )
+{
+    DependencyAnalysis *analysis = getDelegateAnalysis( handle );
+    FieldmlObject *object = getObject( handle );
+    
+    if( ( analysis == NULL ) || analysis->hasArguments || ( object == NULL ) )
+    {
+        return analysis;
+    }
+    
+    //The delegates are known to be acyclic, so their own analyses can safely be requested.
+    set<FmlObjectHandle> unbound, used;
+    set<FmlObjectHandle> tmpUnbound, tmpUsed;
+    
     if( object->objectType == FHT_ARGUMENT_EVALUATOR )
     {
-        if( addSelf )
-        {
-            used.insert( handle );
-            unbound.insert( handle );
-        }
         ArgumentEvaluator *evaluator = (ArgumentEvaluator*)object;
         used.insert( evaluator->arguments.begin(), evaluator->arguments.end() );
         unbound.insert( evaluator->arguments.begin(), evaluator->arguments.end() );
@@ -480,14 +903,14 @@ void FieldmlSession::getArguments( FmlObjectHandle handle, set<FmlObjectHandle>
     else if( object->objectType == FHT_REFERENCE_EVALUATOR )
     {
         ReferenceEvaluator *evaluator = (ReferenceEvaluator*)object;
-        getArguments( evaluator->sourceEvaluator, tmpUnbound, tmpUsed, true );
+        addArguments( evaluator->sourceEvaluator, tmpUnbound, tmpUsed, true );
         mergeArguments( evaluator->binds, tmpUnbound, tmpUsed, unbound, used );
     }
     else if( object->objectType == FHT_AGGREGATE_EVALUATOR )
     {
         AggregateEvaluator *evaluator = (AggregateEvaluator*)object;
-        getArguments( evaluator->evaluators.getValues(), tmpUnbound, tmpUsed );
-        getArguments( evaluator->indexEvaluator, tmpUnbound, tmpUsed, true );
+        addArguments( evaluator->evaluators.getValues(), tmpUnbound, tmpUsed );
+        addArguments( evaluator->indexEvaluator, tmpUnbound, tmpUsed, true );
         mergeArguments( evaluator->binds, tmpUnbound, tmpUsed, unbound, used );
         unbound.erase( evaluator->indexEvaluator );
         used.insert( evaluator->indexEvaluator );
@@ -495,8 +918,8 @@ void FieldmlSession::getArguments( FmlObjectHandle handle, set<FmlObjectHandle>
     else if( object->objectType == FHT_PIECEWISE_EVALUATOR )
     {
         PiecewiseEvaluator *evaluator = (PiecewiseEvaluator*)object;
-        getArguments( evaluator->evaluators.getValues(), tmpUnbound, tmpUsed );
-        getArguments( evaluator->indexEvaluator, tmpUnbound, tmpUsed, true );
+        addArguments( evaluator->evaluators.getValues(), tmpUnbound, tmpUsed );
+        addArguments( evaluator->indexEvaluator, tmpUnbound, tmpUsed, true );
         mergeArguments( evaluator->binds, tmpUnbound, tmpUsed, unbound, used );
     }
     else if( object->objectType == FHT_PARAMETER_EVALUATOR )
@@ -505,6 +928,35 @@ void FieldmlSession::getArguments( FmlObjectHandle handle, set<FmlObjectHandle>
         set<FmlObjectHandle> indexEvaluators;
         evaluator->addDelegates( indexEvaluators );
         
-        getArguments( indexEvaluators, unbound, used );
+        addArguments( indexEvaluators, unbound, used );
     }
+    
+    analysis->unbound.assign( unbound.begin(), unbound.end() );
+    analysis->used.assign( used.begin(), used.end() );
+    set_difference( used.begin(), used.end(), unbound.begin(), unbound.end(), back_inserter( analysis->bound ) );
+    analysis->hasArguments = true;
+    
+    //Adding arguments to a used argument evaluator can change the result, even if it is not a delegate.
+    for( set<FmlObjectHandle>::const_iterator i = used.begin(); i != used.end(); i++ )
+    {
+        addAnalysisDependent( *i, handle, analysis->generation );
+    }
+    
+    return analysis;
+}
+
+
+bool FieldmlSession::getArguments( FmlObjectHandle handle, const vector<FmlObjectHandle> *&unbound, const vector<FmlObjectHandle> *&used, const vector<FmlObjectHandle> *&bound )
+{
+    const DependencyAnalysis *analysis = getArgumentAnalysis( handle );
+    if( analysis == NULL )
+    {
+        return false;
+    }
+    
+    unbound = &analysis->unbound;
+    used = &analysis->used;
+    bound = &analysis->bound;
+    
+    return true;
 }
@@ -42,8 +42,11 @@
 #ifndef H_FIELDML_SESSION
 #define H_FIELDML_SESSION
 
+#include <cstdio>
+#include <ctime>
+#include <sys/types.h>
+#include <map>
 #include <vector>
-#include <deque>
 #include <set>
 #include <utility>
 
@@ -54,31 +57,135 @@ class FieldmlSession :
     public FieldmlErrorHandler
 {
 private:
+    /**
+     * A call-site recorded by ERROR_AUTOSTACK. The strings are compile-time literals, so no copies are made, and
+     * nothing is formatted unless an error is actually reported.
+     */
+    struct ErrorContext
+    {
+        const char *file;
+        int line;
+        const char *function;
+    };
+    
+    //Contexts deeper than this are counted, but not recorded.
+    static const int MAX_ERROR_CONTEXT_DEPTH = 64;
+    
     FmlErrorNumber lastError;
     
     std::string lastDescription;
     
-    std::deque<std::pair<const std::string, const int> > contextStack;
+    ErrorContext contextStack[MAX_ERROR_CONTEXT_DEPTH];
+    
+    int contextDepth;
+    
+    void printErrorContext( FILE *stream, int index );
     
     int debug;
     
+    int parseOptions;
+    
     std::vector<std::string> errors;
     
     std::vector<FieldmlRegion*> regions;
     
-    std::vector<std::string> importHrefStack;
+    //The resolved paths of the documents being parsed, used to detect recursive imports.
+    std::vector<std::string> importPathStack;
+    
+    /**
+     * A document that has been read into a region, and the modification time and size it had when it was read. Both
+     * are compared, as modification times may only have a resolution of one second.
+     */
+    struct ResourceRegion
+    {
+        FieldmlRegion *region;
+        
+        time_t modified;
+        
+        off_t size;
+    };
+    
+    //Keyed on the resolved path and region name, so that a document imported along several paths is only read once.
+    std::map<std::pair<std::string, std::string>, ResourceRegion> resourceRegions;
+    
+    //Regions that a newer reading of their document has replaced, with the index they had in regions. They are kept
+    //for the objects that were imported from them before they were replaced.
+    std::vector<std::pair<unsigned int, FieldmlRegion*> > replacedRegions;
     
     FmlSessionHandle handle;
     
-    bool getDelegateEvaluators(  const std::set<FmlObjectHandle> &evaluators, std::vector<FmlObjectHandle> &stack, std::set<FmlObjectHandle> &set );
+    /**
+     * The memoised delegate and argument analysis of an object. All lists are sorted and free of duplicates. The
+     * argument lists are only filled in once hasArguments is set.
+     */
+    struct DependencyAnalysis
+    {
+        int generation;
+        
+        bool hasArguments;
+        
+        std::vector<FmlObjectHandle> delegates;
+        
+        std::vector<FmlObjectHandle> unbound;
+        
+        std::vector<FmlObjectHandle> used;
+        
+        //Arguments that are used, but bound.
+        std::vector<FmlObjectHandle> bound;
+    };
+    
+    typedef std::vector<std::pair<FmlObjectHandle, int> > DependentList;
+    
+    std::map<FmlObjectHandle, DependencyAnalysis> analyses;
+    
+    //For each object, the analyses that must be discarded when it changes, tagged with the generation they were made in.
+    std::map<FmlObjectHandle, DependentList> analysisDependents;
+    
+    int analysisGeneration;
+    
+    //Objects whose delegates are being analysed, used to detect cycles.
+    std::vector<FmlObjectHandle> analysisStack;
+    
+    void addAnalysisDependent( FmlObjectHandle handle, FmlObjectHandle dependent, int generation );
+    
+    DependencyAnalysis *getDelegateAnalysis( FmlObjectHandle handle );
+    
+    DependencyAnalysis *getArgumentAnalysis( FmlObjectHandle handle );
     
-    bool getDelegateEvaluators( FmlObjectHandle handle, std::vector<FmlObjectHandle> &stack, std::set<FmlObjectHandle> &set );
+    void addArguments( FmlObjectHandle handle, std::set<FmlObjectHandle> &unbound, std::set<FmlObjectHandle> &used, bool addSelf );
+    
+    void addArguments( const std::set<FmlObjectHandle> &handles, std::set<FmlObjectHandle> &unbound, std::set<FmlObjectHandle> &used );
 
     void mergeArguments( const SimpleMap<FmlObjectHandle, FmlObjectHandle> &binds, std::set<FmlObjectHandle> &delegateUnbound, std::set<FmlObjectHandle> &delegateUsed, std::set<FmlObjectHandle> &unbound, std::set<FmlObjectHandle> &used );
-    
-    void getArguments( const std::set<FmlObjectHandle> &handles, std::set<FmlObjectHandle> &unbound, std::set<FmlObjectHandle> &used );
 
     static FmlSessionHandle addSession( FieldmlSession *session );
+    
+    static FieldmlSession *getLibrarySession();
+    
+    static FieldmlSession *createLibrarySession();
+    
+    /**
+     * A document held by the caller rather than in a file. It is read from the callback if one is given, and from the
+     * buffer otherwise.
+     */
+    struct DocumentSource
+    {
+        const char *buffer;
+        
+        size_t length;
+        
+        FmlReadCallback callback;
+        
+        void *context;
+    };
+    
+    FieldmlRegion *parseResourceRegion( std::string href, std::string name, std::string path, const DocumentSource *source = NULL );
+    
+    FieldmlRegion *copyLibraryRegion( std::string name );
+    
+    void replaceRegion( FieldmlRegion *staleRegion, FieldmlRegion *freshRegion );
+    
+    void discardFrom( unsigned int regionCount, unsigned int replacedCount, int objectCount );
 
     void addError( const std::string string );
     
@@ -87,9 +194,22 @@ private:
 public:
     FieldmlSession();
     
-    void pushErrorContext( const char *file, const int line, const char *function );
+    void pushErrorContext( const char *file, const int line, const char *function )
+    {
+        if( contextDepth < MAX_ERROR_CONTEXT_DEPTH )
+        {
+            ErrorContext &context = contextStack[contextDepth];
+            context.file = file;
+            context.line = line;
+            context.function = function;
+        }
+        contextDepth++;
+    }
 
-    void popErrorContext();
+    void popErrorContext()
+    {
+        contextDepth--;
+    }
     
     FmlErrorNumber setError( const FmlErrorNumber error, const std::string errorDescription );
 
@@ -99,6 +219,13 @@ public:
 
     void setDebug( const int debugValue );
     
+    /**
+     * Sets the FieldmlParseOption values used for documents read by this session, including imports.
+     */
+    void setParseOptions( const int options );
+    
+    int getParseOptions();
+    
     const int getErrorCount();
     
     const std::string getError( const int index );
@@ -115,8 +242,24 @@ public:
     
     FieldmlObject *getObject( const FmlObjectHandle handle );
     
+    /**
+     * Returns a region holding the given document. Relative locations are resolved against the current region's
+     * root. A document is only read again if its file has been modified since it was last read. The internal library
+     * is only parsed once per process, and each session that imports it gets a copy of that region.
+     */
     FieldmlRegion *addResourceRegion( std::string location, std::string name );
     
+    /**
+     * Reads a document held in memory into a new region. Relative hrefs in it are resolved against the directory of
+     * baseUrl.
+     */
+    FieldmlRegion *addBufferRegion( std::string baseUrl, const char *buffer, size_t length );
+    
+    /**
+     * As addBufferRegion(), but reads the document from the given callback as it is parsed.
+     */
+    FieldmlRegion *addCallbackRegion( std::string baseUrl, FmlReadCallback callback, void *context );
+    
     FieldmlRegion *addNewRegion( std::string location, std::string name );
     
     FieldmlRegion *getRegion( std::string location, std::string name );
@@ -124,15 +267,31 @@ public:
     
     int getRegionIndex( std::string location, std::string name );
     
+    int getRegionIndex( FieldmlRegion *region );
+    
     FieldmlRegion *getRegion( int index );
     
     FieldmlRegion *region;
 
     ObjectStore objects;
 
-    bool getDelegateEvaluators( FmlObjectHandle handle, std::set<FmlObjectHandle> &set );
+    /**
+     * Returns the sorted list of evaluators that the given object depends on, directly or indirectly, or NULL if
+     * they form a cycle. The list is memoised, and remains valid until the next call to invalidateDependencies().
+     */
+    const std::vector<FmlObjectHandle> *getDelegateEvaluators( FmlObjectHandle handle );
+    
+    /**
+     * Returns the sorted lists of arguments that the given evaluator leaves unbound, and that it binds or leaves
+     * unbound, or false if its delegates form a cycle. The lists are memoised as for getDelegateEvaluators().
+     */
+    bool getArguments( FmlObjectHandle handle, const std::vector<FmlObjectHandle> *&unbound, const std::vector<FmlObjectHandle> *&used, const std::vector<FmlObjectHandle> *&bound );
     
-    void getArguments( FmlObjectHandle handle, std::set<FmlObjectHandle> &unbound, std::set<FmlObjectHandle> &used, bool addSelf );
+    /**
+     * Discards the memoised analysis of every object that depends on the given one. Must be called whenever the
+     * binds, delegate evaluators, index evaluators or arguments of an object change.
+     */
+    void invalidateDependencies( FmlObjectHandle handle );
 
     static FieldmlSession *handleToSession( FmlSessionHandle handle );
     
@@ -91,46 +91,31 @@ ImportInfo::~ImportInfo()
 
 FmlObjectHandle ImportInfo::getObject( string localName )
 {
-    for( vector<ObjectImport*>::iterator i = imports.begin(); i != imports.end(); i++ )
+    map<string, ObjectImport*>::const_iterator i = localNameIndex.find( localName );
+    if( i == localNameIndex.end() )
     {
-        ObjectImport *import = *i;
-        if( import->localName == localName )
-        {
-            return import->handle;
-        }
+        return FML_INVALID_HANDLE;
     }
     
-    return FML_INVALID_HANDLE;
+    return i->second->handle;
 }
 
 
 const string ImportInfo::getLocalName( FmlObjectHandle handle )
 {
-    for( vector<ObjectImport*>::iterator i = imports.begin(); i != imports.end(); i++ )
+    map<FmlObjectHandle, ObjectImport*>::const_iterator i = handleIndex.find( handle );
+    if( i == handleIndex.end() )
     {
-        ObjectImport *import = *i;
-        if( import->handle == handle )
-        {
-            return import->localName;
-        }
+        return "";
     }
     
-    return "";
+    return i->second->localName;
 }
 
 
 bool ImportInfo::hasObject( FmlObjectHandle handle )
 {
-    for( vector<ObjectImport*>::iterator i = imports.begin(); i != imports.end(); i++ )
-    {
-        ObjectImport *import = *i;
-        if( import->handle == handle )
-        {
-            return true;
-        }
-    }
-    
-    return false;
+    return handleIndex.find( handle ) != handleIndex.end();
 }
 
 
@@ -141,7 +126,12 @@ void ImportInfo::addImport( string localName, string remoteName, FmlObjectHandle
         return;
     }
     
-    imports.push_back( new ObjectImport( localName, remoteName, handle ) );
+    ObjectImport *import = new ObjectImport( localName, remoteName, handle );
+    imports.push_back( import );
+    
+    //NOTE: The first import of a given name or handle takes precedence.
+    localNameIndex.insert( pair<string, ObjectImport*>( localName, import ) );
+    handleIndex.insert( pair<FmlObjectHandle, ObjectImport*>( handle, import ) );
 }
 
 
@@ -43,6 +43,8 @@
 #define H_IMPORT_INFO
 
 #include <vector>
+#include <map>
+#include <string>
 
 class ObjectImport;
 
@@ -51,6 +53,10 @@ class ImportInfo
 private:
     std::vector<ObjectImport*> imports;
     
+    std::map<std::string, ObjectImport*> localNameIndex;
+    
+    std::map<FmlObjectHandle, ObjectImport*> handleIndex;
+    
 public:
     ImportInfo( std::string _href, std::string name );
 
@@ -0,0 +1,119 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <functional>
+
+#include "InlineDataBuffer.h"
+
+using namespace std;
+
+InlineDataBuffer::InlineDataBuffer() :
+    bytes( 1, 0 )
+{
+}
+
+
+InlineDataBuffer::~InlineDataBuffer()
+{
+}
+
+
+void InlineDataBuffer::append( const char *data, int length )
+{
+    if( length <= 0 )
+    {
+        return;
+    }
+    
+    //The data may come from getData(), so it must be copied out before the storage can move.
+    if( overlaps( data ) )
+    {
+        vector<char> copy( data, data + length );
+        append( &copy[0], length );
+        return;
+    }
+    
+    //Overwrite the old terminator, then put a new one back.
+    bytes.pop_back();
+    bytes.insert( bytes.end(), data, data + length );
+    bytes.push_back( 0 );
+}
+
+
+void InlineDataBuffer::assign( const char *data, int length )
+{
+    if( ( length > 0 ) && overlaps( data ) )
+    {
+        vector<char> copy( data, data + length );
+        assign( &copy[0], length );
+        return;
+    }
+    
+    clear();
+    append( data, length );
+}
+
+
+void InlineDataBuffer::clear()
+{
+    bytes.clear();
+    bytes.push_back( 0 );
+}
+
+
+int InlineDataBuffer::getLength() const
+{
+    return (int)bytes.size() - 1;
+}
+
+
+const char *InlineDataBuffer::getData() const
+{
+    return &bytes[0];
+}
+
+
+bool InlineDataBuffer::overlaps( const char *data ) const
+{
+    //std::less gives a total order even for pointers into different arrays.
+    less<const char *> before;
+    return !before( data, &bytes[0] ) && before( data, &bytes[0] + bytes.size() );
+}
@@ -39,24 +39,43 @@
  *
  */
 
-#include "ErrorContextAutostack.h"
+#ifndef H_INLINE_DATA_BUFFER
+#define H_INLINE_DATA_BUFFER
 
-using namespace std;
+#include <vector>
 
-ErrorContextAutostack::ErrorContextAutostack( FieldmlSession *_errorSession, const char *file, const int line, const char *function ) :
-    errorSession( _errorSession )
+/**
+ * The contents of an inline data resource. Appends copy only the new bytes, with the storage growing geometrically,
+ * and the contents are always followed by a terminating zero so that getData() can be handed out as a C string.
+ */
+class InlineDataBuffer
 {
-    if( errorSession != NULL )
-    {
-        errorSession->pushErrorContext( file, line, function );
-    }
-}
-
+private:
+    //Always holds the contents followed by a single terminating zero.
+    std::vector<char> bytes;
+    
+    /**
+     * Returns true if the given pointer points into this buffer's storage.
+     */
+    bool overlaps( const char *data ) const;
+    
+public:
+    InlineDataBuffer();
+    
+    virtual ~InlineDataBuffer();
+    
+    void append( const char *data, int length );
+    
+    void assign( const char *data, int length );
+    
+    void clear();
+    
+    int getLength() const;
+    
+    /**
+     * Returns the zero-terminated contents. The pointer is only valid until the buffer is next modified.
+     */
+    const char *getData() const;
+};
 
-ErrorContextAutostack::~ErrorContextAutostack()
-{
-    if( errorSession != NULL )
-    {
-        errorSession->popErrorContext();
-    }
-}
+#endif //H_INLINE_DATA_BUFFER
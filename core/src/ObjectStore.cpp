@@ -72,7 +72,58 @@ FmlObjectHandle ObjectStore::addObject( FieldmlObject *object )
 {
     //TODO Uniqueness check
     objects.push_back( object );
-    return objects.size() - 1;
+    
+    FmlObjectHandle handle = objects.size() - 1;
+    nameIndex.insert( pair<string, FmlObjectHandle>( object->name, handle ) );
+    
+    return handle;
+}
+
+
+void ObjectStore::truncate( int count )
+{
+    if( ( count < 0 ) || ( count >= (int)objects.size() ) )
+    {
+        return;
+    }
+    
+    for_each( objects.begin() + count, objects.end(), FmlUtil::delete_object() );
+    objects.erase( objects.begin() + count, objects.end() );
+    retired.erase( retired.lower_bound( count ), retired.end() );
+    
+    rebuildNameIndex();
+}
+
+
+void ObjectStore::setRetired( const vector<FmlObjectHandle> &handles, bool isRetired )
+{
+    for( vector<FmlObjectHandle>::const_iterator i = handles.begin(); i != handles.end(); i++ )
+    {
+        if( isRetired )
+        {
+            retired.insert( *i );
+        }
+        else
+        {
+            retired.erase( *i );
+        }
+    }
+    
+    rebuildNameIndex();
+}
+
+
+void ObjectStore::rebuildNameIndex()
+{
+    nameIndex.clear();
+    
+    for( unsigned int i = 0; i < objects.size(); i++ )
+    {
+        if( retired.count( i ) == 0 )
+        {
+            nameIndex.insert( pair<string, FmlObjectHandle>( objects[i]->name, i ) );
+        }
+    }
 }
 
 
@@ -138,14 +189,11 @@ FmlObjectHandle ObjectStore::getObjectByIndex( int index, FieldmlHandleType type
 
 FmlObjectHandle ObjectStore::getObjectByName( const string name )
 {
-    for( unsigned int i = 0; i < objects.size(); i++ )
+    map<string, FmlObjectHandle>::const_iterator i = nameIndex.find( name );
+    if( i == nameIndex.end() )
     {
-        FieldmlObject *object = objects[i];
-        if( object->name == name )
-        {
-            return i;
-        }
+        return FML_INVALID_HANDLE;
     }
     
-    return FML_INVALID_HANDLE;
+    return i->second;
 }
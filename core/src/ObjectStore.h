@@ -43,6 +43,9 @@
 #define H_OBJECT_STORE
 
 #include <vector>
+#include <map>
+#include <set>
+#include <string>
 
 #include "fieldml_structs.h"
 
@@ -51,6 +54,14 @@ class ObjectStore
 private:
     std::vector<FieldmlObject *> objects;
     
+    //NOTE: Declared names are not unique across regions. The first object added with a given name wins, as per getObjectByName.
+    std::map<std::string, FmlObjectHandle> nameIndex;
+    
+    //Objects that are still valid, but are no longer found by name.
+    std::set<FmlObjectHandle> retired;
+    
+    void rebuildNameIndex();
+    
 public:
     ObjectStore();
     
@@ -60,6 +71,17 @@ public:
     
     FmlObjectHandle addObject( FieldmlObject *object );
     
+    /**
+     * Deletes every object added after the first count, so that the store is as it was when it held count objects.
+     */
+    void truncate( int count );
+    
+    /**
+     * Stops the given objects from being found by name, or lets them be found again, so that the next object with the
+     * same name is found in their place. The objects themselves are unaffected.
+     */
+    void setRetired( const std::vector<FmlObjectHandle> &handles, bool isRetired );
+    
     int getCount();
     
     int getCount( FieldmlHandleType type );
@@ -1,44 +1,45 @@
-/* \file
- * $Id$
- * \author Caton Little
- * \brief 
- *
- * \section LICENSE
- *
- * Version: MPL 1.1/GPL 2.0/LGPL 2.1
- *
- * The contents of this file are subject to the Mozilla Public License
- * Version 1.1 (the "License"); you may not use this file except in
- * compliance with the License. You may obtain a copy of the License at
- * http://www.mozilla.org/MPL/
- *
- * Software distributed under the License is distributed on an "AS IS"
- * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
- * License for the specific language governing rights and limitations
- * under the License.
- *
- * The Original Code is FieldML
- *
- * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
- * Auckland, New Zealand. Portions created by the Initial Developer are
- * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
- *
- * Contributor(s):
- *
- * Alternatively, the contents of this file may be used under the terms of
- * either the GNU General Public License Version 2 or later (the "GPL"), or
- * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
- * in which case the provisions of the GPL or the LGPL are applicable instead
- * of those above. If you wish to allow use of your version of this file only
- * under the terms of either the GPL or the LGPL, and not to allow others to
- * use your version of this file under the terms of the MPL, indicate your
- * decision by deleting the provisions above and replace them with the notice
- * and other provisions required by the GPL or the LGPL. If you do not delete
- * the provisions above, a recipient may use your version of this file under
- * the terms of any one of the MPL, the GPL or the LGPL.
- *
- */
-
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <algorithm>
 #include <cstddef>
 
 #include "SimpleBitset.h"
@@ -51,94 +52,165 @@ static const int BITS_PER_INT = 32;
 
 static const int INTS_PER_CHUNK = BITS_PER_CHUNK / BITS_PER_INT; 
 
+
+/**
+ * Returns the number of set bits in the given word, using the hardware instruction where the compiler offers one.
+ */
+static inline int countBits( unsigned int word )
+{
+#if defined( __GNUC__ )
+    return __builtin_popcount( word );
+#else
+    word = word - ( ( word >> 1 ) & 0x55555555u );
+    word = ( word & 0x33333333u ) + ( ( word >> 2 ) & 0x33333333u );
+    return (int)( ( ( ( word + ( word >> 4 ) ) & 0x0F0F0F0Fu ) * 0x01010101u ) >> 24 );
+#endif
+}
+
+
 /**
- * BitChunk - A helper class we don't want to expose to the outside world.
+ * Returns the position of the lowest set bit in the given non-zero word.
+ */
+static inline int lowestBit( unsigned int word )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( word );
+#else
+    int bit = 0;
+    while( ( word & 1u ) == 0 )
+    {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+
+/**
+ * BitChunk - A helper class we don't want to expose to the outside world. 
  */
 class BitChunk
 {
 public:
     int bitCount;
     
-    BitChunk( int _firstBit );
+    BitChunk();
     
-    void set( int bitNumber, bool state );
+    bool set( int chunkBit, bool state );
     
-    bool get( int bitNumber );
+    bool get( int chunkBit );
     
-    void clear();
+    int getRank( int chunkBit );
     
-    const int firstBit;
+    int getTrueBit( int rank );
     
     unsigned int bits[INTS_PER_CHUNK];
 };
 
 
-BitChunk::BitChunk( int _firstBit ) :
-    firstBit( _firstBit )
+BitChunk::BitChunk()
 {
-    clear();
+    bitCount = 0;
+
+    for( int i = 0; i < INTS_PER_CHUNK; i++ )
+    {
+        bits[i] = 0;
+    }
 }
 
 
-void BitChunk::set( int bitNumber, bool state )
+/**
+ * Returns true if the bit changed state.
+ */
+bool BitChunk::set( int chunkBit, bool state )
 {
-    int chunkBit = bitNumber & (BITS_PER_CHUNK-1);
-    
     int chunkInt = chunkBit / BITS_PER_INT;
     
-    int intBit = chunkBit & (BITS_PER_INT-1);
+    unsigned int mask = 1u << ( chunkBit & (BITS_PER_INT-1) );
     
-    bool oldState = ( bits[chunkInt] & ( 1 << intBit ) ) != 0;
+    bool oldState = ( bits[chunkInt] & mask ) != 0;
     
     if( state && !oldState )
     {
-        bits[chunkInt] |= ( 1 << intBit );
+        bits[chunkInt] |= mask;
         bitCount++;
+        return true;
     }
     else if( oldState && !state )
     {
-        bits[chunkInt] &= ~( 1 << intBit );
+        bits[chunkInt] &= ~mask;
         bitCount--;
+        return true;
     }
+    
+    return false;
 }
 
 
-bool BitChunk::get( int bitNumber )
+bool BitChunk::get( int chunkBit )
 {
-    int chunkBit = bitNumber & (BITS_PER_CHUNK-1);
-    
     int chunkInt = chunkBit / BITS_PER_INT;
     
     int intBit = chunkBit & (BITS_PER_INT-1);
     
-    return ( bits[chunkInt] & ( 1 << intBit ) ) != 0;
+    return ( bits[chunkInt] & ( 1u << intBit ) ) != 0;
 }
 
 
-void BitChunk::clear()
+/**
+ * Returns the number of true bits before the given bit.
+ */
+int BitChunk::getRank( int chunkBit )
 {
-    bitCount = 0;
+    int chunkInt = chunkBit / BITS_PER_INT;
+    
+    int intBit = chunkBit & (BITS_PER_INT-1);
+    
+    int rank = 0;
+    for( int i = 0; i < chunkInt; i++ )
+    {
+        rank += countBits( bits[i] );
+    }
+    
+    return rank + countBits( bits[chunkInt] & ( ( 1u << intBit ) - 1u ) );
+}
 
+
+/**
+ * Returns the bit that has exactly rank true bits before it. The rank must be less than bitCount.
+ */
+int BitChunk::getTrueBit( int rank )
+{
     for( int i = 0; i < INTS_PER_CHUNK; i++ )
     {
-        bits[i] = 0;
+        unsigned int word = bits[i];
+        int wordCount = countBits( word );
+        if( rank < wordCount )
+        {
+            for( ; rank > 0; rank-- )
+            {
+                word &= word - 1u;
+            }
+            return ( i * BITS_PER_INT ) + lowestBit( word );
+        }
+        rank -= wordCount;
     }
+    
+    return -1;
 }
 
 
-SimpleBitset::SimpleBitset()
+SimpleBitset::SimpleBitset() :
+    ranksValid( true ),
+    bitCount( 0 )
 {
 }
 
 
 SimpleBitset::~SimpleBitset()
 {
-    BitChunk *chunk;
-    for( list<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
-    {
-        chunk = *i;
-        delete chunk;
-    }
+    clear();
 }
 
 
@@ -149,62 +221,46 @@ BitChunk *SimpleBitset::getChunk( int bitNumber, bool create )
         return NULL;
     }
     
-    BitChunk *chunk = NULL;
-    list<BitChunk *>::iterator i;
-    for( i = chunks.begin(); i != chunks.end(); i++ )
+    unsigned int chunkIndex = bitNumber / BITS_PER_CHUNK;
+    if( chunkIndex >= chunks.size() )
     {
-        chunk = *i;
-        if( ( bitNumber >= chunk->firstBit ) && ( bitNumber < chunk->firstBit + BITS_PER_CHUNK ) )
-        {
-            return chunk;
-        }
-        if( bitNumber < chunk->firstBit )
+        if( !create )
         {
-            break;
+            return NULL;
         }
+        chunks.resize( chunkIndex + 1, NULL );
+        ranksValid = false;
     }
     
-    if( create )
+    if( ( chunks[chunkIndex] == NULL ) && create )
     {
-        int chunkFirst = bitNumber & ~(BITS_PER_CHUNK-1); 
-        chunk = new BitChunk( chunkFirst );
-        if( i == chunks.begin() )
-        {
-            chunks.push_front( chunk );
-        }
-        else
-        {
-            chunks.insert( i, chunk );
-        }
+        chunks[chunkIndex] = new BitChunk();
     }
     
-    return chunk;
+    return chunks[chunkIndex];
 }
 
 
-BitChunk *SimpleBitset::getNextChunk( int bitNumber )
+void SimpleBitset::updateRanks()
 {
-    if( bitNumber < 0 )
+    if( ranksValid )
     {
-        return NULL;
+        return;
     }
     
-    BitChunk *bestChunk = NULL;
-    BitChunk *chunk = NULL;
-    for( list<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
+    chunkRanks.resize( chunks.size() );
+    
+    int rank = 0;
+    for( unsigned int i = 0; i < chunks.size(); i++ )
     {
-        chunk = *i;
-        if( chunk->firstBit + BITS_PER_CHUNK - 1 < bitNumber )
+        chunkRanks[i] = rank;
+        if( chunks[i] != NULL )
         {
-            continue;
-        }
-        else if( ( bestChunk == NULL ) || ( chunk->firstBit < bestChunk->firstBit ) )
-        {
-            bestChunk = chunk;
+            rank += chunks[i]->bitCount;
         }
     }
     
-    return bestChunk;
+    ranksValid = true;
 }
 
 
@@ -217,7 +273,11 @@ void SimpleBitset::setBit( int bitNumber, bool state )
         return;
     }
     
-    chunk->set( bitNumber, state );
+    if( chunk->set( bitNumber & (BITS_PER_CHUNK-1), state ) )
+    {
+        bitCount += state ? 1 : -1;
+        ranksValid = false;
+    }
 }
 
 
@@ -229,101 +289,74 @@ bool SimpleBitset::getBit( int bitNumber )
         return false;
     }
     
-    return chunk->get( bitNumber );
+    return chunk->get( bitNumber & (BITS_PER_CHUNK-1) );
 }
 
 
 int SimpleBitset::getCount()
 {
-    int count = 0;
-    BitChunk *chunk;
-    for( list<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
-    {
-        chunk = *i;
-        count += chunk->bitCount;
-    }
-    
-    return count;
+    return bitCount;
 }
 
 
 void SimpleBitset::clear()
 {
-    BitChunk *chunk;
-    for( list<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
+    for( vector<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
     {
-        chunk = *i;
-        chunk->clear();
+        delete *i;
     }
     
+    chunks.clear();
+    chunkRanks.clear();
+    ranksValid = true;
+    bitCount = 0;
 }
 
 
-int SimpleBitset::getNextTrueBit( int bitNumber )
+int SimpleBitset::getRank( int bitNumber )
 {
-    BitChunk *chunk;
+    if( bitNumber <= 0 )
+    {
+        return 0;
+    }
     
-    while( true )
+    unsigned int chunkIndex = bitNumber / BITS_PER_CHUNK;
+    if( chunkIndex >= chunks.size() )
     {
-        chunk = getNextChunk( bitNumber );
-        
-        if( chunk == NULL )
-        {
-            return -1;
-        }
-        
-        if( chunk->bitCount == 0 )
-        {
-            continue;
-        }
-        
-        for( ; bitNumber < chunk->firstBit + BITS_PER_CHUNK; bitNumber++ )
-        {
-            if( chunk->get( bitNumber ) )
-            {
-                return bitNumber;
-            }
-        }
+        return bitCount;
     }
+    
+    updateRanks();
+    
+    BitChunk *chunk = chunks[chunkIndex];
+    if( chunk == NULL )
+    {
+        return chunkRanks[chunkIndex];
+    }
+    
+    return chunkRanks[chunkIndex] + chunk->getRank( bitNumber & (BITS_PER_CHUNK-1) );
+}
+
+
+int SimpleBitset::getNextTrueBit( int bitNumber )
+{
+    return getTrueBit( getRank( bitNumber ) + 1 );
 }
 
 
 int SimpleBitset::getTrueBit( int bitCount )
 {
-    //This code is a little inefficient, but should do for now.
-    int bitCounter = 0;
-    BitChunk *chunk = NULL;
-    BitChunk *goodChunk = NULL;
-    for( list<BitChunk *>::iterator i = chunks.begin(); i != chunks.end(); i++ )
-    {
-        chunk = *i;
-        if( ( bitCounter < bitCount ) && ( chunk->bitCount + bitCounter >= bitCount ) )
-        {
-            goodChunk = chunk;
-            break;
-        }
-        bitCounter += chunk->bitCount;
-    }
-    
-    if( goodChunk == NULL )
+    if( ( bitCount < 1 ) || ( bitCount > this->bitCount ) )
     {
         return -1;
     }
     
-    bitCount -= bitCounter;
-    int bitNumber = chunk->firstBit;
+    updateRanks();
     
-    for( ; bitNumber < chunk->firstBit + BITS_PER_CHUNK; bitNumber++ )
-    {
-        if( chunk->get( bitNumber ) )
-        {
-            bitCount--;
-            if( bitCount == 0 )
-            {
-                return bitNumber;
-            }
-        }
-    }
+    //The wanted bit is in the last chunk that has fewer true bits before it.
+    int rank = bitCount - 1;
+    vector<int>::const_iterator next = upper_bound( chunkRanks.begin(), chunkRanks.end(), rank );
+    int chunkIndex = ( next - chunkRanks.begin() ) - 1;
     
-    return -1;
+    return ( chunkIndex * BITS_PER_CHUNK ) + chunks[chunkIndex]->getTrueBit( rank - chunkRanks[chunkIndex] );
 }
@@ -42,18 +42,35 @@
 #ifndef H_SIMPLE_BITSET
 #define H_SIMPLE_BITSET
 
-#include <list>
+#include <vector>
 
 class BitChunk;
 
+/**
+ * A set of non-negative integers, stored as fixed-size chunks of bits. Chunks are found directly from the bit number,
+ * and the number of true bits before each chunk is kept so that rank and select queries only search within a
+ * single chunk.
+ */
 class SimpleBitset
 {
 private:
-    std::list<BitChunk *> chunks;
+    //Chunk i holds bits i*BITS_PER_CHUNK onwards, or is NULL if none of them have been set.
+    std::vector<BitChunk *> chunks;
+    
+    //The number of true bits in the chunks before each chunk. Only valid while ranksValid is set.
+    std::vector<int> chunkRanks;
+    
+    bool ranksValid;
+    
+    int bitCount;
     
     BitChunk *getChunk( int bitNumber, bool create );
     
-    BitChunk *getNextChunk( int bitNumber );
+    void updateRanks();
+    
+    SimpleBitset( const SimpleBitset & );
+    
+    SimpleBitset &operator=( const SimpleBitset & );
     
 public:
     SimpleBitset();
@@ -68,8 +85,19 @@ public:
     
     virtual void clear();
     
+    /**
+     * Returns the number of true bits before the given bit.
+     */
+    virtual int getRank( int bitNumber );
+    
+    /**
+     * Returns the first true bit at or after the given bit, or -1 if there is none.
+     */
     virtual int getNextTrueBit( int bitNumber );
     
+    /**
+     * Returns the bitCount'th true bit, counting from 1, or -1 if there are fewer true bits.
+     */
     virtual int getTrueBit( int bitCount );
 };
 
@@ -42,14 +42,25 @@
 #ifndef H_SIMPLE_MAP
 #define H_SIMPLE_MAP
 
+#include <limits>
 #include <vector>
+#include <map>
 #include <set>
 
+/**
+ * A map from integral keys (ensemble values or object handles) to values. Pairs are kept in
+ * insertion order so that index-based access is O(1). Key lookup goes through an index that is
+ * a dense array when the keys are mostly contiguous, and a tree when they are sparse. The map
+ * switches between the two layouts automatically as keys are added.
+ */
 template <typename K, typename V> class SimpleMap
 {
     typedef std::pair<K,V> PairType;
     
 private:
+    //Minimum number of keys before the dense layout is considered.
+    static const int MIN_DENSE_COUNT = 8;
+    
     const V invalidValue;
     bool _hasDefault;
     
@@ -57,30 +68,170 @@ private:
     
     std::vector<PairType> pairs;
     
-    typename std::vector<PairType>::const_iterator find( K key ) const
+    bool isDense;
+    
+    K denseBase;
+    
+    //Position in pairs of each key in [denseBase, denseBase + denseIndex.size() ), or -1.
+    std::vector<int> denseIndex;
+    
+    //The smallest and largest keys indexed since the dense index was built. The index may extend beyond them.
+    K denseMin;
+    
+    K denseMax;
+    
+    std::map<K, int> sparseIndex;
+    
+    
+    int find( K key ) const
     {
-        for( ConstIterator i = pairs.begin(); i != pairs.end(); i++ )
+        if( isDense )
         {
-            if( i->first == key )
+            if( ( key < denseBase ) || ( (double)key - (double)denseBase >= (double)denseIndex.size() ) )
             {
-                return i;
+                return -1;
             }
+            return denseIndex[key - denseBase];
         }
         
-        return pairs.end();
+        typename std::map<K, int>::const_iterator i = sparseIndex.find( key );
+        if( i == sparseIndex.end() )
+        {
+            return -1;
+        }
+        
+        return i->second;
     }
-
-    typename std::vector<PairType>::iterator find( K key )
+    
+    
+    void rebuildIndex()
     {
-        for( Iterator i = pairs.begin(); i != pairs.end(); i++ )
+        denseIndex.clear();
+        sparseIndex.clear();
+        
+        if( pairs.size() == 0 )
         {
-            if( i->first == key )
+            return;
+        }
+        
+        if( isDense )
+        {
+            K min = pairs[0].first;
+            K max = pairs[0].first;
+            for( ConstIterator i = pairs.begin(); i != pairs.end(); i++ )
             {
-                return i;
+                if( i->first < min )
+                {
+                    min = i->first;
+                }
+                if( i->first > max )
+                {
+                    max = i->first;
+                }
             }
+            
+            denseBase = min;
+            denseMin = min;
+            denseMax = max;
+            denseIndex.resize( max - min + 1, -1 );
         }
         
-        return pairs.end();
+        for( unsigned int i = 0; i < pairs.size(); i++ )
+        {
+            setIndex( pairs[i].first, i );
+        }
+    }
+    
+    
+    void setIndex( K key, int position )
+    {
+        if( isDense )
+        {
+            denseIndex[key - denseBase] = position;
+        }
+        else
+        {
+            sparseIndex[key] = position;
+        }
+    }
+    
+    
+    void addToIndex( K key, int position )
+    {
+        const double count = pairs.size();
+        
+        if( !isDense )
+        {
+            sparseIndex[key] = position;
+            
+            if( count >= MIN_DENSE_COUNT )
+            {
+                const double span = (double)sparseIndex.rbegin()->first - (double)sparseIndex.begin()->first + 1;
+                if( span <= 2 * count )
+                {
+                    isDense = true;
+                    rebuildIndex();
+                }
+            }
+            return;
+        }
+        
+        const double min = ( key < denseMin ) ? key : denseMin;
+        const double max = ( key > denseMax ) ? key : denseMax;
+        
+        //Hysteresis between the dense and sparse thresholds stops the layout from flip-flopping.
+        if( max - min + 1 > ( 4 * count ) + 64 )
+        {
+            isDense = false;
+            rebuildIndex();
+            return;
+        }
+        
+        if( key < denseBase )
+        {
+            //The front grows geometrically, as the back of a vector does, so that keys added in descending order do
+            //not shift the whole index every time.
+            double grow = (double)denseBase - key;
+            if( ( grow < denseIndex.size() ) && ( (double)denseBase - denseIndex.size() >= (double)std::numeric_limits<K>::min() ) )
+            {
+                grow = denseIndex.size();
+            }
+            denseIndex.insert( denseIndex.begin(), (size_t)grow, -1 );
+            denseBase = (K)( (double)denseBase - grow );
+        }
+        else if( (double)key - denseBase >= (double)denseIndex.size() )
+        {
+            denseIndex.resize( key - denseBase + 1, -1 );
+        }
+        
+        if( key < denseMin )
+        {
+            denseMin = key;
+        }
+        if( key > denseMax )
+        {
+            denseMax = key;
+        }
+        
+        setIndex( key, position );
+    }
+    
+    
+    void removeFromIndex( K key, int position )
+    {
+        if( isDense )
+        {
+            denseIndex[key - denseBase] = -1;
+        }
+        else
+        {
+            sparseIndex.erase( key );
+        }
+        
+        for( unsigned int i = position; i < pairs.size(); i++ )
+        {
+            setIndex( pairs[i].first, i );
+        }
     }
 
 public:
@@ -92,6 +243,10 @@ public:
     {
         _hasDefault = false;
         defaultValue = invalidValue;
+        isDense = false;
+        denseBase = 0;
+        denseMin = 0;
+        denseMax = 0;
     }
 
 
@@ -116,11 +271,11 @@ public:
     
     const V get( K key, bool allowDefault )
     {
-        ConstIterator iter = find( key );
+        int position = find( key );
         
-        if( iter != end() )
+        if( position >= 0 )
         {
-            return iter->second;
+            return pairs[position].second;
         }
         else if( !allowDefault )
         {
@@ -135,13 +290,14 @@ public:
     
     V set( K key, V value )
     {
-        Iterator iter = find( key );
+        int position = find( key );
         
-        if( iter == end() )
+        if( position < 0 )
         {
             if( ( value != invalidValue ) && ( value != defaultValue ) )
             {
                 pairs.push_back( PairType( key, value ) );
+                addToIndex( key, pairs.size() - 1 );
             }
             return invalidValue;
         }
@@ -149,19 +305,20 @@ public:
         {
             if( ( value == invalidValue ) || ( value == defaultValue ) )
             {
-                pairs.erase( iter );
+                pairs.erase( pairs.begin() + position );
+                removeFromIndex( key, position );
                 return invalidValue;
             }
             else
             {
-                V previousValue = iter->second;
-                iter->second = value;
+                V previousValue = pairs[position].second;
+                pairs[position].second = value;
                 
                 return previousValue;
             }
         }
     }
-    
+
     
     const K getKey( int index )
     {
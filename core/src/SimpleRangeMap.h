@@ -0,0 +1,387 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_SIMPLE_RANGE_MAP
+#define H_SIMPLE_RANGE_MAP
+
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+/**
+ * A map from integral keys (typically ensemble values) to values, stored as runs of consecutive
+ * keys sharing the same value. Memory use scales with the number of distinct runs rather than
+ * with the number of keys, and lookup is O(log runs).
+ * 
+ * The interface mirrors SimpleMap. Index-based access (getKey/getValue) enumerates keys in
+ * ascending order. It uses a run directory which is rebuilt lazily after the map is modified.
+ */
+template <typename K, typename V> class SimpleRangeMap
+{
+    struct Range
+    {
+        K last;
+        V value;
+        
+        Range( K _last, V _value ) :
+            last( _last ), value( _value ) {}
+    };
+    
+    typedef std::map<K, Range> RangeMapType;
+    typedef typename RangeMapType::iterator RangeIterator;
+    typedef typename RangeMapType::const_iterator ConstRangeIterator;
+    
+private:
+    const V invalidValue;
+    bool _hasDefault;
+    
+    V defaultValue;
+    
+    //Keyed on the first key of each run.
+    RangeMapType ranges;
+    
+    int count;
+    
+    bool directoryIsValid;
+    
+    std::vector<ConstRangeIterator> directory;
+    
+    //The number of keys preceding each run in directory.
+    std::vector<int> directoryOffsets;
+    
+    
+    ConstRangeIterator findRange( K key ) const
+    {
+        ConstRangeIterator i = ranges.upper_bound( key );
+        if( i == ranges.begin() )
+        {
+            return ranges.end();
+        }
+        
+        i--;
+        if( i->second.last < key )
+        {
+            return ranges.end();
+        }
+        
+        return i;
+    }
+    
+    
+    void buildDirectory()
+    {
+        if( directoryIsValid )
+        {
+            return;
+        }
+        
+        directory.clear();
+        directoryOffsets.clear();
+        
+        int offset = 0;
+        for( ConstRangeIterator i = ranges.begin(); i != ranges.end(); i++ )
+        {
+            directory.push_back( i );
+            directoryOffsets.push_back( offset );
+            offset += ( i->second.last - i->first ) + 1;
+        }
+        
+        directoryIsValid = true;
+    }
+    
+    
+    //Returns the run containing the nth key (zero-based), and sets offset to the key's offset within that run.
+    ConstRangeIterator findKeyByIndex( int index, int &offset )
+    {
+        buildDirectory();
+        
+        std::vector<int>::const_iterator i = std::upper_bound( directoryOffsets.begin(), directoryOffsets.end(), index );
+        const int rangeIndex = ( i - directoryOffsets.begin() ) - 1;
+        
+        offset = index - directoryOffsets[rangeIndex];
+        return directory[rangeIndex];
+    }
+    
+    
+    void insertRange( K first, K last, V value )
+    {
+        ranges.insert( std::pair<K, Range>( first, Range( last, value ) ) );
+        count += ( last - first ) + 1;
+    }
+    
+    
+    //Removes [first, last] from the map, trimming or splitting any runs that overlap it.
+    void clearRange( K first, K last )
+    {
+        RangeIterator i = ranges.lower_bound( first );
+        if( i != ranges.begin() )
+        {
+            RangeIterator previous = i;
+            previous--;
+            
+            if( previous->second.last >= first )
+            {
+                const K previousLast = previous->second.last;
+                const V previousValue = previous->second.value;
+                
+                count -= ( previousLast - first ) + 1;
+                previous->second.last = first - 1;
+                
+                if( previousLast > last )
+                {
+                    insertRange( last + 1, previousLast, previousValue );
+                    return;
+                }
+            }
+        }
+        
+        while( ( i != ranges.end() ) && ( i->first <= last ) )
+        {
+            const K rangeLast = i->second.last;
+            const V rangeValue = i->second.value;
+            
+            count -= ( rangeLast - i->first ) + 1;
+            ranges.erase( i++ );
+            
+            if( rangeLast > last )
+            {
+                insertRange( last + 1, rangeLast, rangeValue );
+                break;
+            }
+        }
+    }
+    
+    
+    //Merges the run starting at first with its neighbours, if they are adjacent and share its value.
+    void mergeRange( K first )
+    {
+        RangeIterator i = ranges.find( first );
+        if( i == ranges.end() )
+        {
+            return;
+        }
+        
+        RangeIterator next = i;
+        next++;
+        if( ( next != ranges.end() ) && ( next->first - 1 == i->second.last ) && ( next->second.value == i->second.value ) )
+        {
+            i->second.last = next->second.last;
+            ranges.erase( next );
+        }
+        
+        if( i != ranges.begin() )
+        {
+            RangeIterator previous = i;
+            previous--;
+            if( ( previous->second.last + 1 == i->first ) && ( previous->second.value == i->second.value ) )
+            {
+                previous->second.last = i->second.last;
+                ranges.erase( i );
+            }
+        }
+    }
+
+public:
+    SimpleRangeMap( const V _invalidValue ) :
+        invalidValue( _invalidValue )
+    {
+        _hasDefault = false;
+        defaultValue = invalidValue;
+        count = 0;
+        directoryIsValid = false;
+    }
+
+
+    int size()
+    {
+        return count;
+    }
+    
+    
+    const V get( K key, bool allowDefault )
+    {
+        ConstRangeIterator i = findRange( key );
+        
+        if( i != ranges.end() )
+        {
+            return i->second.value;
+        }
+        else if( !allowDefault )
+        {
+            return invalidValue;
+        }
+        else
+        {
+            return defaultValue;
+        }
+    }
+    
+    
+    V set( K key, V value )
+    {
+        V previousValue = get( key, false );
+        
+        if( previousValue != value )
+        {
+            setRange( key, key, value );
+        }
+        
+        return previousValue;
+    }
+    
+    
+    /**
+     * Associates every key in [first, last] with the given value. As with set, the invalid value and
+     * the default value remove the association.
+     */
+    void setRange( K first, K last, V value )
+    {
+        if( last < first )
+        {
+            return;
+        }
+        
+        directoryIsValid = false;
+        
+        clearRange( first, last );
+        
+        if( ( value != invalidValue ) && ( value != defaultValue ) )
+        {
+            insertRange( first, last, value );
+            mergeRange( first );
+        }
+    }
+    
+    
+    const K getKey( int index )
+    {
+        if( ( index < 0 ) || ( index >= count ) )
+        {
+            return K();
+        }
+        
+        int offset;
+        ConstRangeIterator i = findKeyByIndex( index, offset );
+        
+        return i->first + offset;
+    }
+    
+    
+    const V getValue( int index )
+    {
+        if( ( index < 0 ) || ( index >= count ) )
+        {
+            return invalidValue;
+        }
+        
+        int offset;
+        ConstRangeIterator i = findKeyByIndex( index, offset );
+        
+        return i->second.value;
+    }
+    
+    
+    int getRangeCount()
+    {
+        return ranges.size();
+    }
+    
+    
+    const K getRangeMin( int index )
+    {
+        buildDirectory();
+        return directory[index]->first;
+    }
+    
+    
+    const K getRangeMax( int index )
+    {
+        buildDirectory();
+        return directory[index]->second.last;
+    }
+    
+    
+    const V getRangeValue( int index )
+    {
+        buildDirectory();
+        return directory[index]->second.value;
+    }
+    
+    
+    void setDefault( const V _default )
+    {
+        defaultValue = _default;
+        
+        _hasDefault = (defaultValue != invalidValue);
+    }
+    
+    
+    bool hasDefault()
+    {
+        return _hasDefault;
+    }
+    
+    
+    const V getDefault()
+    {
+        return defaultValue;
+    }
+    
+    
+    std::set<V> getValues()
+    {
+        std::set<V> values;
+        for( ConstRangeIterator i = ranges.begin(); i != ranges.end(); i++ )
+        {
+            values.insert( i->second.value );
+        }
+        
+        if( defaultValue != invalidValue )
+        {
+            values.insert( defaultValue );
+        }
+        
+        return values;
+    }
+};
+
+#endif // H_SIMPLE_RANGE_MAP
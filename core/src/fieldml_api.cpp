@@ -41,6 +41,8 @@
 
 #include <algorithm>
 
+#include <climits>
+
 #include <cstring>
 
 #include "String_InternalLibrary.h"
@@ -139,7 +141,7 @@ static FmlObjectHandle addObject( FieldmlSession *session, FieldmlObject *object
 }
 
 
-static SimpleMap<FmlEnsembleValue, FmlObjectHandle> *getEvaluatorMap( FieldmlSession *session, FmlObjectHandle objectHandle )
+static SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *getEvaluatorMap( FieldmlSession *session, FmlObjectHandle objectHandle )
 {
     ERROR_AUTOSTACK( session );
 
@@ -199,16 +201,16 @@ static SimpleMap<FmlObjectHandle, FmlObjectHandle> *getBindMap( FieldmlSession *
 }
 
 
-static vector<FmlObjectHandle> getArgumentList( FieldmlSession *session, FmlObjectHandle objectHandle, bool isBound, bool isUsed )
+static const vector<FmlObjectHandle> *getArgumentList( FieldmlSession *session, FmlObjectHandle objectHandle, bool isBound, bool isUsed )
 {
-    vector<FmlObjectHandle> args;
+    static const vector<FmlObjectHandle> noArguments;
 
     ERROR_AUTOSTACK( session );
 
     FieldmlObject *object = getObject( session, objectHandle );
     if( object == NULL )
     {
-        return args;
+        return &noArguments;
     }
 
     Evaluator *evaluator = Evaluator::checkedCast( session, objectHandle );
@@ -216,42 +218,35 @@ static vector<FmlObjectHandle> getArgumentList( FieldmlSession *session, FmlObje
     if( evaluator == NULL )
     {
         session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot get arguments. Must be an evalator." );
-        return args;
+        return &noArguments;
     }
 
     if ( isBound && !isUsed )
     {
         //Always an empty set with the current algorithm, as it only tracks unbound or used arguments.
-        return args;
+        return &noArguments;
     }
     if( !isBound && !isUsed )
     {
         //Always an empty set with the current algorithm, as it assumes that arguments of arguments are used.
-        return args;
+        return &noArguments;
     }
     
-    set<FmlObjectHandle> unbound, used;
-    session->getArguments( objectHandle, unbound, used, false );
+    const vector<FmlObjectHandle> *unbound, *used, *bound;
+    if( !session->getArguments( objectHandle, unbound, used, bound ) )
+    {
+        session->setError( FML_ERR_CYCLIC_DEPENDENCY, objectHandle, "Cannot get arguments. Cyclic dependancy." );
+        return &noArguments;
+    }
     
     if( isBound && isUsed )
     {
-        for( set<FmlObjectHandle>::const_iterator i = used.begin(); i != used.end(); i++ )
-        {
-						//	Performance wise, I am not sure I should remove all elems from
-						//	unbound in used or using find as shown below.
-						if (unbound.end() == unbound.find(*i))
-								args.push_back( *i );
-        }
-        return args;
+        return bound;
     }
     else //if( !isBound && isUsed )
     {
         //In used, and in unbound. Unbound is always is a subset of used with the current algorithm.
-        for( set<FmlObjectHandle>::const_iterator i = unbound.begin(); i != unbound.end(); i++ )
-        {
-            args.push_back( *i );
-        }
-        return args;
+        return unbound;
     }
 }
 
@@ -260,9 +255,8 @@ static bool checkCyclicDependency( FieldmlSession *session, FmlObjectHandle obje
 {
     ERROR_AUTOSTACK( session );
 
-    set<FmlObjectHandle> delegates;
-    session->getDelegateEvaluators( objectDependancy, delegates );
-    if( FmlUtil::contains( delegates, objectHandle ) )
+    const vector<FmlObjectHandle> *delegates = session->getDelegateEvaluators( objectDependancy );
+    if( ( objectHandle == objectDependancy ) || ( delegates == NULL ) || binary_search( delegates->begin(), delegates->end(), objectHandle ) )
     {
         session->setError( FML_ERR_CYCLIC_DEPENDENCY, objectHandle, "Cyclic dependancy." );
         return false;
@@ -482,6 +476,63 @@ static bool checkIsEvaluatorTypeCompatible( FieldmlSession *session, FmlObjectHa
 }
 
 
+static bool checkDelegateEvaluator( FieldmlSession *session, FmlObjectHandle objectHandle, FmlObjectHandle evaluator )
+{
+    ERROR_AUTOSTACK( session );
+
+    if( !checkLocal( session, evaluator ) )
+    {
+        return false;
+    }
+    
+    if( evaluator == FML_INVALID_HANDLE )
+    {
+        //Removes the association, so there is nothing to type-check.
+        return true;
+    }
+
+    if( Fieldml_GetObjectType( session->getSessionHandle(), objectHandle ) == FHT_AGGREGATE_EVALUATOR )
+    {
+        if( !checkIsEvaluatorType( session, evaluator, true, false, false ) )
+        {
+            session->setError( FML_ERR_INVALID_PARAMETER_3, evaluator, "Invalid type for aggregator delegate." );
+            return false;
+        }
+    }
+    else if( !checkIsEvaluatorTypeCompatible( session, objectHandle, evaluator ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Incompatible type for delegate evaluator." );
+        return false;
+    }
+
+    return checkCyclicDependency( session, objectHandle, evaluator );
+}
+
+
+/**
+ * Checks every evaluator in the given array as checkDelegateEvaluator does, each distinct one only once. Everything is
+ * checked before anything is assigned, so that a bad entry leaves the object untouched.
+ */
+static bool checkDelegateEvaluators( FieldmlSession *session, FmlObjectHandle objectHandle, int count, const FmlObjectHandle *evaluators )
+{
+    set<FmlObjectHandle> checked;
+    for( int i = 0; i < count; i++ )
+    {
+        if( checked.count( evaluators[i] ) != 0 )
+        {
+            continue;
+        }
+        if( !checkDelegateEvaluator( session, objectHandle, evaluators[i] ) )
+        {
+            return false;
+        }
+        checked.insert( evaluators[i] );
+    }
+    
+    return true;
+}
+
+
 //========================================================================
 //
 // API
@@ -489,9 +540,17 @@ static bool checkIsEvaluatorTypeCompatible( FieldmlSession *session, FmlObjectHa
 //========================================================================
 
 FmlSessionHandle Fieldml_CreateFromFile( const char * filename )
+{
+    return Fieldml_CreateFromFileWithOptions( filename, FML_PARSE_DEFAULT );
+}
+
+
+FmlSessionHandle Fieldml_CreateFromFileWithOptions( const char * filename, int parseOptions )
 {
     FieldmlSession *session = new FieldmlSession();
-    ErrorContextAutostack bob( session, __FILE__, __LINE__, __ECA_FUNC__ );
+    ERROR_AUTOSTACK( session );
+    
+    session->setParseOptions( parseOptions );
     
     if( filename == NULL )
     {
@@ -515,6 +574,64 @@ FmlSessionHandle Fieldml_CreateFromFile( const char * filename )
 }
 
 
+FmlSessionHandle Fieldml_CreateFromBuffer( const char * buffer, size_t length, const char * baseUrl, int parseOptions )
+{
+    FieldmlSession *session = new FieldmlSession();
+    ERROR_AUTOSTACK( session );
+    
+    session->setParseOptions( parseOptions );
+    
+    if( buffer == NULL )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_1, "Cannot create FieldML session. Invalid buffer." );
+    }
+    else
+    {
+        const string url = ( baseUrl != NULL ) ? baseUrl : "";
+        session->region = session->addBufferRegion( url, buffer, length );
+        if( session->region == NULL )
+        {
+            session->setError( FML_ERR_READ_ERR, "Cannot create FieldML session. Invalid document or read error." );
+        }
+        else
+        {
+            session->region->finalize();
+        }
+    }
+    
+    return session->getSessionHandle();
+}
+
+
+FmlSessionHandle Fieldml_CreateFromCallback( FmlReadCallback callback, void * context, const char * baseUrl, int parseOptions )
+{
+    FieldmlSession *session = new FieldmlSession();
+    ERROR_AUTOSTACK( session );
+    
+    session->setParseOptions( parseOptions );
+    
+    if( callback == NULL )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_1, "Cannot create FieldML session. Invalid callback." );
+    }
+    else
+    {
+        const string url = ( baseUrl != NULL ) ? baseUrl : "";
+        session->region = session->addCallbackRegion( url, callback, context );
+        if( session->region == NULL )
+        {
+            session->setError( FML_ERR_READ_ERR, "Cannot create FieldML session. Invalid document or read error." );
+        }
+        else
+        {
+            session->region->finalize();
+        }
+    }
+    
+    return session->getSessionHandle();
+}
+
+
 FmlSessionHandle Fieldml_Create( const char * location, const char * name )
 {
     FieldmlSession *session = new FieldmlSession();
@@ -566,6 +683,12 @@ FmlErrorNumber Fieldml_GetLastError( FmlSessionHandle handle )
 
 
 FmlErrorNumber Fieldml_WriteFile( FmlSessionHandle handle, const char * filename )
+{
+    return Fieldml_WriteFileWithOptions( handle, filename, FML_WRITE_DEFAULT );
+}
+
+
+FmlErrorNumber Fieldml_WriteFileWithOptions( FmlSessionHandle handle, const char * filename, int writeOptions )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
     ERROR_AUTOSTACK( session );
@@ -586,7 +709,73 @@ FmlErrorNumber Fieldml_WriteFile( FmlSessionHandle handle, const char * filename
     session->setError( FML_ERR_NO_ERROR, "" );
     session->region->setRoot( getDirectory( filename ) );
 
-    return writeFieldmlFile( session, handle, filename );
+    if( writeFieldmlFile( session, handle, filename, writeOptions ) != 0 )
+    {
+        return session->setError( FML_ERR_WRITE_ERR, "Cannot write FieldML file." );
+    }
+    
+    return FML_ERR_NO_ERROR;
+}
+
+
+FmlErrorNumber Fieldml_WriteToCallback( FmlSessionHandle handle, FmlWriteCallback callback, void * context, int writeOptions )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+    
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+    if( session->region == NULL )
+    {
+        return session->setError( FML_ERR_INVALID_REGION, "Cannot write FieldML document. FieldML session has no region." );
+    }
+    if( callback == NULL )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_2, "Cannot write FieldML document. Invalid callback." );
+    }
+        
+    session->setError( FML_ERR_NO_ERROR, "" );
+
+    if( writeFieldmlCallback( session, handle, callback, context, writeOptions ) != 0 )
+    {
+        return session->setError( FML_ERR_WRITE_ERR, "Cannot write FieldML document." );
+    }
+    
+    return FML_ERR_NO_ERROR;
+}
+
+
+int Fieldml_WriteToBuffer( FmlSessionHandle handle, char * buffer, int bufferLength, int writeOptions )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+    
+    if( session == NULL )
+    {
+        return -1;
+    }
+    if( session->region == NULL )
+    {
+        session->setError( FML_ERR_INVALID_REGION, "Cannot write FieldML document. FieldML session has no region." );
+        return -1;
+    }
+    if( ( bufferLength < 0 ) || ( ( buffer == NULL ) && ( bufferLength > 0 ) ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_2, "Cannot write FieldML document. Invalid buffer." );
+        return -1;
+    }
+        
+    session->setError( FML_ERR_NO_ERROR, "" );
+
+    int length = writeFieldmlBuffer( session, handle, buffer, bufferLength, writeOptions );
+    if( length < 0 )
+    {
+        session->setError( FML_ERR_WRITE_ERR, "Cannot write FieldML document." );
+    }
+    
+    return length;
 }
 
 
@@ -741,6 +930,53 @@ FmlObjectHandle Fieldml_GetObjectByIndex( FmlSessionHandle handle, const int obj
 }
 
 
+int Fieldml_GetLocalObjectCount( FmlSessionHandle handle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+    if( session->region == NULL )
+    {
+        session->setError( FML_ERR_INVALID_REGION, "FieldML session has no region" );
+        return -1;
+    }
+        
+    session->setError( FML_ERR_NO_ERROR, "" );
+    return session->region->getLocalObjects().size();
+}
+
+
+FmlObjectHandle Fieldml_GetLocalObjectByIndex( FmlSessionHandle handle, const int objectIndex )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_INVALID_HANDLE;
+    }
+    if( session->region == NULL )
+    {
+        session->setError( FML_ERR_INVALID_REGION, "FieldML session has no region" );
+        return FML_INVALID_HANDLE;
+    }
+    
+    const vector<FmlObjectHandle> &localObjects = session->region->getLocalObjects();
+    if( ( objectIndex <= 0 ) || ( (unsigned int)objectIndex > localObjects.size() ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_2, "Invalid local object index." );
+        return FML_INVALID_HANDLE;
+    }
+        
+    session->setError( FML_ERR_NO_ERROR, "" );
+    return localObjects[objectIndex - 1];
+}
+
+
 int Fieldml_GetObjectCount( FmlSessionHandle handle, FieldmlHandleType type )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -1615,12 +1851,14 @@ FmlErrorNumber Fieldml_SetParameterDataDescription( FmlSessionHandle handle, Fml
 
         if( description == FML_DATA_DESCRIPTION_DOK_ARRAY )
         {
+            session->invalidateDependencies( objectHandle );
             delete parameter->dataDescription;
             parameter->dataDescription = new DokArrayDataDescription();
             return session->getLastError();
         }
         else if( description == FML_DATA_DESCRIPTION_DENSE_ARRAY )
         {
+            session->invalidateDependencies( objectHandle );
             delete parameter->dataDescription;
             parameter->dataDescription = new DenseArrayDataDescription();
             return session->getLastError();
@@ -1846,6 +2084,7 @@ FmlErrorNumber Fieldml_AddDenseIndexEvaluator( FmlSessionHandle handle, FmlObjec
     ParameterEvaluator *parameter = ParameterEvaluator::checkedCast( session, objectHandle );
     if( parameter != NULL )
     {
+        session->invalidateDependencies( objectHandle );
         FmlErrorNumber error = parameter->dataDescription->addIndexEvaluator( false, indexHandle, orderHandle );
         return session->setError( error, objectHandle, "Cannot set dense index evaluator." );
     }
@@ -1886,6 +2125,7 @@ FmlErrorNumber Fieldml_AddSparseIndexEvaluator( FmlSessionHandle handle, FmlObje
     ParameterEvaluator *parameter = ParameterEvaluator::checkedCast( session, objectHandle );
     if( parameter != NULL )
     {
+        session->invalidateDependencies( objectHandle );
         FmlErrorNumber error = parameter->dataDescription->addIndexEvaluator( true, indexHandle, FML_INVALID_HANDLE );
         return session->setError( error, objectHandle, "Cannot set sparse index evaluator." );
     }
@@ -2043,7 +2283,7 @@ FmlErrorNumber Fieldml_SetDefaultEvaluator( FmlSessionHandle handle, FmlObjectHa
         return session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Incompatible type for delegate evaluator." );
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2055,6 +2295,7 @@ FmlErrorNumber Fieldml_SetDefaultEvaluator( FmlSessionHandle handle, FmlObjectHa
         return session->getLastError();
     }
 
+    session->invalidateDependencies( objectHandle );
     map->setDefault( evaluator );
     return session->getLastError();
 }
@@ -2070,7 +2311,7 @@ FmlObjectHandle Fieldml_GetDefaultEvaluator( FmlSessionHandle handle, FmlObjectH
         return FML_INVALID_HANDLE;
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2095,40 +2336,177 @@ FmlErrorNumber Fieldml_SetEvaluator( FmlSessionHandle handle, FmlObjectHandle ob
     {
         return session->getLastError();
     }
-    if( !checkLocal( session, evaluator ) )
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return session->getLastError();
+    }
+    
+    if( !checkDelegateEvaluator( session, objectHandle, evaluator ) )
     {
         return session->getLastError();
     }
+    
+    session->invalidateDependencies( objectHandle );
+    map->set( element, evaluator );
+    return session->getLastError();
+}
+
+
+FmlErrorNumber Fieldml_SetEvaluatorRange( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue minElement, FmlEnsembleValue maxElement, FmlObjectHandle evaluator )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
 
-    if( Fieldml_GetObjectType( handle, objectHandle ) == FHT_AGGREGATE_EVALUATOR )
+    if( !checkLocal( session, objectHandle ) )
     {
-        if( !checkIsEvaluatorType( session, evaluator, true, false, false ) )
+        return session->getLastError();
+    }
+    
+    if( maxElement < minElement )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_4, objectHandle, "Invalid element range." );
+    }
+    if( ( minElement < 1 ) && ( maxElement > ( INT_MAX - 1 ) + minElement ) )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_4, objectHandle, "Element range too large." );
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return session->getLastError();
+    }
+    
+    if( !checkDelegateEvaluator( session, objectHandle, evaluator ) )
+    {
+        return session->getLastError();
+    }
+    
+    session->invalidateDependencies( objectHandle );
+    map->setRange( minElement, maxElement, evaluator );
+    return session->getLastError();
+}
+
+
+FmlErrorNumber Fieldml_SetEvaluatorArray( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue firstElement, int count, const FmlObjectHandle *evaluators )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    if( !checkLocal( session, objectHandle ) )
+    {
+        return session->getLastError();
+    }
+    
+    if( count < 0 )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_4, objectHandle, "Invalid element count." );
+    }
+    if( ( firstElement > 0 ) && ( count - 1 > INT_MAX - firstElement ) )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_4, objectHandle, "Element count too large." );
+    }
+    if( ( evaluators == NULL ) && ( count > 0 ) )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_5, objectHandle, "Invalid evaluator array." );
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return session->getLastError();
+    }
+    
+    if( !checkDelegateEvaluators( session, objectHandle, count, evaluators ) )
+    {
+        return session->getLastError();
+    }
+    
+    session->invalidateDependencies( objectHandle );
+    int runStart = 0;
+    for( int i = 1; i <= count; i++ )
+    {
+        if( ( i == count ) || ( evaluators[i] != evaluators[runStart] ) )
         {
-            return session->setError( FML_ERR_INVALID_PARAMETER_3, evaluator, "Invalid type for aggregator delegate." );
+            map->setRange( firstElement + runStart, firstElement + ( i - 1 ), evaluators[runStart] );
+            runStart = i;
         }
     }
-    else if( !checkIsEvaluatorTypeCompatible( session, objectHandle, evaluator ) )
+    
+    return session->getLastError();
+}
+
+
+FmlErrorNumber Fieldml_SetEvaluators( FmlSessionHandle handle, FmlObjectHandle objectHandle, int count, const FmlEnsembleValue *elements, const FmlObjectHandle *evaluators )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
     {
-        return session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Incompatible type for delegate evaluator." );
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    if( !checkLocal( session, objectHandle ) )
+    {
+        return session->getLastError();
+    }
+    
+    if( count < 0 )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Invalid element count." );
+    }
+    if( ( elements == NULL ) && ( count > 0 ) )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_4, objectHandle, "Invalid element array." );
+    }
+    if( ( evaluators == NULL ) && ( count > 0 ) )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_5, objectHandle, "Invalid evaluator array." );
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
         return session->getLastError();
     }
     
-    if( !checkCyclicDependency( session, objectHandle, evaluator ) )
+    if( !checkDelegateEvaluators( session, objectHandle, count, evaluators ) )
     {
         return session->getLastError();
     }
     
-    map->set( element, evaluator );
+    //Consecutive elements sharing an evaluator are assigned as a single range.
+    session->invalidateDependencies( objectHandle );
+    int runStart = 0;
+    for( int i = 1; i <= count; i++ )
+    {
+        if( ( i == count ) || ( evaluators[i] != evaluators[runStart] ) || ( elements[i] != elements[i - 1] + 1 ) )
+        {
+            map->setRange( elements[runStart], elements[i - 1], evaluators[runStart] );
+            runStart = i;
+        }
+    }
+    
     return session->getLastError();
 }
 
-
 int Fieldml_GetEvaluatorCount( FmlSessionHandle handle, FmlObjectHandle objectHandle )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -2139,7 +2517,7 @@ int Fieldml_GetEvaluatorCount( FmlSessionHandle handle, FmlObjectHandle objectHa
         return -1;
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2160,7 +2538,7 @@ FmlEnsembleValue Fieldml_GetEvaluatorElement( FmlSessionHandle handle, FmlObject
         return -1;
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2181,7 +2559,7 @@ FmlObjectHandle Fieldml_GetEvaluator( FmlSessionHandle handle, FmlObjectHandle o
         return FML_INVALID_HANDLE;
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2202,7 +2580,7 @@ FmlObjectHandle Fieldml_GetElementEvaluator( FmlSessionHandle handle, FmlObjectH
         return FML_INVALID_HANDLE;
     }
 
-    SimpleMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
  
     if( map == NULL )
     {
@@ -2213,6 +2591,108 @@ FmlObjectHandle Fieldml_GetElementEvaluator( FmlSessionHandle handle, FmlObjectH
 }
 
 
+int Fieldml_GetEvaluatorRangeCount( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return -1;
+    }
+
+    return map->getRangeCount();
+}
+
+
+FmlEnsembleValue Fieldml_GetEvaluatorRangeMin( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return -1;
+    }
+
+    if( ( rangeIndex < 1 ) || ( rangeIndex > map->getRangeCount() ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Invalid range index." );
+        return -1;
+    }
+
+    return map->getRangeMin( rangeIndex - 1 );
+}
+
+
+FmlEnsembleValue Fieldml_GetEvaluatorRangeMax( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return -1;
+    }
+
+    if( ( rangeIndex < 1 ) || ( rangeIndex > map->getRangeCount() ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Invalid range index." );
+        return -1;
+    }
+
+    return map->getRangeMax( rangeIndex - 1 );
+}
+
+
+FmlObjectHandle Fieldml_GetEvaluatorRangeEvaluator( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_INVALID_HANDLE;
+    }
+
+    SimpleRangeMap<FmlEnsembleValue, FmlObjectHandle> *map = getEvaluatorMap( session, objectHandle ); 
+ 
+    if( map == NULL )
+    {
+        return FML_INVALID_HANDLE;
+    }
+
+    if( ( rangeIndex < 1 ) || ( rangeIndex > map->getRangeCount() ) )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Invalid range index." );
+        return FML_INVALID_HANDLE;
+    }
+
+    return map->getRangeValue( rangeIndex - 1 );
+}
+
+
 FmlObjectHandle Fieldml_CreateReferenceEvaluator( FmlSessionHandle handle, const char * name, FmlObjectHandle sourceEvaluator )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -2273,12 +2753,12 @@ int Fieldml_GetArgumentCount( FmlSessionHandle handle, FmlObjectHandle objectHan
         return -1;
     }
     
-    vector<FmlObjectHandle> args = getArgumentList( session, objectHandle, isBound != 0, isUsed != 0 );
+    const vector<FmlObjectHandle> *args = getArgumentList( session, objectHandle, isBound != 0, isUsed != 0 );
     if( session->getLastError() != FML_ERR_NO_ERROR )
     {
         return -1;
     }
-    return args.size();
+    return args->size();
 }
 
 
@@ -2292,19 +2772,19 @@ FmlObjectHandle Fieldml_GetArgument( FmlSessionHandle handle, FmlObjectHandle ob
         return FML_INVALID_HANDLE;
     }
 
-    vector<FmlObjectHandle> args = getArgumentList( session, objectHandle, isBound != 0, isUsed != 0 );
+    const vector<FmlObjectHandle> *args = getArgumentList( session, objectHandle, isBound != 0, isUsed != 0 );
     if( session->getLastError() != FML_ERR_NO_ERROR )
     {
         return FML_INVALID_HANDLE;
     }
     
-    if( ( argumentIndex < 1 ) || ( argumentIndex > (int)args.size() ) )
+    if( ( argumentIndex < 1 ) || ( argumentIndex > (int)args->size() ) )
     {
         session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Invalid index number." );
         return FML_INVALID_HANDLE;
     }
     
-    return args.at( argumentIndex - 1 );
+    return args->at( argumentIndex - 1 );
 }
 
 
@@ -2335,6 +2815,7 @@ FmlErrorNumber Fieldml_AddArgument( FmlSessionHandle handle, FmlObjectHandle obj
     ArgumentEvaluator *argumentEvaluator = ArgumentEvaluator::checkedCast( session, objectHandle );
     if( argumentEvaluator != NULL )
     {
+        session->invalidateDependencies( objectHandle );
         argumentEvaluator->arguments.insert( evaluatorHandle );
         return session->getLastError();
     }
@@ -2342,6 +2823,7 @@ FmlErrorNumber Fieldml_AddArgument( FmlSessionHandle handle, FmlObjectHandle obj
     ExternalEvaluator *externalEvaluator = ExternalEvaluator::checkedCast( session, objectHandle );
     if( externalEvaluator != NULL )
     {
+        session->invalidateDependencies( objectHandle );
         externalEvaluator->arguments.insert( evaluatorHandle );
         return session->getLastError();
     }
@@ -2469,6 +2951,7 @@ FmlErrorNumber Fieldml_SetBind( FmlSessionHandle handle, FmlObjectHandle objectH
         return session->getLastError();
     }
     
+    session->invalidateDependencies( objectHandle );
     map->set( argumentHandle, sourceHandle );
     return session->getLastError();
 }
@@ -2561,6 +3044,7 @@ FmlErrorNumber Fieldml_SetIndexEvaluator( FmlSessionHandle handle, FmlObjectHand
     {
         if( index == 1 )
         {
+            session->invalidateDependencies( objectHandle );
             piecewise->indexEvaluator = evaluatorHandle;
             return session->getLastError();
         }
@@ -2575,6 +3059,7 @@ FmlErrorNumber Fieldml_SetIndexEvaluator( FmlSessionHandle handle, FmlObjectHand
     {
         if( index == 1 )
         {
+            session->invalidateDependencies( objectHandle );
             aggregate->indexEvaluator = evaluatorHandle;
             return session->getLastError();
         }
@@ -2587,6 +3072,7 @@ FmlErrorNumber Fieldml_SetIndexEvaluator( FmlSessionHandle handle, FmlObjectHand
     ParameterEvaluator *parameter = ParameterEvaluator::checkedCast( session, objectHandle );
     if( parameter != NULL )
     {
+        session->invalidateDependencies( objectHandle );
         FmlErrorNumber error = parameter->dataDescription->setIndexEvaluator( index-1, evaluatorHandle, FML_INVALID_HANDLE );
         return session->setError( error, objectHandle, "Cannot set index evaluator." );
     }
@@ -3040,19 +3526,15 @@ int Fieldml_AddImportSource( FmlSessionHandle handle, const char * href, const c
         return -1;
     }
 
-    FieldmlRegion *importedRegion = session->getRegion( href, regionName );
+    FieldmlRegion *importedRegion = session->addResourceRegion( href, regionName );
     if( importedRegion == NULL )
     {
-        importedRegion = session->addResourceRegion( href, regionName );
-        if( importedRegion == NULL )
-        {
-            //TODO Get a more descriptive reason.
-            session->setError( FML_ERR_READ_ERR, "Cannot add import." );
-            return -1;
-        }
+        //TODO Get a more descriptive reason.
+        session->setError( FML_ERR_READ_ERR, "Cannot add import." );
+        return -1;
     }
     
-    int index = session->getRegionIndex( href, regionName );
+    int index = session->getRegionIndex( importedRegion );
     if( index < 0 )
     {
         session->setError( FML_ERR_INVALID_PARAMETER_3, string( "Cannot get index for import " ) + string( href ) + "." );  
@@ -3384,8 +3866,16 @@ FmlErrorNumber Fieldml_AddInlineData( FmlSessionHandle handle, FmlObjectHandle o
     {
         return session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot add inline data. Must be inline data resource." );
     }
+    if( resource->lockCount > 0 )
+    {
+        return session->setError( FML_ERR_ACCESS_VIOLATION, objectHandle, "Cannot add inline data. Inline data is locked." );
+    }
     
-    resource->description = resource->description + string( data, length );
+    if( length > 0 )
+    {
+        resource->inlineData.append( data, length );
+        resource->revision++;
+    }
     
     return session->getLastError();
 }
@@ -3419,8 +3909,13 @@ FmlErrorNumber Fieldml_SetInlineData( FmlSessionHandle handle, FmlObjectHandle o
     {
         return session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot set inline data. Must be inline data resource." );
     }
+    if( resource->lockCount > 0 )
+    {
+        return session->setError( FML_ERR_ACCESS_VIOLATION, objectHandle, "Cannot set inline data. Inline data is locked." );
+    }
     
-    resource->description = string( data, length );
+    resource->inlineData.assign( data, length );
+    resource->revision++;
     
     return session->getLastError();
 }
@@ -3447,7 +3942,7 @@ int Fieldml_GetInlineDataLength( FmlSessionHandle handle, FmlObjectHandle object
         return -1;
     }
     
-    return resource->description.length();
+    return resource->inlineData.getLength();
 }
 
 
@@ -3472,7 +3967,89 @@ char * Fieldml_GetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHan
         return NULL;
     }
     
-    return cstrCopy( resource->description );
+    return strdupS( resource->inlineData.getData() );
+}
+
+
+const char * Fieldml_GetInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, int *length )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return NULL;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return NULL;
+    }
+    if( resource->resourceType != FML_DATA_RESOURCE_INLINE )
+    {
+        session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot get inline data. Must be inline data resource." );
+        return NULL;
+    }
+    
+    if( length != NULL )
+    {
+        *length = resource->inlineData.getLength();
+    }
+    
+    return resource->inlineData.getData();
+}
+
+
+FmlErrorNumber Fieldml_LockInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return session->getLastError();
+    }
+    if( resource->resourceType != FML_DATA_RESOURCE_INLINE )
+    {
+        return session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot lock inline data. Must be inline data resource." );
+    }
+    
+    resource->lockCount++;
+    
+    return session->getLastError();
+}
+
+
+FmlErrorNumber Fieldml_UnlockInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return session->getLastError();
+    }
+    if( resource->lockCount <= 0 )
+    {
+        return session->setError( FML_ERR_MISCONFIGURED_OBJECT, objectHandle, "Cannot unlock inline data. Inline data is not locked." );
+    }
+    
+    resource->lockCount--;
+    
+    return session->getLastError();
 }
 
 
@@ -3497,13 +4074,22 @@ int Fieldml_CopyInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandl
         return -1;
     }
     
-    if( offset >= (int)resource->description.length() )
+    int dataLength = resource->inlineData.getLength();
+    if( ( offset < 0 ) || ( offset >= dataLength ) || ( bufferLength <= 1 ) || ( buffer == NULL ) )
     {
         return 0;
     }
     
-    //This is probably not the best way to do this
-    return cappedCopy( resource->description.c_str() + offset, buffer, bufferLength );
+    //Copy by length rather than with cappedCopy, which would scan the rest of the data on every call.
+    int length = dataLength - offset;
+    if( length >= bufferLength )
+    {
+        length = bufferLength - 1;
+    }
+    memcpy( buffer, resource->inlineData.getData() + offset, length );
+    buffer[length] = 0;
+    
+    return length;
 }
 
 
@@ -3527,6 +4113,38 @@ FieldmlDataSourceType Fieldml_GetDataSourceType( FmlSessionHandle handle, FmlObj
 }
 
 
+int Fieldml_GetDataRevision( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+    
+    FieldmlObject *object = getObject( session, objectHandle );
+    if( object == NULL )
+    {
+        return -1;
+    }
+    
+    if( object->objectType == FHT_DATA_RESOURCE )
+    {
+        return ( (DataResource*)object )->revision;
+    }
+    else if( object->objectType == FHT_DATA_SOURCE )
+    {
+        //Both counts only ever increase, so their sum changes whenever either does.
+        DataSource *dataSource = (DataSource*)object;
+        return dataSource->revision + dataSource->resource->revision;
+    }
+    
+    session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot get data revision. Must be a data source or data resource." );
+    return -1;
+}
+
+
 char * Fieldml_GetDataResourceHref( FmlSessionHandle handle, FmlObjectHandle objectHandle )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -3869,6 +4487,7 @@ FmlErrorNumber Fieldml_SetArrayDataSourceSizes( FmlSessionHandle handle, FmlObje
     {
         source->sizes.push_back( sizes[i] );
     }
+    source->revision++;
     
     return FML_ERR_NO_ERROR;
 }
@@ -3928,6 +4547,7 @@ FmlErrorNumber Fieldml_SetArrayDataSourceRawSizes( FmlSessionHandle handle, FmlO
     {
         source->rawSizes.push_back( sizes[i] );
     }
+    source->revision++;
     
     return FML_ERR_NO_ERROR;
 }
@@ -3987,6 +4607,7 @@ FmlErrorNumber Fieldml_SetArrayDataSourceOffsets( FmlSessionHandle handle, FmlOb
     {
         source->offsets.push_back( offsets[i] );
     }
+    source->revision++;
     
     return FML_ERR_NO_ERROR;
 }
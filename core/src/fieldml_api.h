@@ -81,6 +81,8 @@ typedef unsigned __int64 uint64_t;
 #include <stdint.h>
 #endif
 
+#include <stddef.h>
+
 
 typedef int32_t FmlSessionHandle;               ///< A handle to a FieldML session. Almost all FieldML API calls require a session handle.
 
@@ -117,6 +119,7 @@ typedef int32_t FmlEnsembleValue;               ///< An integer-valued ensemble
 #define FML_ERR_CYCLIC_DEPENDENCY       1008    ///< An attempt was made to create a cyclic dependency.
 #define FML_ERR_INVALID_INDEX           1009    ///< An attempt was made to use an out-of-bounds index.
 #define FML_ERR_READ_ERR                1010    ///< A read error was encountered during IO.
+#define FML_ERR_WRITE_ERR               1011    ///< A write error was encountered during IO.
 
 //Used for giving the user precise feedback on bad parameters passed to the API
 //Only used for parameters other than the FieldML handle and object handle parameters.
@@ -246,6 +249,49 @@ enum FieldmlHandleType
 };
 
 
+/**
+ * Options that control how FieldML documents are read. Options can be combined with bitwise or.
+ * 
+ * \see Fieldml_CreateFromFileWithOptions
+ */
+enum FieldmlParseOption
+{
+    FML_PARSE_DEFAULT   = 0,  ///< The whole document is read into memory, then parsed.
+    FML_PARSE_STREAMING = 1,  ///< Objects are created while the document is read, so memory use is bounded by the objects rather than the document.
+    FML_PARSE_TRUSTED   = 2,  ///< The document is not validated against the FieldML schema. Only for documents known to be valid, such as ones written by this API.
+};
+
+
+/**
+ * Options that control how FieldML documents are written. Options can be combined with bitwise or.
+ * 
+ * \see Fieldml_WriteFileWithOptions
+ */
+enum FieldmlWriteOption
+{
+    FML_WRITE_DEFAULT   = 0,  ///< Each element is written on its own line, indented by depth.
+    FML_WRITE_NO_INDENT = 1,  ///< No whitespace is added between elements, giving a considerably smaller document.
+};
+
+
+/**
+ * Receives a FieldML document as it is written, a part at a time. Returns the number of bytes consumed, or -1 to
+ * abandon the write.
+ * 
+ * \see Fieldml_WriteToCallback
+ */
+typedef int (*FmlWriteCallback)( void *context, const char *buffer, int length );
+
+
+/**
+ * Supplies a FieldML document as it is read, a part at a time. Copies up to length bytes into the buffer, and returns
+ * the number of bytes copied, 0 at the end of the document, or -1 on error.
+ * 
+ * \see Fieldml_CreateFromCallback
+ */
+typedef int (*FmlReadCallback)( void *context, char *buffer, int length );
+
+
 /*
 
  API
@@ -274,6 +320,46 @@ extern "C" {
 FmlSessionHandle Fieldml_CreateFromFile( const char * filename );
 
 
+/**
+ * As Fieldml_CreateFromFile(), but reads the file, and any documents it imports, using the given
+ * combination of FieldmlParseOption values.
+ * 
+ * \note When streaming, objects that refer to objects later in the document are held back until the
+ * objects they refer to have been created.
+ * 
+ * \note Unless FML_PARSE_TRUSTED is given, each document is validated while it is read rather than in
+ * a separate pass. The schema is compiled once, and shared by all sessions.
+ * 
+ * \note When streaming, objects are created before the document is known to be valid. If it turns out not to be, the
+ * objects it created, and those of any documents it imported, are deleted again, so in either mode a document that
+ * fails to parse leaves no objects in the session.
+ * 
+ * \see Fieldml_CreateFromFile
+ * \see FieldmlParseOption
+ */
+FmlSessionHandle Fieldml_CreateFromFileWithOptions( const char * filename, int parseOptions );
+
+
+/**
+ * As Fieldml_CreateFromFileWithOptions(), but parses the document held in the given buffer, which need not be
+ * null-terminated. Relative imports and data resources are resolved against the directory of baseUrl, which may be
+ * NULL.
+ * 
+ * \see Fieldml_CreateFromFileWithOptions
+ */
+FmlSessionHandle Fieldml_CreateFromBuffer( const char * buffer, size_t length, const char * baseUrl, int parseOptions );
+
+
+/**
+ * As Fieldml_CreateFromBuffer(), but reads the document from the given callback, so that parsing can proceed while
+ * the rest of the document is still being received. The context is passed to every call of the callback.
+ * 
+ * \see Fieldml_CreateFromBuffer
+ * \see FmlReadCallback
+ */
+FmlSessionHandle Fieldml_CreateFromCallback( FmlReadCallback callback, void * context, const char * baseUrl, int parseOptions );
+
+
 /**
  * Creates an empty FieldML handle.
  * 
@@ -314,6 +400,37 @@ FmlErrorNumber Fieldml_GetLastError( FmlSessionHandle handle );
 FmlErrorNumber Fieldml_WriteFile( FmlSessionHandle handle, const char * filename );
 
 
+/**
+ * As Fieldml_WriteFile(), but using the given combination of FieldmlWriteOption values.
+ * 
+ * \see Fieldml_WriteFile
+ * \see FieldmlWriteOption
+ */
+FmlErrorNumber Fieldml_WriteFileWithOptions( FmlSessionHandle handle, const char * filename, int writeOptions );
+
+
+/**
+ * Writes the contents of the given FieldML handle as an XML document, passing it to the given callback as it is
+ * generated rather than storing it. The context is passed to every call of the callback.
+ * 
+ * \see FmlWriteCallback
+ * \see FieldmlWriteOption
+ */
+FmlErrorNumber Fieldml_WriteToCallback( FmlSessionHandle handle, FmlWriteCallback callback, void * context, int writeOptions );
+
+
+/**
+ * Writes the contents of the given FieldML handle as an XML document into the given buffer. At most bufferLength
+ * bytes are written, and no terminating null is added.
+ * 
+ * \return The length of the whole document, or -1 on error. If this is more than bufferLength, the document has been
+ * truncated, and can be written again into a buffer of at least the returned length.
+ * 
+ * \see FieldmlWriteOption
+ */
+int Fieldml_WriteToBuffer( FmlSessionHandle handle, char * buffer, int bufferLength, int writeOptions );
+
+
 /**
  * Frees all resources associated with the given handle. The handle will
  * become invalid after this call.
@@ -432,6 +549,22 @@ int Fieldml_GetTotalObjectCount( FmlSessionHandle handle );
 FmlObjectHandle Fieldml_GetObjectByIndex( FmlSessionHandle handle, const int objectIndex );
 
 
+/**
+ * \return The number of objects in the session's region, including virtual objects but not imports, or -1 on error.
+ * 
+ * \see Fieldml_GetLocalObjectByIndex
+ */
+int Fieldml_GetLocalObjectCount( FmlSessionHandle handle );
+
+
+/**
+ * \return A handle to the nth object in the session's region, in the order they were added.
+ * 
+ * \see Fieldml_GetLocalObjectCount
+ */
+FmlObjectHandle Fieldml_GetLocalObjectByIndex( FmlSessionHandle handle, const int objectIndex );
+
+
 /**
  * \return The number of objects of the given type, or zero if there are none.
  * 
@@ -933,6 +1066,43 @@ FmlObjectHandle Fieldml_GetDefaultEvaluator( FmlSessionHandle handle, FmlObjectH
 FmlErrorNumber Fieldml_SetEvaluator( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue element, FmlObjectHandle evaluator );
 
 
+/**
+ * Associates every index value in the inclusive range [minElement, maxElement] with the given evaluator. This is equivalent
+ * to calling Fieldml_SetEvaluator for each index value in the range, but the association is stored as a single range.
+ * 
+ * Setting the evaluator handle to FML_INVALID_HANDLE removes the index-evaluator association for the whole range.
+ * 
+ * \see Fieldml_SetEvaluator
+ * \see Fieldml_SetEvaluatorArray
+ * \see Fieldml_GetEvaluatorRangeCount
+ */
+FmlErrorNumber Fieldml_SetEvaluatorRange( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue minElement, FmlEnsembleValue maxElement, FmlObjectHandle evaluator );
+
+
+/**
+ * Sets the evaluators for count consecutive index values, starting at firstElement. The nth entry in the given array is
+ * the evaluator for index value firstElement + n. Entries may be FML_INVALID_HANDLE, which removes the
+ * corresponding association. If any of the evaluators are invalid, no associations are changed.
+ * 
+ * \see Fieldml_SetEvaluator
+ * \see Fieldml_SetEvaluatorRange
+ */
+FmlErrorNumber Fieldml_SetEvaluatorArray( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue firstElement, int count, const FmlObjectHandle *evaluators );
+
+
+/**
+ * Sets count explicit index value to evaluator pairings for the given aggregate or piecewise evaluator in a single call.
+ * The nth entry in the evaluators array is associated with the nth entry in the elements array. Entries may be
+ * FML_INVALID_HANDLE, which removes the corresponding association. If the same element appears more than once,
+ * the last entry wins. If any of the evaluators are invalid, no associations are changed.
+ * 
+ * \see Fieldml_SetEvaluator
+ * \see Fieldml_SetEvaluatorArray
+ * \see Fieldml_SetEvaluatorsFromSource
+ */
+FmlErrorNumber Fieldml_SetEvaluators( FmlSessionHandle handle, FmlObjectHandle objectHandle, int count, const FmlEnsembleValue *elements, const FmlObjectHandle *evaluators );
+
+
 /**
  * \return The number of explicit index-value to evaluator pairings for the given
  * piecewise or aggregate evaluator.
@@ -976,6 +1146,44 @@ FmlObjectHandle Fieldml_GetEvaluator( FmlSessionHandle handle, FmlObjectHandle o
 FmlObjectHandle Fieldml_GetElementEvaluator( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlEnsembleValue elementNumber, FmlBoolean allowDefault );
 
 
+/**
+ * \return The number of ranges of consecutive index values sharing the same evaluator in the given
+ * piecewise or aggregate evaluator. Adjacent index values with the same evaluator are always merged into
+ * a single range.
+ * 
+ * \see Fieldml_SetEvaluatorRange
+ * \see Fieldml_GetEvaluatorRangeMin
+ * \see Fieldml_GetEvaluatorRangeMax
+ * \see Fieldml_GetEvaluatorRangeEvaluator
+ */
+int Fieldml_GetEvaluatorRangeCount( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
+/**
+ * \return The lowest index value in the nth range of the given piecewise or aggregate evaluator.
+ * Ranges are ordered by index value.
+ * 
+ * \see Fieldml_GetEvaluatorRangeCount
+ */
+FmlEnsembleValue Fieldml_GetEvaluatorRangeMin( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex );
+
+
+/**
+ * \return The highest index value in the nth range of the given piecewise or aggregate evaluator.
+ * 
+ * \see Fieldml_GetEvaluatorRangeCount
+ */
+FmlEnsembleValue Fieldml_GetEvaluatorRangeMax( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex );
+
+
+/**
+ * \return The evaluator for the nth range of the given piecewise or aggregate evaluator.
+ * 
+ * \see Fieldml_GetEvaluatorRangeCount
+ */
+FmlObjectHandle Fieldml_GetEvaluatorRangeEvaluator( FmlSessionHandle handle, FmlObjectHandle objectHandle, int rangeIndex );
+
+
 /**
  * \return The number of index evaluators used by the given evaluator.
  * 
@@ -1174,6 +1382,10 @@ int Fieldml_GetEnsembleMembersStride( FmlSessionHandle handle, FmlObjectHandle o
  * \note Attempting to add the same import source more than once will succeed, but will result
  * in the same index being returned each time.
  * 
+ * \note A file is only parsed again if its modification time or size has changed since it was last read in this
+ * session. The new reading then takes the place of the old one under the same index, and its objects are the ones found
+ * by declared name. Objects already imported from the old reading remain valid.
+ * 
  * \note The string 'http://www.fieldml.org/resources/xml/0.5/fieldml_library.xml' will direct
  * the API to use an internally-cached version of fieldml_library.xml.
  * 
@@ -1432,20 +1644,33 @@ FmlErrorNumber Fieldml_SetArrayDataSourceSizes( FmlSessionHandle handle, FmlObje
 FieldmlDataSourceType Fieldml_GetDataSourceType( FmlSessionHandle handle, FmlObjectHandle objectHandle );
 
 
+/**
+ * \return A number that changes whenever the data accessed through the given data source or data resource is changed
+ * via this API, e.g. by setting a data source's sizes or offsets, or a resource's inline data, or -1 on error. Changes
+ * made to external files are not tracked.
+ * 
+ * \see Fieldml_SetArrayDataSourceOffsets
+ * \see Fieldml_SetInlineData
+ */
+int Fieldml_GetDataRevision( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
 /**
  * Appends the given string to the given data resource's inline data. The data resource's type must be
- * FieldmlDataResourceType::FML_DATA_RESOURCE_INLINE.
+ * FieldmlDataResourceType::FML_DATA_RESOURCE_INLINE. Fails with FML_ERR_ACCESS_VIOLATION if the inline data is locked.
  * 
  * \see Fieldml_CreateInlineDataResource
+ * \see Fieldml_LockInlineData
  */
 FmlErrorNumber Fieldml_AddInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char * data, const int length );
 
 
 /**
  * Copies the given string to the given data resource's inline data. The data resource's type must be
- * FieldmlDataResourceType::FML_DATA_RESOURCE_INLINE.
+ * FieldmlDataResourceType::FML_DATA_RESOURCE_INLINE. Fails with FML_ERR_ACCESS_VIOLATION if the inline data is locked.
  * 
  * \see Fieldml_CreateInlineDataResource
+ * \see Fieldml_LockInlineData
  */
 FmlErrorNumber Fieldml_SetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char * data, const int length );
 
@@ -1471,6 +1696,37 @@ int Fieldml_GetInlineDataLength( FmlSessionHandle handle, FmlObjectHandle object
 char * Fieldml_GetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle );
 
 
+/**
+ * \return A pointer to the data resource's inline data, which is zero-terminated, and if length is not NULL, sets it
+ * to the number of characters in the data. Unlike Fieldml_GetInlineData(), the data is not copied, and must not be
+ * freed. The pointer is only valid until the data resource's inline data is next modified, or the session is destroyed.
+ * Use Fieldml_LockInlineData() to keep it valid for longer.
+ * 
+ * \see Fieldml_GetInlineData
+ * \see Fieldml_CreateInlineDataResource
+ */
+const char * Fieldml_GetInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, int *length );
+
+
+/**
+ * Prevents the given data resource's inline data from being changed until a matching call to
+ * Fieldml_UnlockInlineData(), so that views of it stay valid. Locks are counted, and while any are held, 
+ * Fieldml_AddInlineData() and Fieldml_SetInlineData() fail with FML_ERR_ACCESS_VIOLATION.
+ * 
+ * \see Fieldml_GetInlineDataView
+ * \see Fieldml_UnlockInlineData
+ */
+FmlErrorNumber Fieldml_LockInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
+/**
+ * Releases a lock taken with Fieldml_LockInlineData().
+ * 
+ * \see Fieldml_LockInlineData
+ */
+FmlErrorNumber Fieldml_UnlockInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
 /**
  * Copies a section of the data resource's inline data into the given buffer, starting from the given offset, and ending
  * either when the buffer is full, or the end of the inline data is reached.
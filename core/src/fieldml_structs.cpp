@@ -60,11 +60,23 @@ FieldmlObject::FieldmlObject( const std::string _name, FieldmlRegion* _region, F
 }
 
 
+FieldmlObject *FieldmlObject::clone( FieldmlRegion * /*newRegion*/, FmlObjectHandle /*handleOffset*/ )
+{
+    return NULL;
+}
+
+
 FieldmlObject::~FieldmlObject()
 {
 }
 
 
+FmlObjectHandle FieldmlObject::moveHandle( FmlObjectHandle handle, FmlObjectHandle handleOffset )
+{
+    return ( handle == FML_INVALID_HANDLE ) ? handle : handle + handleOffset;
+}
+
+
 ElementSequence::ElementSequence( const std::string _name,
                                   FieldmlRegion* _region, FmlObjectHandle _elementType ) :
   FieldmlObject( _name, _region, FHT_UNKNOWN, false ),
@@ -82,6 +94,22 @@ EnsembleType::EnsembleType( const std::string _name, FieldmlRegion* _region, boo
     min = 0;
     max = 0;
     stride = 1;
+    dataSource = FML_INVALID_HANDLE;
+}
+
+
+FieldmlObject *EnsembleType::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    EnsembleType *copy = new EnsembleType( name, newRegion, isComponentEnsemble, isVirtual );
+    copy->intValue = intValue;
+    copy->membersType = membersType;
+    copy->min = min;
+    copy->max = max;
+    copy->stride = stride;
+    copy->count = count;
+    copy->dataSource = moveHandle( dataSource, handleOffset );
+    
+    return copy;
 }
 
 
@@ -91,6 +119,15 @@ BooleanType::BooleanType( const std::string _name, FieldmlRegion* _region, bool
 }
 
 
+FieldmlObject *BooleanType::clone( FieldmlRegion *newRegion, FmlObjectHandle /*handleOffset*/ )
+{
+    BooleanType *copy = new BooleanType( name, newRegion, isVirtual );
+    copy->intValue = intValue;
+    
+    return copy;
+}
+
+
 ContinuousType::ContinuousType( const std::string _name, FieldmlRegion* _region, bool _isVirtual ) :
   FieldmlObject( _name, _region, FHT_CONTINUOUS_TYPE, _isVirtual )
 {
@@ -98,6 +135,16 @@ ContinuousType::ContinuousType( const std::string _name, FieldmlRegion* _region,
 }
 
 
+FieldmlObject *ContinuousType::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    ContinuousType *copy = new ContinuousType( name, newRegion, isVirtual );
+    copy->intValue = intValue;
+    copy->componentType = moveHandle( componentType, handleOffset );
+    
+    return copy;
+}
+
+
 MeshType::MeshType( const std::string _name, FieldmlRegion* _region, bool _isVirtual ) :
   FieldmlObject( _name, _region, FHT_MESH_TYPE, _isVirtual )
 {
@@ -107,12 +154,26 @@ MeshType::MeshType( const std::string _name, FieldmlRegion* _region, bool _isVir
 }
 
 
+FieldmlObject *MeshType::clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset )
+{
+    MeshType *copy = new MeshType( name, newRegion, isVirtual );
+    copy->intValue = intValue;
+    copy->shapes = moveHandle( shapes, handleOffset );
+    copy->chartType = moveHandle( chartType, handleOffset );
+    copy->elementsType = moveHandle( elementsType, handleOffset );
+    
+    return copy;
+}
+
+
 DataResource::DataResource( const std::string _name, FieldmlRegion* _region,
                             FieldmlDataResourceType _resourceType, const string _format, const string _description ) : 
   FieldmlObject( _name, _region, FHT_DATA_RESOURCE, false ),
     resourceType( _resourceType ),
     format( _format ),
-    description( _description )
+    description( _description ),
+    revision( 0 ),
+    lockCount( 0 )
 {
 }
 
@@ -462,7 +523,8 @@ DataSource::DataSource( const std::string _name, FieldmlRegion* _region,
                         DataResource *_resource, FieldmlDataSourceType _type ) :
   FieldmlObject( _name, _region, FHT_DATA_SOURCE, false ),
   resource( _resource ),
-  sourceType( _type )
+  sourceType( _type ),
+  revision( 0 )
 {
 }
 
@@ -49,6 +49,7 @@
 #include "fieldml_api.h"
 #include "SimpleMap.h"
 #include "SimpleBitset.h"
+#include "InlineDataBuffer.h"
 
 class FieldmlRegion;
 
@@ -66,7 +67,15 @@ public:
     
     FieldmlObject( const std::string _name, FieldmlRegion* _region, FieldmlHandleType _type, bool _isVirtual );
     
+    /**
+     * Returns a copy of this object in the given region, with every object handle it holds moved on by handleOffset,
+     * or NULL if objects of this type cannot be copied.
+     */
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
+    
     virtual ~FieldmlObject();
+
+    static FmlObjectHandle moveHandle( FmlObjectHandle handle, FmlObjectHandle handleOffset );
 };
 
 
@@ -89,6 +98,8 @@ public:
     FmlObjectHandle dataSource;
     
     EnsembleType( const std::string _name, FieldmlRegion* _region, bool _isComponentEnsemble, bool _isVirtual );
+    
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
 };
 
 
@@ -109,6 +120,8 @@ class BooleanType :
 {
 public:
     BooleanType( const std::string _name, FieldmlRegion* _region, bool _isVirtual );
+    
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
 };
 
 
@@ -119,6 +132,8 @@ public:
     FmlObjectHandle componentType;
     
     ContinuousType( const std::string _name, FieldmlRegion* _region, bool _isVirtual );
+    
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
 };
 
 
@@ -131,6 +146,8 @@ public:
     FmlObjectHandle shapes;
     
     MeshType( const std::string _name, FieldmlRegion* _region, bool _isVirtual );
+    
+    virtual FieldmlObject *clone( FieldmlRegion *newRegion, FmlObjectHandle handleOffset );
 };
 
 
@@ -138,9 +155,12 @@ class DataResource :
     public FieldmlObject
 {
 public:
-    //NOTE: if isInline, this is the inline string. Otherwise, it's an href.
+    //NOTE: Only used by href resources, for which this is the href.
     std::string description;
     
+    //NOTE: Only used by inline resources.
+    InlineDataBuffer inlineData;
+    
     //NOTE: At the moment, inline resources may only be TEXT_PLAIN. 
     const std::string format;
     
@@ -148,6 +168,12 @@ public:
 
     std::vector<FmlObjectHandle> dataSources;
     
+    //Incremented whenever the resource's data changes.
+    int revision;
+    
+    //The number of outstanding Fieldml_LockInlineData calls. The inline data cannot be changed while this is non-zero.
+    int lockCount;
+    
     DataResource( const std::string _name, FieldmlRegion* _region, FieldmlDataResourceType _type, const std::string _format, const std::string _description );
         
     virtual ~DataResource();
@@ -165,6 +191,9 @@ public:
     
     DataResource * const resource;
     
+    //Incremented whenever the source's location within its resource changes.
+    int revision;
+    
     virtual ~DataSource()
     {
     }
@@ -119,6 +119,40 @@ static void writeComponentEvaluator( xmlTextWriterPtr writer, const xmlChar *tag
 }
 
 
+//Evaluators are stored as ranges of index values, so the evaluator name need only be fetched once per range.
+static void writeComponentEvaluators( xmlTextWriterPtr writer, FmlSessionHandle handle, FmlObjectHandle object, const xmlChar *tagName, const xmlChar *attribName )
+{
+    int rangeCount = Fieldml_GetEvaluatorRangeCount( handle, object );
+    
+    for( int i = 1; i <= rangeCount; i++ )
+    {
+        FmlEnsembleValue minElement = Fieldml_GetEvaluatorRangeMin( handle, object, i );
+        FmlEnsembleValue maxElement = Fieldml_GetEvaluatorRangeMax( handle, object, i );
+        FmlObjectHandle evaluator = Fieldml_GetEvaluatorRangeEvaluator( handle, object, i );
+        if( ( maxElement <= 0 ) || ( evaluator == FML_INVALID_HANDLE ) )
+        {
+            continue;
+        }
+        if( minElement <= 0 )
+        {
+            minElement = 1;
+        }
+        
+        char *evaluatorName = Fieldml_GetObjectName( handle, evaluator );
+        for( FmlEnsembleValue element = minElement; element <= maxElement; element++ )
+        {
+            writeComponentEvaluator( writer, tagName, attribName, element, evaluatorName );
+            if( element == maxElement )
+            {
+                //Avoids overflow when maxElement is the largest representable value.
+                break;
+            }
+        }
+        Fieldml_FreeString( evaluatorName );
+    }
+}
+
+
 static int writeBinds( xmlTextWriterPtr writer, FmlSessionHandle handle, FmlObjectHandle object )
 {
     int count = Fieldml_GetBindCount( handle, object );
@@ -536,16 +570,7 @@ static int writePiecewiseEvaluator( xmlTextWriterPtr writer, FmlSessionHandle ha
             xmlTextWriterWriteFormatAttribute( writer, DEFAULT_ATTRIB, "%s", Fieldml_GetObjectName( handle, defaultEvaluator ) );
         }
     
-        for( int i = 1; i <= count; i++ )
-        {
-            FmlEnsembleValue element = Fieldml_GetEvaluatorElement( handle, object, i );
-            FmlObjectHandle evaluator = Fieldml_GetEvaluator( handle, object, i );
-            if( ( element <= 0 ) || ( evaluator == FML_INVALID_HANDLE ) )
-            {
-                continue;
-            }
-            writeComponentEvaluator( writer, EVALUATOR_MAP_ENTRY_TAG, VALUE_ATTRIB, element, Fieldml_GetObjectName( handle, evaluator ) );
-        }
+        writeComponentEvaluators( writer, handle, object, EVALUATOR_MAP_ENTRY_TAG, VALUE_ATTRIB );
 
         xmlTextWriterEndElement( writer );
     }
@@ -672,16 +697,7 @@ static int writeAggregateEvaluator( xmlTextWriterPtr writer, FmlSessionHandle ha
             xmlTextWriterWriteFormatAttribute( writer, DEFAULT_ATTRIB, "%s", Fieldml_GetObjectName( handle, defaultEvaluator ) );
         }
     
-        for( int i = 1; i <= count; i++ )
-        {
-            FmlEnsembleValue element = Fieldml_GetEvaluatorElement( handle, object, i );
-            FmlObjectHandle evaluator = Fieldml_GetEvaluator( handle, object, i );
-            if( ( element <= 0 ) || ( evaluator == FML_INVALID_HANDLE ) )
-            {
-                continue;
-            }
-            writeComponentEvaluator( writer, COMPONENT_EVALUATOR_TAG, COMPONENT_ATTRIB, element, Fieldml_GetObjectName( handle, evaluator ) );
-        }
+        writeComponentEvaluators( writer, handle, object, COMPONENT_EVALUATOR_TAG, COMPONENT_ATTRIB );
 
         xmlTextWriterEndElement( writer );
     }
@@ -728,22 +744,45 @@ static int writeFieldmlObject( xmlTextWriterPtr writer, FmlSessionHandle handle,
 }
 
 
-int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle, const char *filename )
+struct BufferWriteState
+{
+    char *buffer;
+    
+    int bufferLength;
+    
+    int length;
+};
+
+
+static int writeToBuffer( void *context, const char *buffer, int length )
+{
+    BufferWriteState *state = (BufferWriteState*)context;
+    
+    if( state->length < state->bufferLength )
+    {
+        const int available = state->bufferLength - state->length;
+        memcpy( state->buffer + state->length, buffer, ( length < available ) ? length : available );
+    }
+    state->length += length;
+    
+    return length;
+}
+
+
+static int writeFieldmlDocument( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle, xmlTextWriterPtr writer, const char *description, int writeOptions )
 {
     FmlObjectHandle object;
     int i, count, length;
     int result = 0;
     char tBuffer[tBufferLength];
-    xmlTextWriterPtr writer;
     
-    writer = xmlNewTextWriterFilename( filename, 0 );
     if( writer == NULL )
     {
-        errorHandler->logError( "testXmlwriterFilename: Error creating XML writer", filename );
+        errorHandler->logError( "Error creating XML writer", description );
         return 1;
     }
 
-    xmlTextWriterSetIndent( writer, 1 );
+    xmlTextWriterSetIndent( writer, ( writeOptions & FML_WRITE_NO_INDENT ) == 0 );
     xmlTextWriterStartDocument( writer, NULL, MY_ENCODING, NULL );
 
     xmlTextWriterStartElement( writer, FIELDML_TAG );
@@ -822,10 +861,10 @@ int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle
         xmlTextWriterEndElement( writer );
     }
     
-    count = Fieldml_GetTotalObjectCount( handle );
+    count = Fieldml_GetLocalObjectCount( handle );
     for( i = 1; i <= count; i++ )
     {
-        object = Fieldml_GetObjectByIndex( handle, i );
+        object = Fieldml_GetLocalObjectByIndex( handle, i );
         if( Fieldml_IsObjectLocal( handle, object, true ) )
         {
             writeFieldmlObject( writer, handle, object );
@@ -837,13 +876,49 @@ int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle
     }
 
     result = xmlTextWriterEndDocument( writer );
+    xmlFreeTextWriter( writer );
+    
     if( result < 0 )
     {
-        errorHandler->logError( "testXmlwriterFilename: Error at xmlTextWriterEndDocument", filename );
+        errorHandler->logError( "Error at xmlTextWriterEndDocument", description );
         return 1;
     }
 
-    xmlFreeTextWriter( writer );
-
     return 0;
 }
+
+
+int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle, const char *filename, int writeOptions )
+{
+    return writeFieldmlDocument( errorHandler, handle, xmlNewTextWriterFilename( filename, 0 ), filename, writeOptions );
+}
+
+
+int writeFieldmlCallback( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle, FmlWriteCallback callback, void *context, int writeOptions )
+{
+    //The text writer takes ownership of the output buffer.
+    xmlOutputBufferPtr output = xmlOutputBufferCreateIO( callback, NULL, context, NULL );
+    if( output == NULL )
+    {
+        errorHandler->logError( "Error creating XML output buffer" );
+        return 1;
+    }
+    
+    return writeFieldmlDocument( errorHandler, handle, xmlNewTextWriter( output ), "callback", writeOptions );
+}
+
+
+int writeFieldmlBuffer( FieldmlErrorHandler *errorHandler, FmlSessionHandle handle, char *buffer, int bufferLength, int writeOptions )
+{
+    BufferWriteState state;
+    state.buffer = buffer;
+    state.bufferLength = bufferLength;
+    state.length = 0;
+    
+    if( writeFieldmlCallback( errorHandler, handle, writeToBuffer, &state, writeOptions ) != 0 )
+    {
+        return -1;
+    }
+    
+    return state.length;
+}
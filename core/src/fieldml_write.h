@@ -45,6 +45,14 @@
 #include "fieldml_structs.h"
 #include "FieldmlSession.h"
 
-int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle session, const char *filename );
+int writeFieldmlFile( FieldmlErrorHandler *errorHandler, FmlSessionHandle session, const char *filename, int writeOptions );
+
+int writeFieldmlCallback( FieldmlErrorHandler *errorHandler, FmlSessionHandle session, FmlWriteCallback callback, void *context, int writeOptions );
+
+/**
+ * Writes into the given buffer, returning the length of the whole document, or -1 on error. Output beyond
+ * bufferLength is counted, but discarded.
+ */
+int writeFieldmlBuffer( FieldmlErrorHandler *errorHandler, FmlSessionHandle session, char *buffer, int bufferLength, int writeOptions );
 
 #endif // H_FIELDMLWRITE
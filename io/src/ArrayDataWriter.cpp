@@ -46,9 +46,13 @@
 
 using namespace std;
 
-ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank )
+ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, const ArrayDataWriterOptions &options )
 {
     ArrayDataWriter *writer = NULL;
+#ifndef FIELDML_HDF5_ARRAY
+    //Only the HDF5 writers take creation options.
+    (void)options;
+#endif //FIELDML_HDF5_ARRAY
     
     FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
     char *temp_string = Fieldml_GetDataResourceFormat( context->getSession(), resource );
@@ -61,13 +65,13 @@ ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const strin
     else if( format == StringUtil::HDF5_NAME )
     {
 #ifdef FIELDML_HDF5_ARRAY
-        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
+        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank, options );
 #endif //FIELDML_HDF5_ARRAY
     }
     else if( format == StringUtil::PHDF5_NAME )
     {
 #ifdef FIELDML_PHDF5_ARRAY
-        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
+        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank, options );
 #endif //FIELDML_PHDF5_ARRAY
     }
     else if( format == StringUtil::PLAIN_TEXT_NAME )
@@ -90,6 +94,12 @@ ArrayDataWriter::ArrayDataWriter( FieldmlIoContext *_context ) :
 }
 
 
+FmlIoErrorNumber ArrayDataWriter::setPrecision( int /*significantDigits*/ )
+{
+    return context->setError( FML_IOERR_UNSUPPORTED );
+}
+
+
 ArrayDataWriter::~ArrayDataWriter()
 {
     delete context;
@@ -46,6 +46,28 @@
 
 #include "FieldmlIoContext.h"
 
+/**
+ * Storage options for newly created arrays. These are hints; formats that have no use for them ignore them.
+ */
+class ArrayDataWriterOptions
+{
+public:
+    //Per-dimension chunk sizes, or NULL to choose them automatically when chunking is required.
+    const int *chunkSizes;
+    
+    //Per-dimension maximum sizes, with FML_ARRAY_UNLIMITED_SIZE for unlimited dimensions, or NULL for fixed sizes.
+    const int *maxSizes;
+    
+    //Deflate compression level, from 0 (no compression) to 9.
+    int deflateLevel;
+    
+    bool shuffle;
+    
+    ArrayDataWriterOptions() :
+        chunkSizes( NULL ), maxSizes( NULL ), deflateLevel( 0 ), shuffle( false ) {}
+};
+
+
 class ArrayDataWriter
 {
 protected:
@@ -60,11 +82,17 @@ public:
     //TODO Provide options for writing from 32/64 bit packed boolean arrays?
     virtual FmlIoErrorNumber writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer ) = 0;
     
+    /**
+     * Sets the number of significant digits used for double-precision values, for writers that format values as text.
+     * Zero selects just enough digits to read back exactly.
+     */
+    virtual FmlIoErrorNumber setPrecision( int significantDigits );
+    
     virtual FmlIoErrorNumber close() = 0;
     
     virtual ~ArrayDataWriter();
     
-    static ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank );
+    static ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, const ArrayDataWriterOptions &options );
 };
 
 
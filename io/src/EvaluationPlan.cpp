@@ -0,0 +1,1801 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "StringUtil.h"
+#include "fieldml_api.h"
+
+#include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
+#include "EvaluationPlan.h"
+#include "LagrangeInterpolator.h"
+#include "ParameterCache.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//Points are evaluated in blocks of this size, keeping intermediate results small enough to stay in cache.
+static const int EVALUATION_BLOCK_SIZE = 1024;
+
+static const double UNDEFINED_VALUE = numeric_limits<double>::quiet_NaN();
+
+//========================================================================
+//
+// Utility
+//
+//========================================================================
+
+/**
+ * Returns the number of components in a value of the given type, or -1 if the type cannot be evaluated.
+ * Ensemble values are carried as doubles, so they have a single component.
+ */
+static int getTypeComponentCount( FmlSessionHandle session, FmlObjectHandle typeHandle )
+{
+    FmlObjectHandle componentEnsemble;
+    
+    switch( Fieldml_GetObjectType( session, typeHandle ) )
+    {
+    case FHT_ENSEMBLE_TYPE:
+        return 1;
+    case FHT_CONTINUOUS_TYPE:
+        componentEnsemble = Fieldml_GetTypeComponentEnsemble( session, typeHandle );
+        return ( componentEnsemble == FML_INVALID_HANDLE ) ? 1 : Fieldml_GetMemberCount( session, componentEnsemble );
+    default:
+        return -1;
+    }
+}
+
+
+static bool getEnsembleRange( FmlSessionHandle session, FmlObjectHandle typeHandle, FmlEnsembleValue &min, int &stride, int &count )
+{
+    if( Fieldml_GetObjectType( session, typeHandle ) != FHT_ENSEMBLE_TYPE )
+    {
+        return false;
+    }
+    if( Fieldml_GetEnsembleMembersType( session, typeHandle ) != FML_ENSEMBLE_MEMBER_RANGE )
+    {
+        return false;
+    }
+    
+    min = Fieldml_GetEnsembleMembersMin( session, typeHandle );
+    stride = Fieldml_GetEnsembleMembersStride( session, typeHandle );
+    count = Fieldml_GetMemberCount( session, typeHandle );
+    
+    return ( stride > 0 ) && ( count >= 0 );
+}
+
+
+//========================================================================
+//
+// Evaluation state
+//
+//========================================================================
+
+/**
+ * Per-call evaluation state, shared by all the nodes evaluated for the current block of points.
+ * 
+ * If derivativeDirection is non-negative, nodes give the derivative of their value with respect to that xi
+ * coordinate rather than the value itself. Ensemble values, such as piecewise and parameter indexes, never
+ * depend on xi, so they are always evaluated as values.
+ */
+class EvaluationState
+{
+private:
+    int nextPointsId;
+    
+public:
+    const FmlObjectHandle elementArgument;
+    
+    const FmlObjectHandle xiArgument;
+    
+    const int xiCount;
+    
+    const FmlEnsembleValue *elements;
+    
+    const double *xi;
+    
+    int derivativeDirection;
+    
+    EvaluationState( FmlObjectHandle _elementArgument, FmlObjectHandle _xiArgument, int _xiCount, int _derivativeDirection ) :
+        nextPointsId( 0 ),
+        elementArgument( _elementArgument ),
+        xiArgument( _xiArgument ),
+        xiCount( _xiCount ),
+        elements( NULL ),
+        xi( NULL ),
+        derivativeDirection( _derivativeDirection )
+    {
+    }
+    
+    
+    int newPointsId()
+    {
+        return nextPointsId++;
+    }
+};
+
+
+/**
+ * A set of points within the current block. Evaluating a piecewise evaluator splits the points it is given
+ * into subsets, one for each distinct evaluator it delegates to. Each set of points gets a unique id, so that
+ * values cached for one set of points are never used for another.
+ */
+class EvaluationPoints
+{
+public:
+    const int count;
+    
+    //Indices into the current block, or NULL if these are all the block's points in order.
+    const int * const indices;
+    
+    const int id;
+    
+    EvaluationPoints( int _count, const int *_indices, int _id ) :
+        count( _count ),
+        indices( _indices ),
+        id( _id )
+    {
+    }
+    
+    
+    int at( int i ) const
+    {
+        return ( indices == NULL ) ? i : indices[i];
+    }
+};
+
+
+class EvaluationNode;
+
+/**
+ * A bind from an evaluator, compiled.
+ */
+class EvaluationBinding
+{
+public:
+    FmlObjectHandle argument;
+    
+    EvaluationNode *source;
+};
+
+
+/**
+ * The arguments bound while evaluating an evaluator. A frame either holds the binds of a reference, piecewise
+ * or aggregate evaluator, whose sources are evaluated in the parent frame, or binds a single index argument
+ * to a fixed ensemble value.
+ * 
+ * If an argument that has arguments of its own is bound, its source is evaluated with those arguments taken
+ * from where the argument is used. This is done with a forwarding frame, whose sources are evaluated in the
+ * using frame instead of the parent.
+ */
+class EvaluationFrame
+{
+private:
+    vector<int> cachedPointsIds;
+    
+    vector<int> cachedDirections;
+    
+    vector< vector<double> > cachedValues;
+    
+public:
+    EvaluationFrame * const parent;
+    
+    EvaluationFrame * const sourceFrame;
+    
+    const vector<EvaluationBinding> * const bindings;
+    
+    const FmlObjectHandle indexArgument;
+    
+    const FmlEnsembleValue indexValue;
+    
+    EvaluationFrame( EvaluationFrame *_parent, const vector<EvaluationBinding> *_bindings ) :
+        parent( _parent ),
+        sourceFrame( _parent ),
+        bindings( _bindings ),
+        indexArgument( FML_INVALID_HANDLE ),
+        indexValue( 0 )
+    {
+    }
+    
+    
+    EvaluationFrame( EvaluationFrame *_parent, const vector<EvaluationBinding> *_bindings, EvaluationFrame *_sourceFrame ) :
+        parent( _parent ),
+        sourceFrame( _sourceFrame ),
+        bindings( _bindings ),
+        indexArgument( FML_INVALID_HANDLE ),
+        indexValue( 0 )
+    {
+    }
+    
+    
+    EvaluationFrame( EvaluationFrame *_parent, FmlObjectHandle _indexArgument, FmlEnsembleValue _indexValue ) :
+        parent( _parent ),
+        sourceFrame( _parent ),
+        bindings( NULL ),
+        indexArgument( _indexArgument ),
+        indexValue( _indexValue )
+    {
+    }
+    
+    
+    FmlIoErrorNumber evaluateBinding( EvaluationState &state, int bindingIndex, int componentCount, const vector<EvaluationBinding> &forwardings,
+        EvaluationFrame *usingFrame, const EvaluationPoints &points, double *values );
+};
+
+
+//========================================================================
+//
+// Nodes
+//
+//========================================================================
+
+/**
+ * A compiled evaluator. Values are evaluated for a set of points at a time, and stored component-major, so
+ * component c of the value at point i is values[c * points.count + i].
+ */
+class EvaluationNode
+{
+public:
+    const FmlObjectHandle handle;
+    
+    int componentCount;
+    
+    EvaluationNode( FmlObjectHandle _handle ) :
+        handle( _handle ),
+        componentCount( 1 )
+    {
+    }
+    
+    
+    virtual FmlIoErrorNumber compile( EvaluationPlan &plan ) = 0;
+    
+    virtual FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values ) = 0;
+    
+    virtual ~EvaluationNode()
+    {
+    }
+};
+
+
+FmlIoErrorNumber EvaluationFrame::evaluateBinding( EvaluationState &state, int bindingIndex, int componentCount, const vector<EvaluationBinding> &forwardings,
+    EvaluationFrame *usingFrame, const EvaluationPoints &points, double *values )
+{
+    const int valueCount = componentCount * points.count;
+    
+    //Values that depend on where the argument is used cannot be cached here.
+    const bool isCacheable = forwardings.empty();
+    
+    if( cachedPointsIds.empty() )
+    {
+        cachedPointsIds.resize( bindings->size(), -1 );
+        cachedDirections.resize( bindings->size(), -1 );
+        cachedValues.resize( bindings->size() );
+    }
+    else if( isCacheable && ( cachedPointsIds[bindingIndex] == points.id ) && ( cachedDirections[bindingIndex] == state.derivativeDirection ) )
+    {
+        copy( cachedValues[bindingIndex].begin(), cachedValues[bindingIndex].end(), values );
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    EvaluationFrame forwardingFrame( sourceFrame, &forwardings, usingFrame );
+    EvaluationFrame *frame = isCacheable ? sourceFrame : &forwardingFrame;
+    
+    FmlIoErrorNumber error = (*bindings)[bindingIndex].source->evaluate( state, frame, points, values );
+    
+    if( isCacheable && ( error == FML_IOERR_NO_ERROR ) )
+    {
+        cachedValues[bindingIndex].assign( values, values + valueCount );
+        cachedPointsIds[bindingIndex] = points.id;
+        cachedDirections[bindingIndex] = state.derivativeDirection;
+    }
+    
+    return error;
+}
+
+
+/**
+ * Evaluates the value of the given node, even when evaluating derivatives.
+ */
+static FmlIoErrorNumber evaluateValues( EvaluationNode *node, EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+{
+    const int derivativeDirection = state.derivativeDirection;
+    state.derivativeDirection = -1;
+    FmlIoErrorNumber error = node->evaluate( state, frame, points, values );
+    state.derivativeDirection = derivativeDirection;
+    
+    return error;
+}
+
+
+/**
+ * Finds the value of the given argument by searching the frames outwards, and finally the plan's inputs.
+ */
+static FmlIoErrorNumber lookupArgument( EvaluationState &state, EvaluationFrame *frame, FmlObjectHandle argument, int componentCount,
+    const vector<EvaluationBinding> &forwardings, const EvaluationPoints &points, double *values )
+{
+    for( EvaluationFrame *f = frame; f != NULL; f = f->parent )
+    {
+        if( f->indexArgument == argument )
+        {
+            fill( values, values + points.count, ( state.derivativeDirection < 0 ) ? (double)f->indexValue : 0.0 );
+            return FML_IOERR_NO_ERROR;
+        }
+        if( f->bindings == NULL )
+        {
+            continue;
+        }
+        
+        for( unsigned int i = 0; i < f->bindings->size(); i++ )
+        {
+            if( (*f->bindings)[i].argument == argument )
+            {
+                return f->evaluateBinding( state, i, componentCount, forwardings, frame, points, values );
+            }
+        }
+    }
+    
+    if( ( argument == state.elementArgument ) && ( state.derivativeDirection >= 0 ) )
+    {
+        fill( values, values + points.count, 0.0 );
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    if( argument == state.elementArgument )
+    {
+        for( int i = 0; i < points.count; i++ )
+        {
+            values[i] = state.elements[points.at( i )];
+        }
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    if( ( argument == state.xiArgument ) && ( state.derivativeDirection >= 0 ) )
+    {
+        for( int c = 0; c < state.xiCount; c++ )
+        {
+            fill( values + c * points.count, values + ( c + 1 ) * points.count, ( c == state.derivativeDirection ) ? 1.0 : 0.0 );
+        }
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    if( argument == state.xiArgument )
+    {
+        for( int c = 0; c < state.xiCount; c++ )
+        {
+            double *componentValues = values + c * points.count;
+            for( int i = 0; i < points.count; i++ )
+            {
+                componentValues[i] = state.xi[points.at( i ) * state.xiCount + c];
+            }
+        }
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    return FML_IOERR_UNBOUND_ARGUMENT;
+}
+
+
+static FmlIoErrorNumber compileBindings( EvaluationPlan &plan, FmlObjectHandle handle, vector<EvaluationBinding> &bindings )
+{
+    FieldmlIoContext *context = plan.getContext();
+    FmlSessionHandle session = context->getSession();
+    
+    int count = Fieldml_GetBindCount( session, handle );
+    if( count < 0 )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    for( int i = 1; i <= count; i++ )
+    {
+        EvaluationBinding binding;
+        binding.argument = Fieldml_GetBindArgument( session, handle, i );
+        
+        FmlIoErrorNumber error = plan.getNode( Fieldml_GetBindEvaluator( session, handle, i ), binding.source );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        int argumentCount = getTypeComponentCount( session, Fieldml_GetValueType( session, binding.argument ) );
+        if( argumentCount != binding.source->componentCount )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        bindings.push_back( binding );
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+class ArgumentNode :
+    public EvaluationNode
+{
+private:
+    //Binds each of the argument's own arguments to itself, for forwarding them from where the argument is used.
+    vector<EvaluationBinding> forwardings;
+    
+public:
+    ArgumentNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FmlSessionHandle session = plan.getContext()->getSession();
+        
+        int argumentCount = Fieldml_GetArgumentCount( session, handle, 0, 1 );
+        if( argumentCount < 0 )
+        {
+            return plan.getContext()->setError( FML_IOERR_CORE_ERROR );
+        }
+        for( int i = 1; i <= argumentCount; i++ )
+        {
+            EvaluationBinding forwarding;
+            forwarding.argument = Fieldml_GetArgument( session, handle, i, 0, 1 );
+            if( forwarding.argument == handle )
+            {
+                continue;
+            }
+            
+            FmlIoErrorNumber error = plan.getNode( forwarding.argument, forwarding.source );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            forwardings.push_back( forwarding );
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        return lookupArgument( state, frame, handle, componentCount, forwardings, points, values );
+    }
+};
+
+
+class ConstantNode :
+    public EvaluationNode
+{
+private:
+    vector<double> constants;
+    
+public:
+    ConstantNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        string valueString;
+        char *temp_string = Fieldml_GetConstantEvaluatorValueString( plan.getContext()->getSession(), handle );
+        bool haveString = StringUtil::safeString( temp_string, valueString );
+        Fieldml_FreeString( temp_string );
+        if( !haveString )
+        {
+            return plan.getContext()->setError( FML_IOERR_CORE_ERROR );
+        }
+        
+        const char *s = valueString.c_str();
+        while( *s != 0 )
+        {
+            char *end;
+            double value = strtod( s, &end );
+            if( end != s )
+            {
+                constants.push_back( value );
+                s = end;
+            }
+            else if( ( *s == ',' ) || isspace( (unsigned char)*s ) )
+            {
+                s++;
+            }
+            else
+            {
+                return plan.getContext()->setError( FML_IOERR_INVALID_PARAMETER );
+            }
+        }
+        
+        if( (int)constants.size() != componentCount )
+        {
+            return plan.getContext()->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame * /*frame*/, const EvaluationPoints &points, double *values )
+    {
+        for( int c = 0; c < componentCount; c++ )
+        {
+            fill( values + c * points.count, values + ( c + 1 ) * points.count, ( state.derivativeDirection < 0 ) ? constants[c] : 0.0 );
+        }
+        return FML_IOERR_NO_ERROR;
+    }
+};
+
+
+class ReferenceNode :
+    public EvaluationNode
+{
+private:
+    EvaluationNode *source;
+    
+    vector<EvaluationBinding> bindings;
+    
+public:
+    ReferenceNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle ),
+        source( NULL )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FmlIoErrorNumber error = plan.getNode( Fieldml_GetReferenceSourceEvaluator( plan.getContext()->getSession(), handle ), source );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        if( source->componentCount != componentCount )
+        {
+            return plan.getContext()->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        return compileBindings( plan, handle, bindings );
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        EvaluationFrame referenceFrame( frame, &bindings );
+        return source->evaluate( state, &referenceFrame, points, values );
+    }
+};
+
+
+class PiecewiseNode :
+    public EvaluationNode
+{
+private:
+    EvaluationNode *index;
+    
+    vector<EvaluationBinding> bindings;
+    
+    //Ranges of index values, in ascending order, and the evaluator used for each.
+    vector<FmlEnsembleValue> rangeMins;
+    
+    vector<FmlEnsembleValue> rangeMaxes;
+    
+    vector<EvaluationNode *> rangeNodes;
+    
+    EvaluationNode *defaultNode;
+    
+    
+    EvaluationNode *getPieceNode( double indexValue )
+    {
+        if( indexValue != indexValue )
+        {
+            return NULL;
+        }
+        
+        FmlEnsembleValue value = (FmlEnsembleValue)indexValue;
+        vector<FmlEnsembleValue>::const_iterator i = upper_bound( rangeMins.begin(), rangeMins.end(), value );
+        if( i != rangeMins.begin() )
+        {
+            int range = ( i - rangeMins.begin() ) - 1;
+            if( value <= rangeMaxes[range] )
+            {
+                return rangeNodes[range];
+            }
+        }
+        
+        return defaultNode;
+    }
+    
+public:
+    PiecewiseNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle ),
+        index( NULL ),
+        defaultNode( NULL )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FieldmlIoContext *context = plan.getContext();
+        FmlSessionHandle session = context->getSession();
+        
+        FmlIoErrorNumber error = plan.getNode( Fieldml_GetIndexEvaluator( session, handle, 1 ), index );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        int rangeCount = Fieldml_GetEvaluatorRangeCount( session, handle );
+        if( rangeCount < 0 )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        
+        for( int i = 1; i <= rangeCount; i++ )
+        {
+            EvaluationNode *node;
+            error = plan.getNode( Fieldml_GetEvaluatorRangeEvaluator( session, handle, i ), node );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            if( node->componentCount != componentCount )
+            {
+                return context->setError( FML_IOERR_UNSUPPORTED );
+            }
+            
+            rangeMins.push_back( Fieldml_GetEvaluatorRangeMin( session, handle, i ) );
+            rangeMaxes.push_back( Fieldml_GetEvaluatorRangeMax( session, handle, i ) );
+            rangeNodes.push_back( node );
+        }
+        
+        FmlObjectHandle defaultEvaluator = Fieldml_GetDefaultEvaluator( session, handle );
+        if( defaultEvaluator != FML_INVALID_HANDLE )
+        {
+            error = plan.getNode( defaultEvaluator, defaultNode );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            if( defaultNode->componentCount != componentCount )
+            {
+                return context->setError( FML_IOERR_UNSUPPORTED );
+            }
+        }
+        
+        return compileBindings( plan, handle, bindings );
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        EvaluationFrame piecewiseFrame( frame, &bindings );
+        const int count = points.count;
+        
+        vector<double> indexValues( count );
+        FmlIoErrorNumber error = evaluateValues( index, state, &piecewiseFrame, points, &indexValues[0] );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        vector<EvaluationNode *> pieceNodes( count );
+        bool isUniform = true;
+        for( int i = 0; i < count; i++ )
+        {
+            pieceNodes[i] = getPieceNode( indexValues[i] );
+            isUniform = isUniform && ( pieceNodes[i] == pieceNodes[0] );
+        }
+        
+        if( isUniform )
+        {
+            if( pieceNodes[0] == NULL )
+            {
+                fill( values, values + componentCount * count, UNDEFINED_VALUE );
+                return FML_IOERR_NO_ERROR;
+            }
+            return pieceNodes[0]->evaluate( state, &piecewiseFrame, points, values );
+        }
+        
+        //Evaluate each distinct piece once, for just the points that use it.
+        vector<EvaluationNode *> evaluated;
+        vector<int> positions;
+        vector<int> indices;
+        vector<double> pieceValues;
+        for( int i = 0; i < count; i++ )
+        {
+            EvaluationNode *node = pieceNodes[i];
+            if( find( evaluated.begin(), evaluated.end(), node ) != evaluated.end() )
+            {
+                continue;
+            }
+            evaluated.push_back( node );
+            
+            positions.clear();
+            indices.clear();
+            for( int j = i; j < count; j++ )
+            {
+                if( pieceNodes[j] == node )
+                {
+                    positions.push_back( j );
+                    indices.push_back( points.at( j ) );
+                }
+            }
+            
+            const int pieceCount = positions.size();
+            if( node == NULL )
+            {
+                for( int c = 0; c < componentCount; c++ )
+                {
+                    for( int j = 0; j < pieceCount; j++ )
+                    {
+                        values[c * count + positions[j]] = UNDEFINED_VALUE;
+                    }
+                }
+                continue;
+            }
+            
+            EvaluationPoints piecePoints( pieceCount, &indices[0], state.newPointsId() );
+            pieceValues.resize( componentCount * pieceCount );
+            error = node->evaluate( state, &piecewiseFrame, piecePoints, &pieceValues[0] );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            
+            for( int c = 0; c < componentCount; c++ )
+            {
+                for( int j = 0; j < pieceCount; j++ )
+                {
+                    values[c * count + positions[j]] = pieceValues[c * pieceCount + j];
+                }
+            }
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+};
+
+
+class AggregateNode :
+    public EvaluationNode
+{
+private:
+    FmlObjectHandle indexArgument;
+    
+    vector<FmlEnsembleValue> members;
+    
+    vector<EvaluationNode *> componentNodes;
+    
+    vector<EvaluationBinding> bindings;
+    
+public:
+    AggregateNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle ),
+        indexArgument( FML_INVALID_HANDLE )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FieldmlIoContext *context = plan.getContext();
+        FmlSessionHandle session = context->getSession();
+        
+        indexArgument = Fieldml_GetIndexEvaluator( session, handle, 1 );
+        FmlEnsembleValue min;
+        int stride, memberCount;
+        if( !getEnsembleRange( session, Fieldml_GetValueType( session, indexArgument ), min, stride, memberCount ) )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        if( memberCount != componentCount )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        for( int c = 0; c < componentCount; c++ )
+        {
+            FmlEnsembleValue member = min + c * stride;
+            FmlObjectHandle componentEvaluator = Fieldml_GetElementEvaluator( session, handle, member, 1 );
+            EvaluationNode *node = NULL;
+            if( componentEvaluator != FML_INVALID_HANDLE )
+            {
+                FmlIoErrorNumber error = plan.getNode( componentEvaluator, node );
+                if( error != FML_IOERR_NO_ERROR )
+                {
+                    return error;
+                }
+                if( node->componentCount != 1 )
+                {
+                    return context->setError( FML_IOERR_UNSUPPORTED );
+                }
+            }
+            
+            members.push_back( member );
+            componentNodes.push_back( node );
+        }
+        
+        return compileBindings( plan, handle, bindings );
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        for( int c = 0; c < componentCount; c++ )
+        {
+            double *componentValues = values + c * points.count;
+            if( componentNodes[c] == NULL )
+            {
+                fill( componentValues, componentValues + points.count, UNDEFINED_VALUE );
+                continue;
+            }
+            
+            //The index is visible to the aggregate's bind sources as well as to the component evaluator.
+            EvaluationFrame indexFrame( frame, indexArgument, members[c] );
+            EvaluationFrame aggregateFrame( &indexFrame, &bindings );
+            FmlIoErrorNumber error = componentNodes[c]->evaluate( state, &aggregateFrame, points, componentValues );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+};
+
+
+/**
+ * Copies the values at the given offsets, plus a common offset, from the source data. Negative offsets give NaN.
+ */
+template<typename T> static void gatherValues( const T *source, const int *offsets, const int offset, const int count, double *values )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        values[i] = ( offsets[i] < 0 ) ? UNDEFINED_VALUE : (double)source[offsets[i] + offset];
+    }
+}
+
+
+/**
+ * A dense or DOK parameter evaluator, with its data held in the session's parameter cache. A vector-valued parameter
+ * evaluator must have a dense index over its value type's component ensemble, which is iterated to give each component.
+ */
+class ParameterNode :
+    public EvaluationNode
+{
+private:
+    bool isDok;
+    
+    vector<EvaluationNode *> denseIndexes;
+    
+    vector<FmlEnsembleValue> denseMins;
+    
+    vector<int> denseStrides;
+    
+    vector<int> denseSizes;
+    
+    //The offset between consecutive values of each dense index in the data.
+    vector<int> dataStrides;
+    
+    int componentIndex;
+    
+    vector<EvaluationNode *> sparseIndexes;
+    
+    ParameterArray *keys;
+    
+    int rowStride;
+    
+    ParameterArray *data;
+    
+public:
+    ParameterNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle ),
+        isDok( false ),
+        componentIndex( -1 ),
+        keys( NULL ),
+        rowStride( 0 ),
+        data( NULL )
+    {
+    }
+    
+    
+    virtual ~ParameterNode()
+    {
+        ParameterCache &cache = FieldmlIoSession::getSession().getParameterCache();
+        if( keys != NULL )
+        {
+            cache.release( keys );
+        }
+        if( data != NULL )
+        {
+            cache.release( data );
+        }
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FieldmlIoContext *context = plan.getContext();
+        FmlSessionHandle session = context->getSession();
+        FmlIoErrorNumber error;
+        
+        FieldmlDataDescriptionType description = Fieldml_GetParameterDataDescription( session, handle );
+        if( description == FML_DATA_DESCRIPTION_DOK_ARRAY )
+        {
+            isDok = true;
+        }
+        else if( description != FML_DATA_DESCRIPTION_DENSE_ARRAY )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        FmlObjectHandle valueType = Fieldml_GetValueType( session, handle );
+        FmlObjectHandle componentEnsemble = FML_INVALID_HANDLE;
+        if( componentCount > 1 )
+        {
+            componentEnsemble = Fieldml_GetTypeComponentEnsemble( session, valueType );
+        }
+        
+        int denseCount = Fieldml_GetParameterIndexCount( session, handle, 0 );
+        if( denseCount < 0 )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        for( int i = 1; i <= denseCount; i++ )
+        {
+            FmlObjectHandle indexEvaluator = Fieldml_GetParameterIndexEvaluator( session, handle, i, 0 );
+            if( Fieldml_GetParameterIndexOrder( session, handle, i ) != FML_INVALID_HANDLE )
+            {
+                return context->setError( FML_IOERR_UNSUPPORTED );
+            }
+            
+            EvaluationNode *node;
+            error = plan.getNode( indexEvaluator, node );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            
+            FmlObjectHandle indexType = Fieldml_GetValueType( session, indexEvaluator );
+            FmlEnsembleValue min;
+            int stride, memberCount;
+            if( !getEnsembleRange( session, indexType, min, stride, memberCount ) )
+            {
+                return context->setError( FML_IOERR_UNSUPPORTED );
+            }
+            if( ( indexType == componentEnsemble ) && ( componentIndex == -1 ) )
+            {
+                componentIndex = i - 1;
+            }
+            
+            denseIndexes.push_back( node );
+            denseMins.push_back( min );
+            denseStrides.push_back( stride );
+        }
+        
+        if( ( componentCount > 1 ) && ( componentIndex == -1 ) )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        const bool isInteger = Fieldml_GetObjectType( session, valueType ) == FHT_ENSEMBLE_TYPE;
+        error = FieldmlIoSession::getSession().getParameterCache().acquire( context, Fieldml_GetDataSource( session, handle ), isInteger, data );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        const vector<int> &sizes = data->sizes;
+        const int firstDenseDimension = isDok ? 1 : 0;
+        if( (int)sizes.size() != firstDenseDimension + denseCount )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        
+        denseSizes.assign( sizes.begin() + firstDenseDimension, sizes.end() );
+        dataStrides.resize( denseCount );
+        int stride = 1;
+        for( int i = denseCount - 1; i >= 0; i-- )
+        {
+            dataStrides[i] = stride;
+            stride *= denseSizes[i];
+        }
+        rowStride = stride;
+        
+        if( ( componentIndex != -1 ) && ( denseSizes[componentIndex] < componentCount ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        
+        if( isDok )
+        {
+            error = compileKeys( plan, sizes[0] );
+        }
+        
+        return error;
+    }
+    
+    
+    FmlIoErrorNumber compileKeys( EvaluationPlan &plan, int rowCount )
+    {
+        FieldmlIoContext *context = plan.getContext();
+        FmlSessionHandle session = context->getSession();
+        
+        int sparseCount = Fieldml_GetParameterIndexCount( session, handle, 1 );
+        if( sparseCount < 0 )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        for( int i = 1; i <= sparseCount; i++ )
+        {
+            EvaluationNode *node;
+            FmlIoErrorNumber error = plan.getNode( Fieldml_GetParameterIndexEvaluator( session, handle, i, 1 ), node );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            sparseIndexes.push_back( node );
+        }
+        
+        FmlIoErrorNumber error = FieldmlIoSession::getSession().getParameterCache().acquire( context, Fieldml_GetKeyDataSource( session, handle ), true, keys );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        const vector<int> &keySizes = keys->sizes;
+        if( ( keySizes.size() != 2 ) || ( keySizes[0] != rowCount ) || ( keySizes[1] != sparseCount ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        keys->indexRows();
+        
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        if( state.derivativeDirection >= 0 )
+        {
+            //Parameters do not depend on xi, but are still undefined wherever their value is.
+            FmlIoErrorNumber error = evaluateValues( this, state, frame, points, values );
+            for( int i = 0; i < componentCount * points.count; i++ )
+            {
+                values[i] = ( values[i] == values[i] ) ? 0.0 : UNDEFINED_VALUE;
+            }
+            return error;
+        }
+        
+        const int count = points.count;
+        
+        //The offset of each point's value in the data, or -1 if it is not defined.
+        vector<int> offsets( count, 0 );
+        vector<double> indexValues( count );
+        FmlIoErrorNumber error;
+        
+        if( isDok )
+        {
+            const int sparseCount = sparseIndexes.size();
+            vector<double> sparseValues( sparseCount * count );
+            for( int s = 0; s < sparseCount; s++ )
+            {
+                error = sparseIndexes[s]->evaluate( state, frame, points, &sparseValues[s * count] );
+                if( error != FML_IOERR_NO_ERROR )
+                {
+                    return error;
+                }
+            }
+            
+            vector<FmlEnsembleValue> key( sparseCount );
+            for( int i = 0; i < count; i++ )
+            {
+                for( int s = 0; s < sparseCount; s++ )
+                {
+                    key[s] = (FmlEnsembleValue)sparseValues[s * count + i];
+                }
+                const int row = ( sparseCount == 0 ) ? -1 : keys->findRow( &key[0] );
+                offsets[i] = ( row < 0 ) ? -1 : row * rowStride;
+            }
+        }
+        
+        for( unsigned int d = 0; d < denseIndexes.size(); d++ )
+        {
+            if( (int)d == componentIndex )
+            {
+                continue;
+            }
+            
+            error = denseIndexes[d]->evaluate( state, frame, points, &indexValues[0] );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            
+            const FmlEnsembleValue min = denseMins[d];
+            const int stride = denseStrides[d];
+            const int size = denseSizes[d];
+            const int dataStride = dataStrides[d];
+            for( int i = 0; i < count; i++ )
+            {
+                if( offsets[i] < 0 )
+                {
+                    continue;
+                }
+                
+                double value = indexValues[i];
+                int position = -1;
+                if( value == value )
+                {
+                    FmlEnsembleValue delta = (FmlEnsembleValue)value - min;
+                    if( ( delta >= 0 ) && ( delta % stride == 0 ) && ( delta / stride < size ) )
+                    {
+                        position = delta / stride;
+                    }
+                }
+                
+                offsets[i] = ( position < 0 ) ? -1 : offsets[i] + position * dataStride;
+            }
+        }
+        
+        for( int c = 0; c < componentCount; c++ )
+        {
+            const int componentOffset = ( componentIndex == -1 ) ? 0 : c * dataStrides[componentIndex];
+            if( data->isInteger )
+            {
+                gatherValues( data->intValues.empty() ? NULL : &data->intValues[0], &offsets[0], componentOffset, count, values + c * count );
+            }
+            else
+            {
+                gatherValues( data->doubleValues.empty() ? NULL : &data->doubleValues[0], &offsets[0], componentOffset, count, values + c * count );
+            }
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+};
+
+
+static bool isNonZero( double value )
+{
+    return value != 0.0;
+}
+
+
+/**
+ * An external evaluator, which must be one of the library interpolators with a built-in implementation.
+ */
+class ExternalNode :
+    public EvaluationNode
+{
+private:
+    const LagrangeInterpolator *interpolator;
+    
+    EvaluationNode *chart;
+    
+    EvaluationNode *parameters;
+    
+public:
+    ExternalNode( FmlObjectHandle _handle ) :
+        EvaluationNode( _handle ),
+        interpolator( NULL ),
+        chart( NULL ),
+        parameters( NULL )
+    {
+    }
+    
+    
+    FmlIoErrorNumber compile( EvaluationPlan &plan )
+    {
+        FieldmlIoContext *context = plan.getContext();
+        FmlSessionHandle session = context->getSession();
+        
+        string name;
+        char *temp_string = Fieldml_GetObjectDeclaredName( session, handle );
+        bool haveName = StringUtil::safeString( temp_string, name );
+        Fieldml_FreeString( temp_string );
+        if( !haveName )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        
+        interpolator = LagrangeInterpolator::find( name );
+        if( ( interpolator == NULL ) || ( componentCount != 1 ) )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        //The chart and parameter arguments are told apart by their component counts.
+        int argumentCount = Fieldml_GetArgumentCount( session, handle, 0, 1 );
+        if( argumentCount < 0 )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        for( int i = 1; i <= argumentCount; i++ )
+        {
+            EvaluationNode *node;
+            FmlIoErrorNumber error = plan.getNode( Fieldml_GetArgument( session, handle, i, 0, 1 ), node );
+            if( error != FML_IOERR_NO_ERROR )
+            {
+                return error;
+            }
+            
+            if( node->componentCount == interpolator->dimensions )
+            {
+                chart = node;
+            }
+            else if( node->componentCount == interpolator->basisCount )
+            {
+                parameters = node;
+            }
+        }
+        
+        if( ( chart == NULL ) || ( parameters == NULL ) )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    
+    FmlIoErrorNumber evaluate( EvaluationState &state, EvaluationFrame *frame, const EvaluationPoints &points, double *values )
+    {
+        const int count = points.count;
+        
+        vector<double> xi( chart->componentCount * count );
+        FmlIoErrorNumber error = evaluateValues( chart, state, frame, points, &xi[0] );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        vector<double> parameterValues( parameters->componentCount * count );
+        error = parameters->evaluate( state, frame, points, &parameterValues[0] );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        //Either the value, or the derivative with respect to the parameters.
+        interpolator->kernel( count, &xi[0], &parameterValues[0], -1, values );
+        if( state.derivativeDirection < 0 )
+        {
+            return FML_IOERR_NO_ERROR;
+        }
+        
+        //Add the derivative with respect to the chart coordinates, by the chain rule.
+        vector<double> chartDerivatives( chart->componentCount * count );
+        error = chart->evaluate( state, frame, points, &chartDerivatives[0] );
+        if( error == FML_IOERR_NO_ERROR )
+        {
+            error = evaluateValues( parameters, state, frame, points, &parameterValues[0] );
+        }
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        vector<double> basisDerivatives( count );
+        for( int d = 0; d < interpolator->dimensions; d++ )
+        {
+            const double *directionDerivatives = &chartDerivatives[d * count];
+            if( count_if( directionDerivatives, directionDerivatives + count, isNonZero ) == 0 )
+            {
+                continue;
+            }
+            
+            interpolator->kernel( count, &xi[0], &parameterValues[0], d, &basisDerivatives[0] );
+            for( int i = 0; i < count; i++ )
+            {
+                values[i] += directionDerivatives[i] * basisDerivatives[i];
+            }
+        }
+        
+        return FML_IOERR_NO_ERROR;
+    }
+};
+
+
+//========================================================================
+//
+// EvaluationBatch
+//
+//========================================================================
+
+/**
+ * Evaluates a plan at a batch of points on several threads. The points are divided into blocks, and each thread starts
+ * with an equal share of them. A thread that runs out of blocks takes half of the blocks remaining in another thread's
+ * share, so that threads whose points are cheap to evaluate help out those whose points are not.
+ */
+class EvaluationBatch :
+    public ThreadTask
+{
+private:
+    //The blocks, from next up to but not including end, that a thread has still to evaluate.
+    class BlockRange
+    {
+    public:
+        Mutex mutex;
+        
+        int next;
+        
+        int end;
+    };
+    
+    EvaluationPlan &plan;
+    
+    const int pointCount;
+    
+    const FmlEnsembleValue * const elements;
+    
+    const double * const xi;
+    
+    double * const values;
+    
+    vector<BlockRange *> ranges;
+    
+    Mutex errorMutex;
+    
+    FmlIoErrorNumber error;
+    
+    
+    bool takeBlock( BlockRange &range, int &block )
+    {
+        MutexLock lock( range.mutex );
+        if( range.next >= range.end )
+        {
+            return false;
+        }
+        
+        block = range.next++;
+        return true;
+    }
+    
+    
+    bool steal( int threadIndex )
+    {
+        const int threadCount = ranges.size();
+        for( int i = 1; i < threadCount; i++ )
+        {
+            BlockRange &victim = *ranges[( threadIndex + i ) % threadCount];
+            int first, end;
+            {
+                MutexLock lock( victim.mutex );
+                const int remaining = victim.end - victim.next;
+                if( remaining <= 0 )
+                {
+                    continue;
+                }
+                end = victim.end;
+                first = end - ( remaining + 1 ) / 2;
+                victim.end = first;
+            }
+            
+            BlockRange &range = *ranges[threadIndex];
+            MutexLock lock( range.mutex );
+            range.next = first;
+            range.end = end;
+            return true;
+        }
+        
+        return false;
+    }
+    
+    
+    bool hasFailed()
+    {
+        MutexLock lock( errorMutex );
+        return error != FML_IOERR_NO_ERROR;
+    }
+    
+public:
+    EvaluationBatch( EvaluationPlan &_plan, const int threadCount, const int _pointCount, const FmlEnsembleValue *_elements, const double *_xi, double *_values ) :
+        plan( _plan ),
+        pointCount( _pointCount ),
+        elements( _elements ),
+        xi( _xi ),
+        values( _values ),
+        error( FML_IOERR_NO_ERROR )
+    {
+        const int blockCount = ( pointCount + EVALUATION_BLOCK_SIZE - 1 ) / EVALUATION_BLOCK_SIZE;
+        for( int i = 0; i < threadCount; i++ )
+        {
+            BlockRange *range = new BlockRange();
+            range->next = (int)( (double)blockCount * i / threadCount );
+            range->end = (int)( (double)blockCount * ( i + 1 ) / threadCount );
+            ranges.push_back( range );
+        }
+    }
+    
+    
+    virtual ~EvaluationBatch()
+    {
+        for( vector<BlockRange *>::iterator i = ranges.begin(); i != ranges.end(); i++ )
+        {
+            delete *i;
+        }
+    }
+    
+    
+    void execute( int threadIndex, int /*threadCount*/ )
+    {
+        BlockRange &range = *ranges[threadIndex];
+        int block;
+        
+        while( !hasFailed() )
+        {
+            if( !takeBlock( range, block ) && !( steal( threadIndex ) && takeBlock( range, block ) ) )
+            {
+                return;
+            }
+            
+            const int first = block * EVALUATION_BLOCK_SIZE;
+            FmlIoErrorNumber blockError = plan.evaluateRange( -1, first, min( EVALUATION_BLOCK_SIZE, pointCount - first ), elements, xi, values );
+            if( blockError != FML_IOERR_NO_ERROR )
+            {
+                MutexLock lock( errorMutex );
+                error = blockError;
+            }
+        }
+    }
+    
+    
+    FmlIoErrorNumber getError()
+    {
+        return error;
+    }
+};
+
+
+//========================================================================
+//
+// EvaluationPlan
+//
+//========================================================================
+
+EvaluationPlan::EvaluationPlan( FieldmlIoContext *_context, FmlObjectHandle _evaluator ) :
+    context( _context ),
+    evaluator( _evaluator ),
+    elementArgument( FML_INVALID_HANDLE ),
+    xiArgument( FML_INVALID_HANDLE ),
+    xiCount( 0 ),
+    root( NULL )
+{
+}
+
+
+EvaluationPlan::~EvaluationPlan()
+{
+    for( map<FmlObjectHandle, EvaluationNode *>::iterator i = nodes.begin(); i != nodes.end(); i++ )
+    {
+        delete i->second;
+    }
+    delete context;
+}
+
+
+FieldmlIoContext *EvaluationPlan::getContext()
+{
+    return context;
+}
+
+
+FmlObjectHandle EvaluationPlan::getElementArgument()
+{
+    return elementArgument;
+}
+
+
+FmlObjectHandle EvaluationPlan::getXiArgument()
+{
+    return xiArgument;
+}
+
+
+int EvaluationPlan::getValueCount()
+{
+    return root->componentCount;
+}
+
+
+int EvaluationPlan::getXiCount()
+{
+    return xiCount;
+}
+
+
+FmlIoErrorNumber EvaluationPlan::getNode( FmlObjectHandle handle, EvaluationNode *&node )
+{
+    map<FmlObjectHandle, EvaluationNode *>::const_iterator i = nodes.find( handle );
+    if( i != nodes.end() )
+    {
+        //NOTE: This may be a node that is still being compiled, but its component count is always known.
+        node = i->second;
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    node = NULL;
+    FmlSessionHandle session = context->getSession();
+    
+    int componentCount = getTypeComponentCount( session, Fieldml_GetValueType( session, handle ) );
+    if( componentCount < 1 )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    EvaluationNode *newNode;
+    switch( Fieldml_GetObjectType( session, handle ) )
+    {
+    case FHT_ARGUMENT_EVALUATOR:
+        newNode = new ArgumentNode( handle );
+        break;
+    case FHT_CONSTANT_EVALUATOR:
+        newNode = new ConstantNode( handle );
+        break;
+    case FHT_REFERENCE_EVALUATOR:
+        newNode = new ReferenceNode( handle );
+        break;
+    case FHT_PIECEWISE_EVALUATOR:
+        newNode = new PiecewiseNode( handle );
+        break;
+    case FHT_AGGREGATE_EVALUATOR:
+        newNode = new AggregateNode( handle );
+        break;
+    case FHT_PARAMETER_EVALUATOR:
+        newNode = new ParameterNode( handle );
+        break;
+    case FHT_EXTERNAL_EVALUATOR:
+        newNode = new ExternalNode( handle );
+        break;
+    default:
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    newNode->componentCount = componentCount;
+    nodes[handle] = newNode;
+    
+    FmlIoErrorNumber error = newNode->compile( *this );
+    if( error == FML_IOERR_NO_ERROR )
+    {
+        node = newNode;
+    }
+    
+    return error;
+}
+
+
+FmlIoErrorNumber EvaluationPlan::findInputs( FmlObjectHandle _elementArgument, FmlObjectHandle _xiArgument )
+{
+    FmlSessionHandle session = context->getSession();
+    
+    elementArgument = _elementArgument;
+    xiArgument = _xiArgument;
+    
+    if( ( elementArgument == FML_INVALID_HANDLE ) && ( xiArgument == FML_INVALID_HANDLE ) )
+    {
+        //Use the evaluator's unbound arguments over the elements and chart of a mesh.
+        vector<FmlObjectHandle> elementTypes, chartTypes;
+        int meshCount = Fieldml_GetObjectCount( session, FHT_MESH_TYPE );
+        for( int i = 1; i <= meshCount; i++ )
+        {
+            FmlObjectHandle mesh = Fieldml_GetObject( session, FHT_MESH_TYPE, i );
+            elementTypes.push_back( Fieldml_GetMeshElementsType( session, mesh ) );
+            chartTypes.push_back( Fieldml_GetMeshChartType( session, mesh ) );
+        }
+        
+        int argumentCount = Fieldml_GetArgumentCount( session, evaluator, 0, 1 );
+        if( argumentCount < 0 )
+        {
+            return context->setError( FML_IOERR_CORE_ERROR );
+        }
+        for( int i = 1; i <= argumentCount; i++ )
+        {
+            FmlObjectHandle argument = Fieldml_GetArgument( session, evaluator, i, 0, 1 );
+            FmlObjectHandle type = Fieldml_GetValueType( session, argument );
+            
+            if( find( elementTypes.begin(), elementTypes.end(), type ) != elementTypes.end() )
+            {
+                if( elementArgument != FML_INVALID_HANDLE )
+                {
+                    return context->setError( FML_IOERR_INVALID_PARAMETER );
+                }
+                elementArgument = argument;
+            }
+            else if( find( chartTypes.begin(), chartTypes.end(), type ) != chartTypes.end() )
+            {
+                if( xiArgument != FML_INVALID_HANDLE )
+                {
+                    return context->setError( FML_IOERR_INVALID_PARAMETER );
+                }
+                xiArgument = argument;
+            }
+        }
+    }
+    
+    if( ( elementArgument != FML_INVALID_HANDLE ) &&
+        ( ( Fieldml_GetObjectType( session, elementArgument ) != FHT_ARGUMENT_EVALUATOR ) ||
+        ( Fieldml_GetObjectType( session, Fieldml_GetValueType( session, elementArgument ) ) != FHT_ENSEMBLE_TYPE ) ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    if( xiArgument != FML_INVALID_HANDLE )
+    {
+        FmlObjectHandle xiType = Fieldml_GetValueType( session, xiArgument );
+        if( ( Fieldml_GetObjectType( session, xiArgument ) != FHT_ARGUMENT_EVALUATOR ) ||
+            ( Fieldml_GetObjectType( session, xiType ) != FHT_CONTINUOUS_TYPE ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        xiCount = getTypeComponentCount( session, xiType );
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber EvaluationPlan::checkPoints( const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    if( ( count < 0 ) || ( ( count > 0 ) && ( values == NULL ) ) )
+    {
+        return FML_IOERR_INVALID_PARAMETER;
+    }
+    if( ( count > 0 ) && ( ( ( elementArgument != FML_INVALID_HANDLE ) && ( elements == NULL ) ) || ( ( xiArgument != FML_INVALID_HANDLE ) && ( xi == NULL ) ) ) )
+    {
+        return FML_IOERR_INVALID_PARAMETER;
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber EvaluationPlan::evaluatePoints( const int derivativeDirection, const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    FmlIoErrorNumber error = checkPoints( count, elements, xi, values );
+    if( error == FML_IOERR_NO_ERROR )
+    {
+        error = evaluateRange( derivativeDirection, 0, count, elements, xi, values );
+    }
+    
+    return context->setError( error );
+}
+
+
+FmlIoErrorNumber EvaluationPlan::evaluateRange( const int derivativeDirection, const int first, const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    const int valueCount = root->componentCount;
+    EvaluationState state( elementArgument, xiArgument, xiCount, derivativeDirection );
+    vector<double> blockValues( valueCount * min( count, EVALUATION_BLOCK_SIZE ) );
+    
+    for( int blockFirst = first; blockFirst < first + count; blockFirst += EVALUATION_BLOCK_SIZE )
+    {
+        const int blockCount = min( EVALUATION_BLOCK_SIZE, first + count - blockFirst );
+        state.elements = ( elements == NULL ) ? NULL : elements + blockFirst;
+        state.xi = ( xi == NULL ) ? NULL : xi + blockFirst * xiCount;
+        
+        EvaluationPoints points( blockCount, NULL, state.newPointsId() );
+        FmlIoErrorNumber error = root->evaluate( state, NULL, points, &blockValues[0] );
+        if( error != FML_IOERR_NO_ERROR )
+        {
+            return error;
+        }
+        
+        //Transpose back to the caller's point-major layout.
+        double *blockOutput = values + blockFirst * valueCount;
+        for( int c = 0; c < valueCount; c++ )
+        {
+            const double *componentValues = &blockValues[c * blockCount];
+            for( int i = 0; i < blockCount; i++ )
+            {
+                blockOutput[i * valueCount + c] = componentValues[i];
+            }
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber EvaluationPlan::evaluate( const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    return evaluatePoints( -1, count, elements, xi, values );
+}
+
+
+FmlIoErrorNumber EvaluationPlan::evaluateDerivative( const int xiComponent, const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    if( ( xiComponent < 1 ) || ( xiComponent > xiCount ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return evaluatePoints( xiComponent - 1, count, elements, xi, values );
+}
+
+
+FmlIoErrorNumber EvaluationPlan::evaluateInParallel( ThreadPool &pool, const int threadCount, const int count, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    FmlIoErrorNumber error = checkPoints( count, elements, xi, values );
+    if( error != FML_IOERR_NO_ERROR )
+    {
+        return error;
+    }
+    
+    const int blockCount = ( count + EVALUATION_BLOCK_SIZE - 1 ) / EVALUATION_BLOCK_SIZE;
+    if( ( threadCount <= 1 ) || ( blockCount <= 1 ) )
+    {
+        return evaluateRange( -1, 0, count, elements, xi, values );
+    }
+    
+    EvaluationBatch batch( *this, min( threadCount, blockCount ), count, elements, xi, values );
+    pool.run( batch, min( threadCount, blockCount ) );
+    
+    return batch.getError();
+}
+
+
+EvaluationPlan *EvaluationPlan::create( FieldmlIoContext *context, FmlObjectHandle evaluator, FmlObjectHandle elementArgument, FmlObjectHandle xiArgument )
+{
+    EvaluationPlan *plan = new EvaluationPlan( context, evaluator );
+    
+    FmlIoErrorNumber error = plan->findInputs( elementArgument, xiArgument );
+    if( error == FML_IOERR_NO_ERROR )
+    {
+        error = plan->getNode( evaluator, plan->root );
+    }
+    
+    if( error != FML_IOERR_NO_ERROR )
+    {
+        delete plan;
+        return NULL;
+    }
+    
+    return plan;
+}
@@ -0,0 +1,131 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_EVALUATION_PLAN
+#define H_EVALUATION_PLAN
+
+#include <map>
+
+#include "FieldmlIoContext.h"
+
+class EvaluationNode;
+
+class ThreadPool;
+
+/**
+ * An evaluator compiled, together with everything it binds and depends on, for batched evaluation at
+ * (element, xi) points. Parameter data is read when the plan is created, so later changes to the
+ * session are not seen by an existing plan.
+ */
+class EvaluationPlan
+{
+private:
+    FieldmlIoContext * const context;
+    
+    const FmlObjectHandle evaluator;
+    
+    FmlObjectHandle elementArgument;
+    
+    FmlObjectHandle xiArgument;
+    
+    int xiCount;
+    
+    EvaluationNode *root;
+    
+    std::map<FmlObjectHandle, EvaluationNode *> nodes;
+    
+    EvaluationPlan( FieldmlIoContext *_context, FmlObjectHandle _evaluator );
+    
+    FmlIoErrorNumber findInputs( FmlObjectHandle _elementArgument, FmlObjectHandle _xiArgument );
+    
+    FmlIoErrorNumber checkPoints( const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+    
+    FmlIoErrorNumber evaluatePoints( const int derivativeDirection, const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+
+public:
+    virtual ~EvaluationPlan();
+    
+    /**
+     * Returns the compiled node for the given evaluator, compiling it if this is the first request.
+     * Only valid while the plan is being created.
+     */
+    FmlIoErrorNumber getNode( FmlObjectHandle handle, EvaluationNode *&node );
+    
+    FieldmlIoContext *getContext();
+    
+    FmlObjectHandle getElementArgument();
+    
+    FmlObjectHandle getXiArgument();
+    
+    int getValueCount();
+    
+    int getXiCount();
+    
+    /**
+     * Evaluates the plan at count points. Element i is elements[i], with chart coordinates
+     * xi[i*getXiCount()] onwards. Component c of the result for point i is written to
+     * values[i*getValueCount() + c]. Points at which the field is not defined evaluate to NaN.
+     */
+    FmlIoErrorNumber evaluate( const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+    
+    /**
+     * As evaluate(), but gives the derivative of each component with respect to the given xi coordinate, counting
+     * from 1. Derivatives are propagated through bound continuous evaluators by the chain rule.
+     */
+    FmlIoErrorNumber evaluateDerivative( const int xiComponent, const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+    
+    /**
+     * Evaluates points first to first+count-1 of the given points, as evaluate() does, and returns any error rather
+     * than recording it. A compiled plan is not modified by evaluation, so this may be called from several threads
+     * at once.
+     */
+    FmlIoErrorNumber evaluateRange( const int derivativeDirection, const int first, const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+    
+    /**
+     * As evaluate(), but shares the points between up to threadCount threads from the given pool. Returns any error
+     * rather than recording it.
+     */
+    FmlIoErrorNumber evaluateInParallel( ThreadPool &pool, const int threadCount, const int count, const FmlEnsembleValue *elements, const double *xi, double *values );
+    
+    static EvaluationPlan *create( FieldmlIoContext *context, FmlObjectHandle evaluator, FmlObjectHandle elementArgument, FmlObjectHandle xiArgument );
+};
+
+#endif //H_EVALUATION_PLAN
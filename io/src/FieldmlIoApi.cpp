@@ -40,6 +40,13 @@
  */
 
 #include <cstring>
+#include <vector>
+#include <algorithm>
+
+#ifdef FIELDML_PHDF5_ARRAY
+//Needed before FieldmlIoApi.h, which only declares the MPI-specific API if MPI is available.
+#include <mpi.h>
+#endif //FIELDML_PHDF5_ARRAY
 
 #include "StringUtil.h"
 #include "fieldml_api.h"
@@ -49,6 +56,7 @@
 
 #include "ArrayDataReader.h"
 #include "ArrayDataWriter.h"
+#include "EvaluationPlan.h"
 
 using namespace std;
 
@@ -58,22 +66,7 @@ using namespace std;
 //
 //========================================================================
 
-
-
-//========================================================================
-//
-// API
-//
-//========================================================================
-
-
-FmlIoErrorNumber FieldmlIo_GetLastError()
-{
-    return FieldmlIoSession::getSession().getLastError();
-}
-
-
-FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+static ArrayDataReader *createReader( FmlSessionHandle handle, FmlObjectHandle objectHandle )
 {
     ArrayDataReader *reader = NULL;
     if( Fieldml_GetDataSourceType( handle, objectHandle ) == FML_DATA_SOURCE_ARRAY )
@@ -93,9 +86,30 @@ FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle obj
     else
     {
         FieldmlIoSession::getSession().setError( FML_IOERR_UNSUPPORTED );
-        return FML_INVALID_HANDLE;
     }
     
+    return reader;
+}
+
+
+
+//========================================================================
+//
+// API
+//
+//========================================================================
+
+
+FmlIoErrorNumber FieldmlIo_GetLastError()
+{
+    return FieldmlIoSession::getSession().getLastError();
+}
+
+
+FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    ArrayDataReader *reader = createReader( handle, objectHandle );
+    
     if( reader == NULL )
     {
         return FML_INVALID_HANDLE;
@@ -141,6 +155,32 @@ FmlIoErrorNumber Fieldml_ReadBooleanSlab( FmlReaderHandle readerHandle, const in
 }
 
 
+FmlIoErrorNumber Fieldml_SetPersistentTextIndexes( FmlBoolean persist )
+{
+    FieldmlIoSession::getSession().setPersistentTextIndexes( persist == 1 );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_SetCollectiveTransfers( FmlBoolean collective )
+{
+    FieldmlIoSession::getSession().setCollectiveTransfers( collective == 1 );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+#ifdef FIELDML_PHDF5_ARRAY
+FmlIoErrorNumber Fieldml_SetMpiCommunicator( MPI_Comm communicator, MPI_Info info )
+{
+    FieldmlIoSession::getSession().setCommunicator( communicator, info );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+#endif //FIELDML_PHDF5_ARRAY
+
+
 FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle )
 {
     ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
@@ -159,7 +199,108 @@ FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle )
 }
 
 
+FmlIoErrorNumber Fieldml_SetEvaluatorsFromSource( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle sourceHandle, int evaluatorCount, const FmlObjectHandle *evaluators )
+{
+    //The number of table rows read and assigned at a time.
+    const int BLOCK_SIZE = 4096;
+    
+    if( ( evaluatorCount < 0 ) || ( ( evaluators == NULL ) && ( evaluatorCount > 0 ) ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    int rank = Fieldml_GetArrayDataSourceRank( handle, sourceHandle );
+    if( ( rank != 1 ) && ( rank != 2 ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    int sizes[2], rawSizes[2], offsets[2];
+    if( ( Fieldml_GetArrayDataSourceSizes( handle, sourceHandle, sizes ) != FML_ERR_NO_ERROR ) ||
+        ( Fieldml_GetArrayDataSourceRawSizes( handle, sourceHandle, rawSizes ) != FML_ERR_NO_ERROR ) ||
+        ( Fieldml_GetArrayDataSourceOffsets( handle, sourceHandle, offsets ) != FML_ERR_NO_ERROR ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_CORE_ERROR );
+    }
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] == 0 )
+        {
+            //NOTE: As with the readers, an unset array-source size means the rest of the underlying array.
+            sizes[i] = rawSizes[i] - offsets[i];
+        }
+    }
+    
+    if( ( rank == 2 ) && ( sizes[1] != 2 ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    ArrayDataReader *reader = createReader( handle, sourceHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().getLastError();
+    }
+    
+    const int rowCount = sizes[0];
+    vector<int> table( BLOCK_SIZE * rank );
+    vector<FmlEnsembleValue> blockElements( BLOCK_SIZE );
+    vector<FmlObjectHandle> blockEvaluators( BLOCK_SIZE );
+    
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    for( int row = 0; ( row < rowCount ) && ( err == FML_IOERR_NO_ERROR ); row += BLOCK_SIZE )
+    {
+        int readOffsets[2] = { row, 0 };
+        int readSizes[2] = { min( BLOCK_SIZE, rowCount - row ), rank == 2 ? 2 : 0 };
+        
+        err = reader->readIntSlab( readOffsets, readSizes, &table[0] );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            break;
+        }
+        
+        for( int i = 0; i < readSizes[0]; i++ )
+        {
+            int evaluatorIndex;
+            if( rank == 1 )
+            {
+                blockElements[i] = row + i + 1;
+                evaluatorIndex = table[i];
+            }
+            else
+            {
+                blockElements[i] = table[i * 2];
+                evaluatorIndex = table[i * 2 + 1];
+            }
+            
+            if( ( evaluatorIndex < 0 ) || ( evaluatorIndex > evaluatorCount ) )
+            {
+                err = FML_IOERR_INVALID_PARAMETER;
+                break;
+            }
+            blockEvaluators[i] = ( evaluatorIndex == 0 ) ? FML_INVALID_HANDLE : evaluators[evaluatorIndex - 1];
+        }
+        
+        if( ( err == FML_IOERR_NO_ERROR ) &&
+            ( Fieldml_SetEvaluators( handle, objectHandle, readSizes[0], &blockElements[0], &blockEvaluators[0] ) != FML_ERR_NO_ERROR ) )
+        {
+            err = FML_IOERR_CORE_ERROR;
+        }
+    }
+    
+    reader->close();
+    delete reader;
+    
+    return FieldmlIoSession::getSession().setError( err );
+}
+
 FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank )
+{
+    return Fieldml_OpenArrayWriterEx( handle, objectHandle, typeHandle, append, sizes, rank, NULL, NULL, 0, 0 );
+}
+
+
+FmlWriterHandle Fieldml_OpenArrayWriterEx( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank, const int *chunkSizes, const int *maxSizes, int deflateLevel, FmlBoolean shuffle )
 {
     if( Fieldml_IsObjectLocal( handle, objectHandle, 0 ) != 1 )
     {
@@ -197,6 +338,33 @@ FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandl
         return FML_INVALID_HANDLE;
     }
 
+    if( ( deflateLevel < 0 ) || ( deflateLevel > FML_MAX_DEFLATE_LEVEL ) )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+        return FML_INVALID_HANDLE;
+    }
+    
+    for( int i = 0; i < rank; i++ )
+    {
+        if( ( chunkSizes != NULL ) && ( chunkSizes[i] <= 0 ) )
+        {
+            FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+            return FML_INVALID_HANDLE;
+        }
+        
+        if( ( maxSizes != NULL ) && ( maxSizes[i] != FML_ARRAY_UNLIMITED_SIZE ) && ( maxSizes[i] < sizes[i] ) )
+        {
+            FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+            return FML_INVALID_HANDLE;
+        }
+    }
+    
+    ArrayDataWriterOptions options;
+    options.chunkSizes = chunkSizes;
+    options.maxSizes = maxSizes;
+    options.deflateLevel = deflateLevel;
+    options.shuffle = ( shuffle == 1 );
+
     ArrayDataWriter *writer = NULL;
 
     if( Fieldml_GetDataSourceType( handle, objectHandle ) == FML_DATA_SOURCE_ARRAY )
@@ -209,7 +377,7 @@ FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandl
         }
         else
         {
-            writer = ArrayDataWriter::create( context, root, objectHandle, type, ( append == 1 ), sizes, rank );
+            writer = ArrayDataWriter::create( context, root, objectHandle, type, ( append == 1 ), sizes, rank, options );
         }
     }
     
@@ -219,6 +387,9 @@ FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandl
         return FML_INVALID_HANDLE;
     }
     
+    //The writer may change any data the session's evaluation plans have cached.
+    FieldmlIoSession::getSession().getParameterCache().clear( handle );
+    
     return FieldmlIoSession::getSession().addWriter( writer );
 }
 
@@ -259,6 +430,23 @@ FmlIoErrorNumber Fieldml_WriteBooleanSlab( FmlWriterHandle writerHandle, const i
 }
 
 
+FmlIoErrorNumber Fieldml_SetWriterPrecision( FmlWriterHandle writerHandle, int significantDigits )
+{
+    ArrayDataWriter *writer = FieldmlIoSession::getSession().handleToWriter( writerHandle );
+    if( writer == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    if( ( significantDigits < 0 ) || ( significantDigits > FML_MAX_WRITER_PRECISION ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+
+    return writer->setPrecision( significantDigits );
+}
+
+
 FmlIoErrorNumber Fieldml_CloseWriter( FmlWriterHandle writerHandle )
 {
     ArrayDataWriter *writer = FieldmlIoSession::getSession().handleToWriter( writerHandle );
@@ -275,3 +463,130 @@ FmlIoErrorNumber Fieldml_CloseWriter( FmlWriterHandle writerHandle )
     
     return FieldmlIoSession::getSession().setError( err );
 }
+
+
+FmlEvaluationPlanHandle Fieldml_CreateEvaluationPlan( FmlSessionHandle handle, FmlObjectHandle evaluatorHandle, FmlObjectHandle elementArgumentHandle, FmlObjectHandle xiArgumentHandle )
+{
+    EvaluationPlan *plan = EvaluationPlan::create( FieldmlIoSession::getSession().createContext( handle ), evaluatorHandle, elementArgumentHandle, xiArgumentHandle );
+    
+    if( plan == NULL )
+    {
+        return FML_INVALID_HANDLE;
+    }
+    
+    FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+    return FieldmlIoSession::getSession().addPlan( plan );
+}
+
+
+int Fieldml_GetEvaluationPlanValueCount( FmlEvaluationPlanHandle planHandle )
+{
+    EvaluationPlan *plan = FieldmlIoSession::getSession().handleToPlan( planHandle );
+    if( plan == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return -1;
+    }
+    
+    return plan->getValueCount();
+}
+
+
+int Fieldml_GetEvaluationPlanXiCount( FmlEvaluationPlanHandle planHandle )
+{
+    EvaluationPlan *plan = FieldmlIoSession::getSession().handleToPlan( planHandle );
+    if( plan == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return -1;
+    }
+    
+    return plan->getXiCount();
+}
+
+
+FmlIoErrorNumber Fieldml_EvaluatePlan( FmlEvaluationPlanHandle planHandle, int pointCount, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    EvaluationPlan *plan = FieldmlIoSession::getSession().handleToPlan( planHandle );
+    if( plan == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    return plan->evaluate( pointCount, elements, xi, values );
+}
+
+
+FmlIoErrorNumber Fieldml_EvaluatePlanDerivative( FmlEvaluationPlanHandle planHandle, int xiIndex, int pointCount, const FmlEnsembleValue *elements, const double *xi, double *values )
+{
+    EvaluationPlan *plan = FieldmlIoSession::getSession().handleToPlan( planHandle );
+    if( plan == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    return plan->evaluateDerivative( xiIndex, pointCount, elements, xi, values );
+}
+
+
+FmlIoErrorNumber Fieldml_DestroyEvaluationPlan( FmlEvaluationPlanHandle planHandle )
+{
+    EvaluationPlan *plan = FieldmlIoSession::getSession().handleToPlan( planHandle );
+    if( plan == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    FieldmlIoSession::getSession().removePlan( planHandle );
+    
+    delete plan;
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_EvaluateBatch( FmlSessionHandle handle, FmlObjectHandle evaluatorHandle, const FmlEnsembleValue *elements, const double *xi, int pointCount, double *values )
+{
+    FieldmlIoSession &ioSession = FieldmlIoSession::getSession();
+    EvaluationPlan *plan;
+    int threadCount;
+    
+    {
+        MutexLock lock( ioSession.getEvaluationMutex() );
+        plan = EvaluationPlan::create( ioSession.createContext( handle ), evaluatorHandle, FML_INVALID_HANDLE, FML_INVALID_HANDLE );
+        if( plan == NULL )
+        {
+            return ioSession.getLastError();
+        }
+        threadCount = ioSession.getEvaluationThreadCount();
+    }
+    
+    //Only the compiled plan is used from here on, so other calls can compile their own plans meanwhile.
+    FmlIoErrorNumber error = plan->evaluateInParallel( ioSession.getThreadPool(), threadCount, pointCount, elements, xi, values );
+    
+    MutexLock lock( ioSession.getEvaluationMutex() );
+    delete plan;
+    
+    return ioSession.setError( error );
+}
+
+
+FmlIoErrorNumber Fieldml_ClearParameterCache( FmlSessionHandle handle )
+{
+    FieldmlIoSession::getSession().getParameterCache().clear( handle );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_SetEvaluationThreadCount( int threadCount )
+{
+    if( threadCount < 0 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    FieldmlIoSession::getSession().setEvaluationThreadCount( threadCount );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
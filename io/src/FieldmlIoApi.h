@@ -47,7 +47,7 @@
  * \file
  * API notes:
  * 
- * If a function returns a FmlReaderHandle or FmlWriterHandle
+ * If a function returns a FmlReaderHandle, FmlWriterHandle or FmlEvaluationPlanHandle
  * it will return FML_INVALID_HANDLE on error.
  */
 
@@ -75,6 +75,8 @@ typedef int32_t FmlReaderHandle;                ///< A handle to a data reader.
 
 typedef int32_t FmlWriterHandle;                ///< A handle to a data writer.
 
+typedef int32_t FmlEvaluationPlanHandle;        ///< A handle to a compiled evaluation plan.
+
 typedef int32_t FmlIoErrorNumber;               ///< A FieldML IO library error code.
 
 
@@ -95,9 +97,16 @@ typedef int32_t FmlIoErrorNumber;               ///< A FieldML IO library error
 #define FML_IOERR_NONLOCAL_OBJECT       1208    ///< Attempt to perform an IO action on a nonlocal object.
 #define FML_IOERR_UNKNOWN_OBJECT        1209    ///< Attempt to perform an IO action on an unknown object.
 #define FML_IOERR_INVALID_LOCATION      1210    ///< Data source location was invalid.
+#define FML_IOERR_UNBOUND_ARGUMENT      1211    ///< An argument needed during evaluation was not bound.
 
 #define FML_IOERR_INVALID_PARAMETER     1300    ///< Invalid parameter.
 
+#define FML_MAX_WRITER_PRECISION        17      ///< The largest precision accepted by Fieldml_SetWriterPrecision.
+
+#define FML_ARRAY_UNLIMITED_SIZE        -1      ///< A maximum size for Fieldml_OpenArrayWriterEx, allowing the dimension to grow without limit.
+
+#define FML_MAX_DEFLATE_LEVEL           9       ///< The largest compression level accepted by Fieldml_OpenArrayWriterEx.
+
 /*
 
  Types
@@ -118,6 +127,12 @@ extern "C" {
  * Creates a new reader for the given data source's raw data. Fieldml_CloseReader() should be called
  * when the caller no longer needs to use it.
  * 
+ * A reader for an inline data resource reads the resource's data in place, and locks it until the reader is closed.
+ * While any such reader is open, the resource's inline data cannot be changed, so array writers cannot be opened on
+ * any data source in the same resource, writers that are already open fail, and Fieldml_AddInlineData() and
+ * Fieldml_SetInlineData() fail with FML_ERR_ACCESS_VIOLATION.
+ * 
+ * \see Fieldml_LockInlineData
  * \see Fieldml_ReadIntSlab
  * \see Fieldml_ReadDoubleSlab
  * \see Fieldml_CloseReader
@@ -146,6 +161,46 @@ FmlIoErrorNumber Fieldml_ReadDoubleSlab( FmlReaderHandle readerHandle, const int
 FmlIoErrorNumber Fieldml_ReadBooleanSlab( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
 
 
+/**
+ * Sets whether readers for text arrays in external files persist their row index. The row index records where
+ * rows of the array start in the file, so that reads can seek directly to the requested rows. If enabled, the index is
+ * saved alongside the data file, as <filename>-<location>-<row length>.fmlidx, when a reader is closed, and reused by later
+ * readers until the data file changes. Disabled by default.
+ * 
+ * \see Fieldml_OpenReader
+ */
+FmlIoErrorNumber Fieldml_SetPersistentTextIndexes( FmlBoolean persist );
+
+
+/**
+ * Sets whether readers and writers for parallel HDF5 arrays use collective MPI-IO transfers, in which all processes
+ * in the communicator take part in each read and write, rather than independent transfers. Collective transfers let
+ * MPI-IO aggregate requests from many processes into large contiguous accesses, but every process must then make the
+ * same sequence of slab reads and writes, using an empty slab if it has nothing to transfer. Writes never change the
+ * size of an array, so no process makes collective calls that the others skip, but every process must open each writer
+ * with the same sizes. Applies to readers and writers opened afterwards. Disabled by default, and has no effect on
+ * other array formats.
+ * 
+ * \see Fieldml_SetMpiCommunicator
+ * \see Fieldml_OpenArrayWriterEx
+ */
+FmlIoErrorNumber Fieldml_SetCollectiveTransfers( FmlBoolean collective );
+
+
+#ifdef MPI_VERSION
+/**
+ * Sets the communicator and info object used to open parallel HDF5 files. Applies to readers and writers opened
+ * afterwards. MPI_COMM_WORLD and MPI_INFO_NULL are used by default.
+ * 
+ * \note Only available if mpi.h is included before this header, and only defined if the library was built with
+ * parallel HDF5 support.
+ * 
+ * \see Fieldml_SetCollectiveTransfers
+ */
+FmlIoErrorNumber Fieldml_SetMpiCommunicator( MPI_Comm communicator, MPI_Info info );
+#endif //MPI_VERSION
+
+
 /**
  * Closes the given data reader. The reader's handle should not be used after this call.
  * 
@@ -154,16 +209,57 @@ FmlIoErrorNumber Fieldml_ReadBooleanSlab( FmlReaderHandle readerHandle, const in
 FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle );
 
 
+/**
+ * Assigns element evaluators to the given piecewise or aggregate evaluator from an integer table held in an array
+ * data source. Each table entry is a 1-based index into the given evaluators array, or zero to remove the element's
+ * association. For a rank 1 data source, the nth entry applies to element n. For a rank 2 data source, each row
+ * is an (element, evaluator index) pair.
+ * 
+ * The table is read and assigned in blocks, so arbitrarily large decompositions can be attached without holding
+ * the whole table in memory. If an error occurs, blocks already assigned remain in place.
+ * 
+ * \see Fieldml_SetEvaluators
+ */
+FmlIoErrorNumber Fieldml_SetEvaluatorsFromSource( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle sourceHandle, int evaluatorCount, const FmlObjectHandle *evaluators );
+
+
 /**
  * Creates a new writer for the given data source's raw data. No post-processing will be done on the
  * provided values. It is up to the application to ensure that the data source's description is consistent with the data
  * actually being written, and with any other data sources that use the same data resource.
  * Fieldml_CloseWriter() should be called when the caller no longer needs to use the writer. 
  * 
+ * For an inline data resource, text is added to the resource as it is written rather than when the writer is closed.
+ * Unless append is set, the resource's existing data is cleared when the writer is opened, so a writer that fails
+ * part way through leaves only the data written so far. Writers cannot be opened on an inline data resource, and fail
+ * when they next pass text to it, while a reader on any data source in the same resource is open.
+ * 
+ * \see Fieldml_OpenReader
  * \see Fieldml_CloseWriter
  */
 FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank );
 
+/**
+ * As Fieldml_OpenArrayWriter(), but with control over how a newly created array is stored. The options only apply
+ * when the writer creates the array; an existing array keeps its layout. Formats that cannot make use of an option
+ * ignore it.
+ * 
+ * chunkSizes gives the size of each stored chunk, per dimension. If NULL, chunk sizes are chosen automatically when
+ * chunking is needed, which is the case whenever compression or extensible dimensions are requested.
+ * 
+ * maxSizes gives the size each dimension may later be extended to, or FML_ARRAY_UNLIMITED_SIZE if it may grow without
+ * limit. If NULL, the array cannot be extended. Re-opening an extensible array for appending with larger sizes extends
+ * it rather than requiring it to be rewritten. Arrays are only extended when a writer is opened, so a slab that lies
+ * past the end of the array is a write error. For parallel HDF5, every process must open the writer with the same
+ * sizes, as extending the array is a collective operation.
+ * 
+ * deflateLevel is a compression level from 0 (uncompressed) to FML_MAX_DEFLATE_LEVEL. If shuffle is set, the bytes of
+ * each value are regrouped before compression, which usually improves the compression of numerical data.
+ * 
+ * \see Fieldml_OpenArrayWriter
+ */
+FmlWriterHandle Fieldml_OpenArrayWriterEx( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank, const int *chunkSizes, const int *maxSizes, int deflateLevel, FmlBoolean shuffle );
+
 /**
  * Write out some integer values to the given data writer. The data will be interpreted as an n-dimensional array of
  * the given size, and written out at the given offset. The first
@@ -199,6 +295,18 @@ FmlIoErrorNumber Fieldml_WriteDoubleSlab( FmlWriterHandle writerHandle, const in
 FmlIoErrorNumber Fieldml_WriteBooleanSlab( FmlWriterHandle writerHandle, const int *offsets, const int *sizes, const FmlBoolean *valueBuffer );
 
 
+/**
+ * Sets the number of significant digits used when the given writer formats double-precision values as text. If zero,
+ * the default, each value is written with just enough digits to read back as exactly the same value.
+ * Values above FML_MAX_WRITER_PRECISION are rejected, as 17 significant digits are always enough to identify a double.
+ * 
+ * \note Only supported for text-based arrays.
+ * 
+ * \see Fieldml_OpenArrayWriter
+ */
+FmlIoErrorNumber Fieldml_SetWriterPrecision( FmlWriterHandle writerHandle, int significantDigits );
+
+
 /**
  * Closes the given data writer. The writer's handle cannot be used after this call.
  * 
@@ -206,6 +314,116 @@ FmlIoErrorNumber Fieldml_WriteBooleanSlab( FmlWriterHandle writerHandle, const i
  */
 FmlIoErrorNumber Fieldml_CloseWriter( FmlWriterHandle writerHandle );
 
+
+/**
+ * Compiles the given evaluator, together with the evaluators it binds and depends on, into a plan that can be
+ * evaluated at many (element, xi) points at once. The element argument is an ensemble-valued argument evaluator
+ * that receives each point's element, and the xi argument a continuous-valued argument evaluator that receives its
+ * chart coordinates. If both are FML_INVALID_HANDLE, they are taken from the evaluator's unbound arguments over the
+ * elements and chart of a mesh. Otherwise, an input given as FML_INVALID_HANDLE is not used.
+ * 
+ * Reference, piecewise, aggregate, parameter, constant and argument evaluators are supported, along with the Lagrange
+ * interpolators from the FieldML library.
+ * 
+ * Parameter data is taken from the session's parameter cache when the plan is created, reading each array data
+ * source the first time it is needed. Fieldml_DestroyEvaluationPlan() should be called when the caller no longer
+ * needs to use the plan.
+ * 
+ * \see Fieldml_EvaluatePlan
+ * \see Fieldml_DestroyEvaluationPlan
+ */
+FmlEvaluationPlanHandle Fieldml_CreateEvaluationPlan( FmlSessionHandle handle, FmlObjectHandle evaluatorHandle, FmlObjectHandle elementArgumentHandle, FmlObjectHandle xiArgumentHandle );
+
+
+/**
+ * \return The number of components in each value produced by the given plan, or -1 on error.
+ * 
+ * \see Fieldml_CreateEvaluationPlan
+ */
+int Fieldml_GetEvaluationPlanValueCount( FmlEvaluationPlanHandle planHandle );
+
+
+/**
+ * \return The number of chart coordinates the given plan expects for each point, or -1 on error. This is zero if
+ * the plan has no xi argument.
+ * 
+ * \see Fieldml_CreateEvaluationPlan
+ */
+int Fieldml_GetEvaluationPlanXiCount( FmlEvaluationPlanHandle planHandle );
+
+
+/**
+ * Evaluates the given plan at pointCount points. The element for point n is elements[n], and its chart coordinates
+ * start at xi[n * xiCount]. The value for point n is written to values[n * valueCount] onwards. Points at which the
+ * evaluator is not defined, such as elements with no piecewise evaluator or DOK parameters with no entry, give NaN.
+ * Either of elements or xi may be NULL if the plan does not use it.
+ * 
+ * \see Fieldml_GetEvaluationPlanValueCount
+ * \see Fieldml_GetEvaluationPlanXiCount
+ */
+FmlIoErrorNumber Fieldml_EvaluatePlan( FmlEvaluationPlanHandle planHandle, int pointCount, const FmlEnsembleValue *elements, const double *xi, double *values );
+
+
+/**
+ * As Fieldml_EvaluatePlan(), but gives the derivative of each value component with respect to the given xi
+ * coordinate, counting from 1. The derivatives of the library Lagrange interpolators are evaluated directly, and
+ * carried through any continuous evaluators bound to their arguments by the chain rule.
+ * 
+ * \see Fieldml_EvaluatePlan
+ */
+FmlIoErrorNumber Fieldml_EvaluatePlanDerivative( FmlEvaluationPlanHandle planHandle, int xiIndex, int pointCount, const FmlEnsembleValue *elements, const double *xi, double *values );
+
+
+/**
+ * Destroys the given evaluation plan. The plan's handle cannot be used after this call.
+ * 
+ * \see Fieldml_CreateEvaluationPlan
+ */
+FmlIoErrorNumber Fieldml_DestroyEvaluationPlan( FmlEvaluationPlanHandle planHandle );
+
+
+/**
+ * Evaluates the given evaluator at pointCount points, sharing the points between several threads. The evaluator's
+ * element and xi arguments are found as for Fieldml_CreateEvaluationPlan(), and the points and values are laid out
+ * as for Fieldml_EvaluatePlan().
+ * 
+ * Points are handed out to the threads in blocks, and threads that finish their share early take over part of the
+ * share of another thread, so the work stays balanced even when some elements are much more expensive to evaluate
+ * than others. The evaluator is compiled on each call, so this is intended for large batches of points.
+ * 
+ * \note This function may be called from several threads at once on the same session, or on different sessions. The
+ * concurrent calls share the thread pool, so they take turns evaluating, but each returns the values it would have
+ * returned alone. While any call is running, other threads must not call any core API function for the session being
+ * evaluated, including Fieldml_Destroy(). Nor may they call any other IO API function, for any session, as the IO
+ * API's error state and parameter cache are shared by all sessions.
+ * 
+ * \see Fieldml_SetEvaluationThreadCount
+ */
+FmlIoErrorNumber Fieldml_EvaluateBatch( FmlSessionHandle handle, FmlObjectHandle evaluatorHandle, const FmlEnsembleValue *elements, const double *xi, int pointCount, double *values );
+
+
+/**
+ * Drops the array data cached for evaluating parameter evaluators in the given session, so that it is read again
+ * by plans created afterwards. Arrays whose data sources or inline data have been changed through the core API are
+ * read again automatically, and the cache is cleared when an array writer is opened in the session, but changes made
+ * to data files by other means are not detected. Existing plans are not affected. The arrays cached for sessions that
+ * have been destroyed are dropped as well.
+ *
+ * \see Fieldml_GetDataRevision
+ * 
+ * \see Fieldml_CreateEvaluationPlan
+ */
+FmlIoErrorNumber Fieldml_ClearParameterCache( FmlSessionHandle handle );
+
+
+/**
+ * Sets the number of threads used by Fieldml_EvaluateBatch(), including the calling thread. If zero, which is the
+ * default, one thread is used for each available processor.
+ * 
+ * \see Fieldml_EvaluateBatch
+ */
+FmlIoErrorNumber Fieldml_SetEvaluationThreadCount( int threadCount );
+
 }
 
 #endif // __cplusplus
@@ -95,6 +95,13 @@ FieldmlIoSession::FieldmlIoSession()
 {
     debug = 1;
     lastError = FML_IOERR_NO_ERROR;
+    persistentTextIndexes = false;
+    collectiveTransfers = false;
+    evaluationThreadCount = 0;
+#ifdef FIELDML_PHDF5_ARRAY
+    communicator = MPI_COMM_WORLD;
+    communicatorInfo = MPI_INFO_NULL;
+#endif //FIELDML_PHDF5_ARRAY
 }
 
 
@@ -108,6 +115,10 @@ FieldmlIoSession::~FieldmlIoSession()
     {
         delete *i;
     }
+    for( vector<EvaluationPlan*>::iterator i = plans.begin(); i != plans.end(); i++ )
+    {
+        delete *i;
+    }
 }
 
 
@@ -153,6 +164,81 @@ void FieldmlIoSession::setDebug( const int debugValue )
 }
 
 
+void FieldmlIoSession::setPersistentTextIndexes( const bool persist )
+{
+    persistentTextIndexes = persist;
+}
+
+
+bool FieldmlIoSession::getPersistentTextIndexes()
+{
+    return persistentTextIndexes;
+}
+
+
+void FieldmlIoSession::setCollectiveTransfers( const bool collective )
+{
+    collectiveTransfers = collective;
+}
+
+
+bool FieldmlIoSession::getCollectiveTransfers()
+{
+    return collectiveTransfers;
+}
+
+
+void FieldmlIoSession::setEvaluationThreadCount( const int threadCount )
+{
+    evaluationThreadCount = threadCount;
+}
+
+
+int FieldmlIoSession::getEvaluationThreadCount()
+{
+    return ( evaluationThreadCount > 0 ) ? evaluationThreadCount : ThreadPool::getProcessorCount();
+}
+
+
+ParameterCache &FieldmlIoSession::getParameterCache()
+{
+    return parameterCache;
+}
+
+
+ThreadPool &FieldmlIoSession::getThreadPool()
+{
+    return threadPool;
+}
+
+
+Mutex &FieldmlIoSession::getEvaluationMutex()
+{
+    return evaluationMutex;
+}
+
+
+#ifdef FIELDML_PHDF5_ARRAY
+void FieldmlIoSession::setCommunicator( MPI_Comm comm, MPI_Info info )
+{
+    communicator = comm;
+    communicatorInfo = info;
+}
+
+
+MPI_Comm FieldmlIoSession::getCommunicator()
+{
+    return communicator;
+}
+
+
+MPI_Info FieldmlIoSession::getCommunicatorInfo()
+{
+    return communicatorInfo;
+}
+#endif //FIELDML_PHDF5_ARRAY
+
+
 FieldmlIoContext *FieldmlIoSession::createContext( FmlSessionHandle session )
 {
     return new FieldmlIoSessionContext( session );
@@ -205,3 +291,27 @@ void FieldmlIoSession::removeWriter( FmlWriterHandle handle )
 {
     writers[handle] = NULL;
 }
+
+
+EvaluationPlan *FieldmlIoSession::handleToPlan( FmlEvaluationPlanHandle handle )
+{
+    if( ( handle < 0 ) || ( (unsigned int)handle >= plans.size() ) )
+    {
+        return NULL;
+    }
+    
+    return plans[handle];
+}
+
+
+FmlEvaluationPlanHandle FieldmlIoSession::addPlan( EvaluationPlan *plan )
+{
+    plans.push_back( plan );
+    return plans.size() - 1;
+}
+
+
+void FieldmlIoSession::removePlan( FmlEvaluationPlanHandle handle )
+{
+    plans[handle] = NULL;
+}
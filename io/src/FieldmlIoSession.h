@@ -45,9 +45,16 @@
 #include <vector>
 #include <set>
 
+#ifdef FIELDML_PHDF5_ARRAY
+#include <mpi.h>
+#endif //FIELDML_PHDF5_ARRAY
+
 #include "FieldmlIoContext.h"
 #include "ArrayDataReader.h"
 #include "ArrayDataWriter.h"
+#include "EvaluationPlan.h"
+#include "ParameterCache.h"
+#include "ThreadPool.h"
 
 class FieldmlIoSession
 {
@@ -60,10 +67,31 @@ private:
     
     int debug;
     
+    bool persistentTextIndexes;
+    
+    bool collectiveTransfers;
+    
+    int evaluationThreadCount;
+    
+    ParameterCache parameterCache;
+    
+    ThreadPool threadPool;
+    
+    //Serialises the parts of batch evaluation that use the core API or the error state, neither of which is thread safe.
+    Mutex evaluationMutex;
+    
+#ifdef FIELDML_PHDF5_ARRAY
+    MPI_Comm communicator;
+    
+    MPI_Info communicatorInfo;
+#endif //FIELDML_PHDF5_ARRAY
+    
     std::vector<ArrayDataReader *> readers;
     
     std::vector<ArrayDataWriter *> writers;
     
+    std::vector<EvaluationPlan *> plans;
+    
     static FieldmlIoSession singleton;
     
 public:
@@ -76,6 +104,35 @@ public:
     FmlIoErrorNumber setError( FmlIoErrorNumber error );
 
     void setDebug( const int debugValue );
+    
+    void setPersistentTextIndexes( const bool persist );
+    
+    bool getPersistentTextIndexes();
+    
+    void setCollectiveTransfers( const bool collective );
+    
+    bool getCollectiveTransfers();
+    
+    void setEvaluationThreadCount( const int threadCount );
+    
+    /**
+     * Returns the number of threads to use for batch evaluation. If none has been set, this is the number of processors.
+     */
+    int getEvaluationThreadCount();
+    
+    ParameterCache &getParameterCache();
+    
+    ThreadPool &getThreadPool();
+    
+    Mutex &getEvaluationMutex();
+    
+#ifdef FIELDML_PHDF5_ARRAY
+    void setCommunicator( MPI_Comm comm, MPI_Info info );
+    
+    MPI_Comm getCommunicator();
+    
+    MPI_Info getCommunicatorInfo();
+#endif //FIELDML_PHDF5_ARRAY
 
     const FmlObjectHandle getLastError();
 
@@ -91,6 +148,12 @@ public:
     
     void removeWriter( FmlWriterHandle handle );
 
+    EvaluationPlan *handleToPlan( FmlEvaluationPlanHandle handle );
+    
+    FmlEvaluationPlanHandle addPlan( EvaluationPlan *plan );
+    
+    void removePlan( FmlEvaluationPlanHandle handle );
+
     FieldmlIoContext *createContext( FmlSessionHandle session );
 
     static FieldmlIoSession &getSession(); 
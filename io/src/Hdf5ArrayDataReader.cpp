@@ -41,6 +41,7 @@
 
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
 
 #include "Hdf5ArrayDataReader.h"
 
@@ -63,7 +64,7 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
     else if( format == StringUtil::HDF5_NAME )
     {
 #ifdef FIELDML_HDF5_ARRAY
-        Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, H5P_DEFAULT );
+        Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, H5P_DEFAULT, H5P_DEFAULT );
         if( !hdf5reader->ok )
         {
             delete hdf5reader;
@@ -77,10 +78,14 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
     else if( format == StringUtil::PHDF5_NAME )
     {
 #ifdef FIELDML_PHDF5_ARRAY
+        FieldmlIoSession &ioSession = FieldmlIoSession::getSession();
         hid_t accessProperties = H5Pcreate( H5P_FILE_ACCESS );
-        if( H5Pset_fapl_mpio( accessProperties, MPI_COMM_WORLD, MPI_INFO_NULL ) >= 0 )
+        hid_t transferProperties = H5Pcreate( H5P_DATASET_XFER );
+        const H5FD_mpio_xfer_t transferMode = ioSession.getCollectiveTransfers() ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT;
+        if( ( H5Pset_fapl_mpio( accessProperties, ioSession.getCommunicator(), ioSession.getCommunicatorInfo() ) >= 0 ) &&
+            ( H5Pset_dxpl_mpio( transferProperties, transferMode ) >= 0 ) )
         {
-            Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, accessProperties );
+            Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, accessProperties, transferProperties );
             if( !hdf5reader->ok )
             {
                 delete hdf5reader;
@@ -90,6 +95,7 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
                 reader = hdf5reader;
             }
         }
+        H5Pclose( transferProperties );
         H5Pclose( accessProperties );
 #endif //FIELDML_PHDF5_ARRAY
     }
@@ -100,10 +106,12 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
 
 
 #if defined FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
-Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const string root, FmlObjectHandle source, hid_t accessProperties ) :
+Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const string root, FmlObjectHandle source, hid_t accessProperties, hid_t _transferProperties ) :
     ArrayDataReader( _context ),
     closed( false )
 {
+    transferProperties = ( _transferProperties == H5P_DEFAULT ) ? H5P_DEFAULT : H5Pcopy( _transferProperties );
+
     hStrides = NULL;
     hSizes = NULL;
     hOffsets = NULL;
@@ -210,18 +218,8 @@ FmlIoErrorNumber Hdf5ArrayDataReader::readSlab( const int *offsets, const int *s
     herr_t status;
     status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL );
 
-    hid_t transferProperties = H5P_DEFAULT;
-
-    //if( collective )
-    //{
-    //    transferProperties = H5Pcreate (H5P_DATASET_XFER);
-    //    H5Pset_dxpl_mpio(transferProperties, H5FD_MPIO_COLLECTIVE);
-    //}
-        
     status = H5Dread( dataset, requiredDatatype, bufferSpace, dataspace, transferProperties, valueBuffer );
     
-    //H5Pclose( transferProperties );
-    
     H5Sclose( bufferSpace );
     
     if( status >= 0 )
@@ -289,6 +287,11 @@ Hdf5ArrayDataReader::~Hdf5ArrayDataReader()
         close();
     }
     
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+    }
+    
     delete[] hStrides;
     delete[] hSizes;
     delete[] hOffsets;
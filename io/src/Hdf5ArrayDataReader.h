@@ -64,7 +64,10 @@ private:
     hsize_t *hSizes;
     hsize_t *hOffsets;
     
-    Hdf5ArrayDataReader( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, hid_t fileAccessProperties );
+    //Dataset transfer properties, e.g. the MPI-IO transfer mode for parallel HDF5.
+    hid_t transferProperties;
+    
+    Hdf5ArrayDataReader( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, hid_t fileAccessProperties, hid_t _transferProperties );
 
     FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, void *valueBuffer );
     
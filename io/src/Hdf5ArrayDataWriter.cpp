@@ -41,6 +41,7 @@
 
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
 
 #include "ArrayDataWriter.h"
 #include "Hdf5ArrayDataWriter.h"
@@ -49,7 +50,10 @@ using namespace std;
 
 #if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
 
-Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank )
+//The number of values aimed for when choosing chunk sizes automatically.
+static const hsize_t DEFAULT_CHUNK_VALUES = 65536;
+
+Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, const ArrayDataWriterOptions &options )
 {
     Hdf5ArrayDataWriter *writer = NULL;
     
@@ -64,7 +68,7 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
     else if( format == StringUtil::HDF5_NAME )
     {
 #ifdef FIELDML_HDF5_ARRAY
-        Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, H5P_DEFAULT );
+        Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, H5P_DEFAULT, H5P_DEFAULT, options );
         if( !hdf5writer->ok )
         {
             delete hdf5writer;
@@ -78,10 +82,14 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
     else if( format == StringUtil::PHDF5_NAME )
     {
 #ifdef FIELDML_PHDF5_ARRAY
+        FieldmlIoSession &ioSession = FieldmlIoSession::getSession();
         hid_t accessProperties = H5Pcreate( H5P_FILE_ACCESS );
-        if( H5Pset_fapl_mpio( accessProperties, MPI_COMM_WORLD, MPI_INFO_NULL ) >= 0 )
+        hid_t transferProperties = H5Pcreate( H5P_DATASET_XFER );
+        const H5FD_mpio_xfer_t transferMode = ioSession.getCollectiveTransfers() ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT;
+        if( ( H5Pset_fapl_mpio( accessProperties, ioSession.getCommunicator(), ioSession.getCommunicatorInfo() ) >= 0 ) &&
+            ( H5Pset_dxpl_mpio( transferProperties, transferMode ) >= 0 ) )
         {
-            Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, accessProperties );
+            Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, accessProperties, transferProperties, options );
             if( !hdf5writer->ok )
             {
                 delete hdf5writer;
@@ -91,6 +99,7 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
                 writer = hdf5writer;
             }
         }
+        H5Pclose( transferProperties );
         H5Pclose( accessProperties );
 #endif //FIELDML_PHDF5_ARRAY
     }
@@ -100,9 +109,11 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
 }
 
 
-Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int _rank, hid_t accessProperties ) :
+Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int _rank, hid_t accessProperties, hid_t _transferProperties, const ArrayDataWriterOptions &options ) :
     ArrayDataWriter( _context )
 {
+    transferProperties = ( _transferProperties == H5P_DEFAULT ) ? H5P_DEFAULT : H5Pcopy( _transferProperties );
+
     rank = _rank;
     file = -1;
     dataset = -1;
@@ -174,7 +185,7 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
 
         if( dataset < 0 )
         {
-            if( !initializeWithNewDataset( location, sizes, handleType ) )
+            if( !initializeWithNewDataset( location, sizes, handleType, options ) )
             {
                 break;
             }
@@ -214,13 +225,92 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
 }
 
 
-bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *sizes, FieldmlHandleType handleType )
+hid_t Hdf5ArrayDataWriter::createDatasetProperties( int *sizes, const ArrayDataWriterOptions &options )
 {
+    const bool chunked = ( options.chunkSizes != NULL ) || ( options.maxSizes != NULL ) || ( options.deflateLevel > 0 ) || options.shuffle;
+    if( !chunked )
+    {
+        return H5P_DEFAULT;
+    }
+    
+    hid_t creationProperties = H5Pcreate( H5P_DATASET_CREATE );
+    if( creationProperties < 0 )
+    {
+        return -1;
+    }
+    
+    hsize_t *chunkSizes = new hsize_t[rank];
+    if( options.chunkSizes != NULL )
+    {
+        for( int i = 0; i < rank; i++ )
+        {
+            chunkSizes[i] = options.chunkSizes[i];
+        }
+    }
+    else
+    {
+        //Give the innermost dimensions whole to each chunk, as they are written together.
+        hsize_t remaining = DEFAULT_CHUNK_VALUES;
+        for( int i = rank - 1; i >= 0; i-- )
+        {
+            hsize_t size = ( sizes[i] > 0 ) ? sizes[i] : 1;
+            chunkSizes[i] = ( size < remaining ) ? size : remaining;
+            remaining /= chunkSizes[i];
+            if( remaining == 0 )
+            {
+                remaining = 1;
+            }
+        }
+    }
+    
+    herr_t status = H5Pset_chunk( creationProperties, rank, chunkSizes );
+    delete[] chunkSizes;
+    
+    if( ( status >= 0 ) && options.shuffle )
+    {
+        status = H5Pset_shuffle( creationProperties );
+    }
+    
+    if( ( status >= 0 ) && ( options.deflateLevel > 0 ) )
+    {
+        if( H5Zfilter_avail( H5Z_FILTER_DEFLATE ) <= 0 )
+        {
+            status = -1;
+        }
+        else
+        {
+            status = H5Pset_deflate( creationProperties, options.deflateLevel );
+        }
+    }
+    
+    if( status < 0 )
+    {
+        H5Pclose( creationProperties );
+        return -1;
+    }
+    
+    return creationProperties;
+}
+
+
+bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *sizes, FieldmlHandleType handleType, const ArrayDataWriterOptions &options )
+{
+    hsize_t *maxSizes = NULL;
+    if( options.maxSizes != NULL )
+    {
+        maxSizes = new hsize_t[rank];
+        for( int i = 0; i < rank; i++ )
+        {
+            maxSizes[i] = ( options.maxSizes[i] == FML_ARRAY_UNLIMITED_SIZE ) ? H5S_UNLIMITED : options.maxSizes[i];
+        }
+    }
+
     for( int i = 0; i < rank; i++ )
     {
         hSizes[i] = sizes[i];
     }
-    dataspace = H5Screate_simple( rank, hSizes, NULL );
+    dataspace = H5Screate_simple( rank, hSizes, maxSizes );
+    delete[] maxSizes;
     if( dataspace < 0 )
     {
         return false;
@@ -245,7 +335,18 @@ bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *
         return false;
     }
 
-    dataset = H5Dcreate( file, location.c_str(), datatype, dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    hid_t creationProperties = createDatasetProperties( sizes, options );
+    if( creationProperties < 0 )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return false;
+    }
+
+    dataset = H5Dcreate( file, location.c_str(), datatype, dataspace, H5P_DEFAULT, creationProperties, H5P_DEFAULT );
+    if( creationProperties != H5P_DEFAULT )
+    {
+        H5Pclose( creationProperties );
+    }
     if( dataset < 0 )
     {
         return false;
@@ -276,14 +377,8 @@ bool Hdf5ArrayDataWriter::initializeWithExistingDataset( int *sizes )
         return false;
     }
     
-    for( int i = 0; i < rank; i++ )
-    {
-        if( ( hSizes[i] != H5S_UNLIMITED ) && ( hSizes[i] < sizes[i] ) )
-        {
-            existingRank = -1;
-        }
-    }
-    if( existingRank < 0 )
+    //Grow the dataset if it is extensible and smaller than requested.
+    if( !extendDataset( sizes ) )
     {
         return false;
     }
@@ -294,6 +389,50 @@ bool Hdf5ArrayDataWriter::initializeWithExistingDataset( int *sizes )
 }
 
 
+/**
+ * Extends the dataset so that each dimension is at least the given size. Returns false if this is needed but the
+ * dataset's maximum sizes do not allow it. Only called while the writer is being opened, which every process must do
+ * with the same sizes under parallel HDF5, as extending a dataset is a collective operation.
+ */
+bool Hdf5ArrayDataWriter::extendDataset( const int *requiredSizes )
+{
+    hsize_t *currentSizes = new hsize_t[rank];
+    hsize_t *maxSizes = new hsize_t[rank];
+    
+    bool extend = false;
+    bool success = ( H5Sget_simple_extent_dims( dataspace, currentSizes, maxSizes ) == rank );
+    for( int i = 0; success && ( i < rank ); i++ )
+    {
+        const hsize_t required = requiredSizes[i];
+        if( required > currentSizes[i] )
+        {
+            if( ( maxSizes[i] != H5S_UNLIMITED ) && ( required > maxSizes[i] ) )
+            {
+                success = false;
+            }
+            currentSizes[i] = required;
+            extend = true;
+        }
+    }
+    
+    if( success && extend )
+    {
+        success = ( H5Dset_extent( dataset, currentSizes ) >= 0 );
+        if( success )
+        {
+            H5Sclose( dataspace );
+            dataspace = H5Dget_space( dataset );
+            success = ( dataspace >= 0 );
+        }
+    }
+    
+    delete[] currentSizes;
+    delete[] maxSizes;
+    
+    return success;
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataWriter::writeSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, const void *valueBuffer )
 {
     if( datatype != requiredDatatype )
@@ -302,6 +441,19 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::writeSlab( const int *offsets, const int *
         return -1;
     }
 
+    //The dataset is only extended when the writer is opened, as H5Dset_extent is collective under parallel HDF5.
+    hsize_t *currentSizes = new hsize_t[rank];
+    bool fits = ( H5Sget_simple_extent_dims( dataspace, currentSizes, NULL ) == rank );
+    for( int i = 0; fits && ( i < rank ); i++ )
+    {
+        fits = ( offsets[i] >= 0 ) && ( sizes[i] >= 0 ) && ( (hsize_t)offsets[i] + sizes[i] <= currentSizes[i] );
+    }
+    delete[] currentSizes;
+    if( !fits )
+    {
+        return context->setError( FML_IOERR_WRITE_ERROR );
+    }
+
     for( int i = 0; i < rank; i++ )
     {
         hOffsets[i] = offsets[i];
@@ -313,18 +465,8 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::writeSlab( const int *offsets, const int *
     herr_t status;
     status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL );
     
-    hid_t transferProperties = H5P_DEFAULT;
-
-//    if( collective )
-//    {
-//        transferProperties = H5Pcreate (H5P_DATASET_XFER);
-//        H5Pset_dxpl_mpio(transferProperties, H5FD_MPIO_COLLECTIVE);
-//    }
-    
     status = H5Dwrite( dataset, requiredDatatype, bufferSpace, dataspace, transferProperties, valueBuffer );
 
-//    H5Pclose( transferProperties );    
-    
     H5Sclose( bufferSpace );
     
     if( status >= 0 )
@@ -393,6 +535,11 @@ Hdf5ArrayDataWriter::~Hdf5ArrayDataWriter()
         close();
     }
     
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+    }
+    
     delete[] hStrides;
     delete[] hSizes;
     delete[] hOffsets;
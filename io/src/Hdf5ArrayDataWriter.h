@@ -65,16 +65,23 @@ private:
     hsize_t *hSizes;
     hsize_t *hOffsets;
     
+    //Dataset transfer properties, e.g. the MPI-IO transfer mode for parallel HDF5.
+    hid_t transferProperties;
+    
     bool initializeWithExistingDataset( int *sizes );
     
-    bool initializeWithNewDataset( const std::string sourceName, int *sizes, FieldmlHandleType handleType );
+    bool initializeWithNewDataset( const std::string sourceName, int *sizes, FieldmlHandleType handleType, const ArrayDataWriterOptions &options );
+    
+    hid_t createDatasetProperties( int *sizes, const ArrayDataWriterOptions &options );
+    
+    bool extendDataset( const int *requiredSizes );
 
     FmlIoErrorNumber writeSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, const void *valueBuffer );
 
 public:
     bool ok;
 
-    Hdf5ArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, hid_t fileAccessProperties );
+    Hdf5ArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, hid_t fileAccessProperties, hid_t _transferProperties, const ArrayDataWriterOptions &options );
     
     virtual FmlIoErrorNumber writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer );
     
@@ -86,7 +93,7 @@ public:
     
     virtual ~Hdf5ArrayDataWriter();
     
-    static Hdf5ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank );
+    static Hdf5ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, const ArrayDataWriterOptions &options );
 };
 #endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
 
@@ -44,6 +44,14 @@
 #include <cstring>
 #include <string>
 
+#if !defined( _WIN32 )
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define FIELDML_MAPPED_INPUT
+#endif
+
 #include "FieldmlIoApi.h"
 #include "InputStream.h"
 
@@ -67,39 +75,224 @@ public:
 };
 
 
-class StringInputStream :
+/**
+ * Reads directly out of a block of memory owned by someone else, rather than copying it into an intermediate buffer.
+ * The memory is presented to the superclass as a series of large windows so that buffer offsets fit in an int.
+ */
+class MemoryInputStream :
     public FieldmlInputStream
 {
-private:
-    const std::string string;
-    int stringPos;
-    int stringMaxLen;
-
 protected:
+    const char * const data;
+    const long dataSize;
+    long windowStart;
+    
     int loadBuffer();
     
 public:
     virtual long tell();
     virtual bool seek( long pos );
     
-    StringInputStream( const std::string _string );
-    virtual ~StringInputStream();
+    MemoryInputStream( const char *_data, long _dataSize );
+    virtual ~MemoryInputStream();
+};
+
+
+static const long MEMORY_WINDOW_SIZE = 1L << 30;
+
+
+/**
+ * Reads an inline data resource in place. The resource's inline data is locked for the life of the stream, so that
+ * it cannot be moved or freed while it is being read.
+ */
+class InlineDataInputStream :
+    public MemoryInputStream
+{
+private:
+    const FmlSessionHandle session;
+    const FmlObjectHandle resource;
+    
+public:
+    InlineDataInputStream( FmlSessionHandle _session, FmlObjectHandle _resource, const char *_data, int _dataSize );
+    virtual ~InlineDataInputStream();
 };
 
-static const int BUFFER_SIZE = 1024;
+
+#ifdef FIELDML_MAPPED_INPUT
+/**
+ * Reads a file through a read-only memory mapping, so that values are parsed directly out of the page cache.
+ */
+class MappedInputStream :
+    public MemoryInputStream
+{
+public:
+    MappedInputStream( char *_data, long _dataSize );
+    virtual ~MappedInputStream();
+    
+    static MappedInputStream *create( const std::string filename );
+};
+#endif //FIELDML_MAPPED_INPUT
+
+static const int BUFFER_SIZE = 65536;
 
 //Using a #define because the relevant buffer is allocated on stack.
 #define NBUFFER_SIZE 64
 
 
+static const double POWERS_OF_TEN[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const int MAX_EXACT_POWER_OF_TEN = 22;
+
+//Decimal significands of up to 15 digits are exactly representable as doubles.
+static const int MAX_EXACT_DIGITS = 15;
+
+
+static inline bool isIntChar( const int d )
+{
+    return ( ( d >= '0' ) && ( d <= '9' ) );
+}
+
+
+static inline bool isDoubleChar( const int d )
+{
+    return ( ( d >= '0' ) && ( d <= '9' ) ) || ( d == 'e' ) || ( d == 'E' ) || ( d == '-' ) || ( d == '+') || ( d == '.' );
+}
+
+
+/**
+ * Converts a decimal token when this can be done exactly, i.e. the significand and the power of ten are both exactly
+ * representable as doubles, so that a single multiplication or division gives the correctly rounded result.
+ * Returns false for anything else, in which case the caller should fall back to strtod.
+ */
+static bool parseExactDouble( const char *token, const int length, double &value )
+{
+#if defined( __FLT_EVAL_METHOD__ ) && ( __FLT_EVAL_METHOD__ != 0 )
+    //Extended-precision intermediates would introduce double rounding.
+    return false;
+#else
+    int pos = 0;
+    bool negative = false;
+    if( ( token[0] == '-' ) || ( token[0] == '+' ) )
+    {
+        negative = ( token[0] == '-' );
+        pos++;
+    }
+    
+    double significand = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool gotDigit = false;
+    
+    for( ; ( pos < length ) && isIntChar( token[pos] ); pos++ )
+    {
+        gotDigit = true;
+        significand = ( significand * 10 ) + ( token[pos] - '0' );
+        if( ( significand != 0 ) && ( ++digits > MAX_EXACT_DIGITS ) )
+        {
+            return false;
+        }
+    }
+    
+    if( ( pos < length ) && ( token[pos] == '.' ) )
+    {
+        for( pos++; ( pos < length ) && isIntChar( token[pos] ); pos++ )
+        {
+            gotDigit = true;
+            significand = ( significand * 10 ) + ( token[pos] - '0' );
+            exponent--;
+            if( ( significand != 0 ) && ( ++digits > MAX_EXACT_DIGITS ) )
+            {
+                return false;
+            }
+        }
+    }
+    
+    if( !gotDigit )
+    {
+        return false;
+    }
+    
+    if( ( pos < length ) && ( ( token[pos] == 'e' ) || ( token[pos] == 'E' ) ) )
+    {
+        pos++;
+        bool negativeExponent = false;
+        if( ( pos < length ) && ( ( token[pos] == '-' ) || ( token[pos] == '+' ) ) )
+        {
+            negativeExponent = ( token[pos] == '-' );
+            pos++;
+        }
+        
+        if( ( pos >= length ) || !isIntChar( token[pos] ) )
+        {
+            return false;
+        }
+        
+        int exponentValue = 0;
+        for( ; ( pos < length ) && isIntChar( token[pos] ); pos++ )
+        {
+            if( exponentValue < 10000 )
+            {
+                exponentValue = ( exponentValue * 10 ) + ( token[pos] - '0' );
+            }
+        }
+        
+        exponent += negativeExponent ? -exponentValue : exponentValue;
+    }
+    
+    if( pos != length )
+    {
+        return false;
+    }
+    
+    if( significand != 0 )
+    {
+        if( exponent > MAX_EXACT_POWER_OF_TEN )
+        {
+            return false;
+        }
+        else if( exponent >= 0 )
+        {
+            significand *= POWERS_OF_TEN[exponent];
+        }
+        else if( exponent >= -MAX_EXACT_POWER_OF_TEN )
+        {
+            significand /= POWERS_OF_TEN[-exponent];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    
+    value = negative ? -significand : significand;
+    return true;
+#endif
+}
+
+
 FieldmlInputStream::FieldmlInputStream()
 {
+    ownsBuffer = true;
     buffer = (char*)calloc( 1, BUFFER_SIZE );
     bufferCount = 0;
     bufferPos = 0;
     isEof = false;
 }
 
+
+FieldmlInputStream::FieldmlInputStream( char *_buffer )
+{
+    ownsBuffer = false;
+    buffer = _buffer;
+    bufferCount = 0;
+    bufferPos = 0;
+    isEof = false;
+}
+
 int FieldmlInputStream::readInt()
 {
     int value = 0;
@@ -199,6 +392,118 @@ double FieldmlInputStream::readDouble()
 }
 
 
+void FieldmlInputStream::readInts( int *values, int count )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        int value = 0;
+        int invert = 0;
+        int gotDigit = 0;
+        int pos;
+        
+        //Same state machine as readInt, but without refilling the buffer.
+        for( pos = bufferPos; pos < bufferCount; pos++ )
+        {
+            const int d = buffer[pos];
+            if( ( d >= '0' ) && ( d <= '9' ) )
+            {
+                gotDigit = 1;
+                
+                value *= 10;
+                value += ( d - '0' );
+            }
+            else if( ( d == '-' ) && ( !gotDigit ) )
+            {
+                invert = 1 - invert;
+            }
+            else if( gotDigit )
+            {
+                break;
+            }
+        }
+        
+        if( pos >= bufferCount )
+        {
+            //The value may continue into the next buffer load.
+            values[i] = readInt();
+            continue;
+        }
+        
+        bufferPos = pos;
+        values[i] = invert ? -value : value;
+    }
+}
+
+
+void FieldmlInputStream::readDoubles( double *values, int count )
+{
+    char nBuffer[NBUFFER_SIZE];
+    
+    for( int i = 0; i < count; i++ )
+    {
+        int start = bufferPos;
+        while( ( start < bufferCount ) && !isDoubleChar( buffer[start] ) )
+        {
+            start++;
+        }
+        
+        int end = start;
+        while( ( end < bufferCount ) && isDoubleChar( buffer[end] ) )
+        {
+            end++;
+        }
+        
+        if( end >= bufferCount )
+        {
+            //The value may continue into the next buffer load.
+            values[i] = readDouble();
+            continue;
+        }
+        
+        if( !parseExactDouble( buffer + start, end - start, values[i] ) )
+        {
+            int length = end - start;
+            if( length > NBUFFER_SIZE - 1 )
+            {
+                //As with readDouble, truncate ridiculously long numbers.
+                length = NBUFFER_SIZE - 1;
+            }
+            memcpy( nBuffer, buffer + start, length );
+            nBuffer[length] = 0;
+            values[i] = strtod( nBuffer, NULL );
+        }
+        
+        bufferPos = end;
+    }
+}
+
+
+void FieldmlInputStream::skipValues( int count )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        int end = bufferPos;
+        while( ( end < bufferCount ) && !isDoubleChar( buffer[end] ) )
+        {
+            end++;
+        }
+        while( ( end < bufferCount ) && isDoubleChar( buffer[end] ) )
+        {
+            end++;
+        }
+        
+        if( end >= bufferCount )
+        {
+            //The value may continue into the next buffer load.
+            readDouble();
+            continue;
+        }
+        
+        bufferPos = end;
+    }
+}
+
+
 FmlBoolean FieldmlInputStream::readBoolean()
 {
     int value = 0;
@@ -266,6 +571,15 @@ int FieldmlInputStream::skipLine()
 
 FieldmlInputStream *FieldmlInputStream::createTextFileStream( const string filename )
 {
+#ifdef FIELDML_MAPPED_INPUT
+    FieldmlInputStream *mappedStream = MappedInputStream::create( filename );
+    if( mappedStream != NULL )
+    {
+        return mappedStream;
+    }
+    //Fall back to stdio, e.g. for empty files or files that cannot be mapped.
+#endif //FIELDML_MAPPED_INPUT
+
     FILE *file;
     
     file = fopen( filename.c_str(), "r" );
@@ -279,9 +593,22 @@ FieldmlInputStream *FieldmlInputStream::createTextFileStream( const string filen
 }
 
 
-FieldmlInputStream *FieldmlInputStream::createStringStream( const string sourceString )
+FieldmlInputStream *FieldmlInputStream::createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource )
 {
-    return new StringInputStream( sourceString );
+    if( Fieldml_LockInlineData( session, resource ) != FML_ERR_NO_ERROR )
+    {
+        return NULL;
+    }
+    
+    int length = 0;
+    const char *data = Fieldml_GetInlineDataView( session, resource, &length );
+    if( data == NULL )
+    {
+        Fieldml_UnlockInlineData( session, resource );
+        return NULL;
+    }
+    
+    return new InlineDataInputStream( session, resource, data, length );
 }
 
 
@@ -293,7 +620,10 @@ bool FieldmlInputStream::eof()
 
 FieldmlInputStream::~FieldmlInputStream()
 {
-    free( buffer );
+    if( ownsBuffer )
+    {
+        free( buffer );
+    }
 }
 
 
@@ -345,59 +675,119 @@ bool FileInputStream::seek( long pos )
 }
 
 
-StringInputStream::StringInputStream( const std::string _string ) :
-    string( _string )
+#ifdef FIELDML_MAPPED_INPUT
+MappedInputStream *MappedInputStream::create( const string filename )
 {
-    stringPos = 0;
-    stringMaxLen = string.length();
+    int fd = open( filename.c_str(), O_RDONLY );
+    if( fd < 0 )
+    {
+        return NULL;
+    }
+    
+    struct stat info;
+    if( ( fstat( fd, &info ) != 0 ) || ( info.st_size <= 0 ) )
+    {
+        close( fd );
+        return NULL;
+    }
+    
+    void *data = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    
+    //The mapping remains valid after the descriptor is closed.
+    close( fd );
+    
+    if( data == MAP_FAILED )
+    {
+        return NULL;
+    }
+    
+#ifdef MADV_SEQUENTIAL
+    madvise( data, info.st_size, MADV_SEQUENTIAL );
+#endif
+    
+    return new MappedInputStream( (char*)data, info.st_size );
 }
 
 
-int StringInputStream::loadBuffer()
+MappedInputStream::MappedInputStream( char *_data, long _dataSize ) :
+    MemoryInputStream( _data, _dataSize )
 {
-    int len;
-    
-    bufferPos = 0;
+}
 
-    len = BUFFER_SIZE;
-    if( len + stringPos > stringMaxLen )
-    {
-        len = stringMaxLen - stringPos;
-    }
-    //NOTE: Ugly. Maybe just remove the idea of a superclass buffer. 
-    memcpy( buffer, string.c_str() + stringPos, len );
-    stringPos += len;
-    bufferCount = len;
 
-    if( bufferCount <= 0 )
+MappedInputStream::~MappedInputStream()
+{
+    munmap( (void*)data, dataSize );
+}
+#endif //FIELDML_MAPPED_INPUT
+
+
+//NOTE: The superclass never writes through its buffer, so it is safe to hand it read-only memory.
+MemoryInputStream::MemoryInputStream( const char *_data, long _dataSize ) :
+    FieldmlInputStream( const_cast<char*>( _data ) ),
+    data( _data ),
+    dataSize( _dataSize )
+{
+    windowStart = 0;
+}
+
+
+MemoryInputStream::~MemoryInputStream()
+{
+}
+
+
+InlineDataInputStream::InlineDataInputStream( FmlSessionHandle _session, FmlObjectHandle _resource, const char *_data, int _dataSize ) :
+    MemoryInputStream( _data, _dataSize ),
+    session( _session ),
+    resource( _resource )
+{
+}
+
+
+InlineDataInputStream::~InlineDataInputStream()
+{
+    Fieldml_UnlockInlineData( session, resource );
+}
+
+
+int MemoryInputStream::loadBuffer()
+{
+    windowStart += bufferCount;
+    bufferPos = 0;
+    
+    if( windowStart >= dataSize )
     {
+        bufferCount = 0;
         isEof = true;
         return 0;
     }
     
+    const long remaining = dataSize - windowStart;
+    
+    buffer = const_cast<char*>( data ) + windowStart;
+    bufferCount = ( remaining < MEMORY_WINDOW_SIZE ) ? remaining : MEMORY_WINDOW_SIZE;
+    
     return 1;
 }
 
 
-long StringInputStream::tell()
+long MemoryInputStream::tell()
 {
-    return stringPos - ( bufferCount - bufferPos );
+    return windowStart + bufferPos;
 }
 
 
-bool StringInputStream::seek( long pos )
+bool MemoryInputStream::seek( long pos )
 {
-    if( ( pos < 0 ) || ( pos >= stringMaxLen ) )
+    if( ( pos < 0 ) || ( pos > dataSize ) )
     {
         return false;
     }
     
-    stringPos = pos;
-    bufferPos = bufferCount;
+    windowStart = pos;
+    buffer = const_cast<char*>( data ) + pos;
+    bufferCount = 0;
+    bufferPos = 0;
     return true;
 }
-
-
-StringInputStream::~StringInputStream()
-{
-}
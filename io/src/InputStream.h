@@ -46,6 +46,9 @@
 
 class FieldmlInputStream
 {
+private:
+    bool ownsBuffer;
+    
 protected:
     char *buffer;
     int bufferCount;
@@ -55,11 +58,33 @@ protected:
     virtual int loadBuffer() = 0;
     
     FieldmlInputStream();
+    
+    /**
+     * For streams that manage their own buffer memory (e.g. memory-mapped files).
+     */
+    FieldmlInputStream( char *_buffer );
 public:
     int readInt();
 
     double readDouble();
     
+    /**
+     * Reads count consecutive integers into values. Equivalent to count calls to readInt(), but values that lie
+     * entirely within the current buffer are parsed in place.
+     */
+    void readInts( int *values, int count );
+    
+    /**
+     * Reads count consecutive doubles into values. Equivalent to count calls to readDouble(), but values that lie
+     * entirely within the current buffer are parsed in place.
+     */
+    void readDoubles( double *values, int count );
+    
+    /**
+     * Skips over count values without converting them. Equivalent to discarding the results of count calls to readDouble().
+     */
+    void skipValues( int count );
+    
     FmlBoolean readBoolean();
     
     int skipLine();
@@ -72,7 +97,12 @@ public:
     virtual bool seek( long pos ) = 0;
     
     static FieldmlInputStream *createTextFileStream( const std::string filename );
-    static FieldmlInputStream *createStringStream( const std::string string );
+    
+    /**
+     * Creates a stream that parses the given inline data resource in place. The resource's inline data is locked until
+     * the stream is destroyed. Returns NULL if the resource is not an inline data resource.
+     */
+    static FieldmlInputStream *createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource );
 };
 
 #endif //H_FIELDML_INPUT_STREAM
@@ -0,0 +1,274 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <algorithm>
+
+#include "LagrangeInterpolator.h"
+
+using namespace std;
+
+//Points are processed in blocks of this size, so that the one-dimensional basis values stay in L1 cache.
+static const int KERNEL_BLOCK_SIZE = 64;
+
+//========================================================================
+//
+// One-dimensional bases
+//
+//========================================================================
+
+/**
+ * The one-dimensional Lagrange basis of the given order. Basis function j at point i is written to
+ * basis[j * KERNEL_BLOCK_SIZE + i]. Each order is written out in full, so that the loops have no
+ * data-dependent control flow and can be vectorised.
+ */
+template<int ORDER> class LagrangeBasis;
+
+
+template<> class LagrangeBasis<1>
+{
+public:
+    static void evaluate( const int count, const double *x, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            b0[i] = 1.0 - x[i];
+            b1[i] = x[i];
+        }
+    }
+    
+    
+    static void evaluateDerivative( const int count, const double * /*x*/, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            b0[i] = -1.0;
+            b1[i] = 1.0;
+        }
+    }
+};
+
+
+template<> class LagrangeBasis<2>
+{
+public:
+    static void evaluate( const int count, const double *x, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE, *b2 = basis + 2 * KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            const double a = x[i], b = x[i] - 0.5, c = x[i] - 1.0;
+            b0[i] = 2.0 * b * c;
+            b1[i] = -4.0 * a * c;
+            b2[i] = 2.0 * a * b;
+        }
+    }
+    
+    
+    static void evaluateDerivative( const int count, const double *x, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE, *b2 = basis + 2 * KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            const double a = x[i];
+            b0[i] = 4.0 * a - 3.0;
+            b1[i] = 4.0 - 8.0 * a;
+            b2[i] = 4.0 * a - 1.0;
+        }
+    }
+};
+
+
+template<> class LagrangeBasis<3>
+{
+public:
+    static void evaluate( const int count, const double *x, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE, *b2 = basis + 2 * KERNEL_BLOCK_SIZE, *b3 = basis + 3 * KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            const double a = x[i], b = x[i] - 1.0 / 3.0, c = x[i] - 2.0 / 3.0, d = x[i] - 1.0;
+            b0[i] = -4.5 * b * c * d;
+            b1[i] = 13.5 * a * c * d;
+            b2[i] = -13.5 * a * b * d;
+            b3[i] = 4.5 * a * b * c;
+        }
+    }
+    
+    
+    static void evaluateDerivative( const int count, const double *x, double *basis )
+    {
+        double *b0 = basis, *b1 = basis + KERNEL_BLOCK_SIZE, *b2 = basis + 2 * KERNEL_BLOCK_SIZE, *b3 = basis + 3 * KERNEL_BLOCK_SIZE;
+        for( int i = 0; i < count; i++ )
+        {
+            const double a = x[i], b = x[i] - 1.0 / 3.0, c = x[i] - 2.0 / 3.0, d = x[i] - 1.0;
+            b0[i] = -4.5 * ( c * d + b * d + b * c );
+            b1[i] = 13.5 * ( c * d + a * d + a * c );
+            b2[i] = -13.5 * ( b * d + a * d + a * b );
+            b3[i] = 4.5 * ( b * c + a * c + a * b );
+        }
+    }
+};
+
+
+//========================================================================
+//
+// Tensor-product kernels
+//
+//========================================================================
+
+template<int BASE, int EXPONENT> class Power
+{
+public:
+    enum { value = BASE * Power<BASE, EXPONENT - 1>::value };
+};
+
+
+template<int BASE> class Power<BASE, 0>
+{
+public:
+    enum { value = 1 };
+};
+
+
+template<int DIMENSIONS, int ORDER> class LagrangeKernel
+{
+public:
+    enum
+    {
+        NODE_COUNT = ORDER + 1,
+        BASIS_COUNT = Power<ORDER + 1, DIMENSIONS>::value
+    };
+    
+    static void evaluate( const int count, const double *xi, const double *parameters, const int derivativeDirection, double *values )
+    {
+        double basis[DIMENSIONS][NODE_COUNT * KERNEL_BLOCK_SIZE];
+        double outer[KERNEL_BLOCK_SIZE];
+        double sums[KERNEL_BLOCK_SIZE];
+        
+        for( int first = 0; first < count; first += KERNEL_BLOCK_SIZE )
+        {
+            const int blockCount = min( KERNEL_BLOCK_SIZE, count - first );
+            
+            for( int d = 0; d < DIMENSIONS; d++ )
+            {
+                if( d == derivativeDirection )
+                {
+                    LagrangeBasis<ORDER>::evaluateDerivative( blockCount, xi + d * count + first, basis[d] );
+                }
+                else
+                {
+                    LagrangeBasis<ORDER>::evaluate( blockCount, xi + d * count + first, basis[d] );
+                }
+            }
+            
+            fill( sums, sums + blockCount, 0.0 );
+            for( int b = 0; b < BASIS_COUNT; b++ )
+            {
+                //The product of the basis functions for the outer dimensions only changes once per NODE_COUNT nodes.
+                const int n0 = b % NODE_COUNT;
+                if( n0 == 0 )
+                {
+                    fill( outer, outer + blockCount, 1.0 );
+                    int node = b;
+                    for( int d = 1; d < DIMENSIONS; d++ )
+                    {
+                        node /= NODE_COUNT;
+                        const double *factor = basis[d] + ( node % NODE_COUNT ) * KERNEL_BLOCK_SIZE;
+                        for( int i = 0; i < blockCount; i++ )
+                        {
+                            outer[i] *= factor[i];
+                        }
+                    }
+                }
+                
+                const double *inner = basis[0] + n0 * KERNEL_BLOCK_SIZE;
+                const double *nodeParameters = parameters + b * count + first;
+                for( int i = 0; i < blockCount; i++ )
+                {
+                    sums[i] += inner[i] * outer[i] * nodeParameters[i];
+                }
+            }
+            
+            copy( sums, sums + blockCount, values + first );
+        }
+    }
+};
+
+
+//========================================================================
+//
+// LagrangeInterpolator
+//
+//========================================================================
+
+#define LAGRANGE_INTERPOLATOR( name, dimensions, order ) \
+    { name, dimensions, order, LagrangeKernel<dimensions, order>::BASIS_COUNT, LagrangeKernel<dimensions, order>::evaluate }
+
+static const LagrangeInterpolator LAGRANGE_INTERPOLATORS[] =
+{
+    LAGRANGE_INTERPOLATOR( "interpolator.1d.unit.linearLagrange", 1, 1 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.1d.unit.quadraticLagrange", 1, 2 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.1d.unit.cubicLagrange", 1, 3 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.2d.unit.bilinearLagrange", 2, 1 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.2d.unit.biquadraticLagrange", 2, 2 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.2d.unit.bicubicLagrange", 2, 3 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.3d.unit.trilinearLagrange", 3, 1 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.3d.unit.triquadraticLagrange", 3, 2 ),
+    LAGRANGE_INTERPOLATOR( "interpolator.3d.unit.tricubicLagrange", 3, 3 ),
+};
+
+static const int LAGRANGE_INTERPOLATOR_COUNT = sizeof( LAGRANGE_INTERPOLATORS ) / sizeof( LAGRANGE_INTERPOLATORS[0] );
+
+
+const LagrangeInterpolator *LagrangeInterpolator::find( const string &name )
+{
+    for( int i = 0; i < LAGRANGE_INTERPOLATOR_COUNT; i++ )
+    {
+        if( name == LAGRANGE_INTERPOLATORS[i].name )
+        {
+            return &LAGRANGE_INTERPOLATORS[i];
+        }
+    }
+    
+    return NULL;
+}
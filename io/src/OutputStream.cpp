@@ -41,305 +41,793 @@
 
 #include <cstdio>
 #include <cstdlib>
-#include <cstring> 
-#include <sstream>
+#include <cstring>
+#include <string>
 
 #include "FieldmlIoApi.h"
 #include "OutputStream.h"
 
-//Using a #define because the relevant buffer is allocated on stack.
+using namespace std;
+
+static const int BUFFER_SIZE = 65536;
+
+//The most space a single formatted value, plus its separator, can take up in the stream buffer.
 #define NBUFFER_SIZE 64
 
-using namespace std;
+//Using a #define because the relevant buffer is allocated on stack.
+#define DIGIT_BUFFER_SIZE 32
+
 
 class FileOutputStream :
     public FieldmlOutputStream
 {
 private:
     FILE *file;
-    
-    bool closed;
-    
-public:
-    FileOutputStream( FILE *_file );
-
-    FmlIoErrorNumber writeInt( int value );
 
-    FmlIoErrorNumber writeDouble( double value );
+protected:
+    FmlIoErrorNumber writeBuffer( const char *text, int count );
 
-    FmlIoErrorNumber writeBoolean( bool value );
+public:
+    FileOutputStream( FILE *_file );
 
-    FmlIoErrorNumber writeNewline();
-    
     FmlIoErrorNumber close();
 
     virtual ~FileOutputStream();
 };
 
-        
-class StringOutputStream :
+
+/**
+ * Appends each flushed block of text directly to an inline data resource, so that no copy of the whole text is held.
+ */
+class InlineDataOutputStream :
     public FieldmlOutputStream
 {
 private:
-    bool closed;
-    
-    stringstream buffer;
-    
-    StreamCloseTask * closeTask;
-    
+    const FmlSessionHandle session;
+    const FmlObjectHandle resource;
+
+protected:
+    FmlIoErrorNumber writeBuffer( const char *text, int count );
+
 public:
-    StringOutputStream( StreamCloseTask *_closeTask = NULL );
+    InlineDataOutputStream( FmlSessionHandle _session, FmlObjectHandle _resource );
 
-    FmlIoErrorNumber writeInt( int value );
-    
-    FmlIoErrorNumber writeDouble( double value );
-    
-    FmlIoErrorNumber writeBoolean( bool value );
-    
-    FmlIoErrorNumber writeNewline();
-    
     FmlIoErrorNumber close();
-    
-    virtual ~StringOutputStream();
+
+    virtual ~InlineDataOutputStream();
 };
 
-    
-FieldmlOutputStream::FieldmlOutputStream()
+
+/*
+ * Shortest round-trip double formatting, using Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010). The generated digits always read back as the original double, and are the
+ * shortest such digits for all but a small fraction of values, for which one extra digit may be produced.
+ */
+
+static const uint64_t DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+static const uint64_t DP_EXPONENT_MASK = 0x7FF0000000000000ULL;
+static const uint64_t DP_HIDDEN_BIT = 0x0010000000000000ULL;
+static const int DP_SIGNIFICAND_SIZE = 52;
+static const int DP_EXPONENT_BIAS = 0x3FF + DP_SIGNIFICAND_SIZE;
+static const int DP_MIN_EXPONENT = -DP_EXPONENT_BIAS;
+static const int DIY_SIGNIFICAND_SIZE = 64;
+
+
+//Normalized 64-bit approximations of 10^k, for k = -348, -340, ..., 340.
+static const uint64_t CACHED_POWERS_F[] =
+{
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int CACHED_POWERS_E[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const int CACHED_POWERS_MIN_EXPONENT = -348;
+static const int CACHED_POWERS_STEP = 8;
+
+
+static const uint64_t POWERS_OF_TEN[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+static const int POWERS_OF_TEN_COUNT = 20;
+
+
+/**
+ * A floating point value with a 64-bit significand: f * 2^e.
+ */
+class DiyFp
+{
+public:
+    uint64_t f;
+    int e;
+
+    DiyFp( uint64_t _f, int _e ) :
+        f( _f ), e( _e )
+    {
+    }
+
+
+    DiyFp( double value )
+    {
+        uint64_t bits;
+        memcpy( &bits, &value, sizeof( bits ) );
+
+        int biasedExponent = (int)( ( bits & DP_EXPONENT_MASK ) >> DP_SIGNIFICAND_SIZE );
+        uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+        if( biasedExponent != 0 )
+        {
+            f = significand + DP_HIDDEN_BIT;
+            e = biasedExponent - DP_EXPONENT_BIAS;
+        }
+        else
+        {
+            //Subnormal.
+            f = significand;
+            e = DP_MIN_EXPONENT + 1;
+        }
+    }
+
+
+    DiyFp minus( const DiyFp &rhs ) const
+    {
+        return DiyFp( f - rhs.f, e );
+    }
+
+
+    /**
+     * Returns the upper 64 bits of the 128-bit product, rounded.
+     */
+    DiyFp times( const DiyFp &rhs ) const
+    {
+        const uint64_t M32 = 0xFFFFFFFFULL;
+        const uint64_t a = f >> 32;
+        const uint64_t b = f & M32;
+        const uint64_t c = rhs.f >> 32;
+        const uint64_t d = rhs.f & M32;
+        const uint64_t ac = a * c;
+        const uint64_t bc = b * c;
+        const uint64_t ad = a * d;
+        const uint64_t bd = b * d;
+        uint64_t tmp = ( bd >> 32 ) + ( ad & M32 ) + ( bc & M32 );
+        tmp += 1ULL << 31;
+
+        return DiyFp( ac + ( ad >> 32 ) + ( bc >> 32 ) + ( tmp >> 32 ), e + rhs.e + 64 );
+    }
+
+
+    DiyFp normalize() const
+    {
+        DiyFp result = *this;
+        while( !( result.f & DP_HIDDEN_BIT ) )
+        {
+            result.f <<= 1;
+            result.e--;
+        }
+
+        result.f <<= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 1 );
+        result.e -= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 1 );
+        return result;
+    }
+
+
+    DiyFp normalizeBoundary() const
+    {
+        DiyFp result = *this;
+        while( !( result.f & ( DP_HIDDEN_BIT << 1 ) ) )
+        {
+            result.f <<= 1;
+            result.e--;
+        }
+
+        result.f <<= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2 );
+        result.e -= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2 );
+        return result;
+    }
+
+
+    /**
+     * Computes the normalized boundaries halfway to the neighbouring doubles, which bound the digits that will still
+     * read back as this value.
+     */
+    void normalizedBoundaries( DiyFp &lower, DiyFp &upper ) const
+    {
+        DiyFp plus = DiyFp( ( f << 1 ) + 1, e - 1 ).normalizeBoundary();
+        DiyFp minus = ( f == DP_HIDDEN_BIT ) ? DiyFp( ( f << 2 ) - 1, e - 2 ) : DiyFp( ( f << 1 ) - 1, e - 1 );
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+
+        lower = minus;
+        upper = plus;
+    }
+};
+
+
+/**
+ * Picks a cached power of ten, c = 10^-k, such that the binary exponent of a normalized value with exponent e scaled
+ * by c lies in the range in which digit generation works.
+ */
+static DiyFp getCachedPower( int e, int &k )
 {
+    //0.30102999566398114 is log10(2).
+    double dk = ( -61 - e ) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if( ik != dk )
+    {
+        ik++;
+    }
+
+    unsigned int index = (unsigned int)( ( ik >> 3 ) + 1 );
+    k = -( CACHED_POWERS_MIN_EXPONENT + (int)( index * CACHED_POWERS_STEP ) );
+
+    return DiyFp( CACHED_POWERS_F[index], CACHED_POWERS_E[index] );
 }
 
 
-FieldmlOutputStream::~FieldmlOutputStream()
+static inline int countDecimalDigits( uint32_t n )
 {
+    int digits = 1;
+    while( ( digits < 10 ) && ( n >= POWERS_OF_TEN[digits] ) )
+    {
+        digits++;
+    }
+
+    return digits;
 }
 
-    
-FileOutputStream::FileOutputStream( FILE *_file ) :
-    file( _file ),
-    closed( false )
+
+/**
+ * Nudges the last generated digit towards the exact value, while remaining inside the rounding interval.
+ */
+static void grisuRound( char *digits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance )
 {
+    while( ( rest < distance ) && ( delta - rest >= tenKappa ) &&
+        ( ( rest + tenKappa < distance ) || ( distance - rest > rest + tenKappa - distance ) ) )
+    {
+        digits[length - 1]--;
+        rest += tenKappa;
+    }
 }
 
 
-FieldmlOutputStream *FieldmlOutputStream::createTextFileStream( const string filename, bool append )
+static void generateDigits( const DiyFp &w, const DiyFp &upper, uint64_t delta, char *digits, int &length, int &k )
 {
-    FILE *file;
-    
-    if( append )
+    const DiyFp one( 1ULL << -upper.e, upper.e );
+    const DiyFp distance = upper.minus( w );
+    uint32_t integral = (uint32_t)( upper.f >> -one.e );
+    uint64_t fractional = upper.f & ( one.f - 1 );
+    int kappa = countDecimalDigits( integral );
+
+    length = 0;
+
+    while( kappa > 0 )
     {
-        file = fopen( filename.c_str(), "a" );
+        const uint32_t divisor = (uint32_t)POWERS_OF_TEN[kappa - 1];
+        const uint32_t d = integral / divisor;
+        integral %= divisor;
+
+        if( ( d != 0 ) || ( length != 0 ) )
+        {
+            digits[length++] = (char)( '0' + d );
+        }
+        kappa--;
+
+        const uint64_t rest = ( (uint64_t)integral << -one.e ) + fractional;
+        if( rest <= delta )
+        {
+            k += kappa;
+            grisuRound( digits, length, delta, rest, POWERS_OF_TEN[kappa] << -one.e, distance.f );
+            return;
+        }
     }
-    else
+
+    while( true )
     {
-        file = fopen( filename.c_str(), "w" );
+        fractional *= 10;
+        delta *= 10;
+
+        const char d = (char)( fractional >> -one.e );
+        if( ( d != 0 ) || ( length != 0 ) )
+        {
+            digits[length++] = (char)( '0' + d );
+        }
+        fractional &= one.f - 1;
+        kappa--;
+
+        if( fractional < delta )
+        {
+            k += kappa;
+            const uint64_t scale = ( -kappa < POWERS_OF_TEN_COUNT ) ? POWERS_OF_TEN[-kappa] : 0;
+            grisuRound( digits, length, delta, fractional, one.f, distance.f * scale );
+            return;
+        }
     }
-    
-    if( file == NULL )
+}
+
+
+/**
+ * Generates the decimal digits of a positive, finite value, such that value = digits * 10^k.
+ */
+static void grisu2( double value, char *digits, int &length, int &k )
+{
+    const DiyFp v( value );
+    DiyFp lower( 0, 0 );
+    DiyFp upper( 0, 0 );
+    v.normalizedBoundaries( lower, upper );
+
+    const DiyFp cachedPower = getCachedPower( upper.e, k );
+    const DiyFp w = v.normalize().times( cachedPower );
+    DiyFp scaledUpper = upper.times( cachedPower );
+    DiyFp scaledLower = lower.times( cachedPower );
+
+    //Shrink the interval by one unit either side to allow for the error in the cached power.
+    scaledLower.f++;
+    scaledUpper.f--;
+
+    generateDigits( w, scaledUpper, scaledUpper.f - scaledLower.f, digits, length, k );
+}
+
+
+/**
+ * Lays out the digits, with value = digits * 10^k, in the same fixed or exponential style as printf's %g.
+ */
+static int layoutDigits( const char *digits, const int length, const int k, char *text )
+{
+    //The value lies in [10^(exponent), 10^(exponent+1)).
+    const int exponent = length + k - 1;
+    int pos = 0;
+
+    if( ( exponent >= -4 ) && ( exponent < 17 ) )
     {
-        return NULL;
+        if( exponent >= length - 1 )
+        {
+            //Integral, e.g. 1234e2 -> 123400
+            memcpy( text, digits, length );
+            pos = length;
+            for( int i = length; i <= exponent; i++ )
+            {
+                text[pos++] = '0';
+            }
+        }
+        else if( exponent >= 0 )
+        {
+            //e.g. 1234e-2 -> 12.34
+            memcpy( text, digits, exponent + 1 );
+            pos = exponent + 1;
+            text[pos++] = '.';
+            memcpy( text + pos, digits + exponent + 1, length - ( exponent + 1 ) );
+            pos += length - ( exponent + 1 );
+        }
+        else
+        {
+            //e.g. 1234e-6 -> 0.001234
+            text[pos++] = '0';
+            text[pos++] = '.';
+            for( int i = -1; i > exponent; i-- )
+            {
+                text[pos++] = '0';
+            }
+            memcpy( text + pos, digits, length );
+            pos += length;
+        }
+
+        return pos;
     }
-    
-    return new FileOutputStream( file );
+
+    //e.g. 1234e30 -> 1.234e+33
+    text[pos++] = digits[0];
+    if( length > 1 )
+    {
+        text[pos++] = '.';
+        memcpy( text + pos, digits + 1, length - 1 );
+        pos += length - 1;
+    }
+
+    text[pos++] = 'e';
+    text[pos++] = ( exponent < 0 ) ? '-' : '+';
+    int magnitude = ( exponent < 0 ) ? -exponent : exponent;
+    if( magnitude >= 100 )
+    {
+        text[pos++] = (char)( '0' + ( magnitude / 100 ) );
+        magnitude %= 100;
+    }
+    text[pos++] = (char)( '0' + ( magnitude / 10 ) );
+    text[pos++] = (char)( '0' + ( magnitude % 10 ) );
+
+    return pos;
 }
 
 
-FieldmlOutputStream *FieldmlOutputStream::createStringStream( StreamCloseTask *closeTask )
+/**
+ * Formats the given double into text, using the given number of significant digits, or just enough digits to read
+ * back as the same value if precision is zero. Returns the number of characters written, which will be less than
+ * NBUFFER_SIZE.
+ */
+static int formatDouble( const double value, const int precision, char *text )
 {
-    return new StringOutputStream( closeTask );
+    if( ( precision > 0 ) || ( value - value != 0 ) )
+    {
+        //Fixed precision, infinity or NaN.
+        return sprintf( text, "%.*g", ( precision > 0 ) ? precision : 6, value );
+    }
+
+    int pos = 0;
+    double magnitude = value;
+    uint64_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    if( bits >> 63 )
+    {
+        text[pos++] = '-';
+        magnitude = -value;
+    }
+
+    if( magnitude == 0 )
+    {
+        text[pos++] = '0';
+        return pos;
+    }
+
+    char digits[DIGIT_BUFFER_SIZE];
+    int length;
+    int k;
+    grisu2( magnitude, digits, length, k );
+
+    return pos + layoutDigits( digits, length, k, text + pos );
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeBoolean( bool value )
+static inline int formatInt( const int value, char *text )
 {
-    if( closed )
+    char digits[DIGIT_BUFFER_SIZE];
+    int length = 0;
+
+    unsigned int magnitude = ( value < 0 ) ? ( 0U - (unsigned int)value ) : (unsigned int)value;
+    do
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        digits[length++] = (char)( '0' + ( magnitude % 10 ) );
+        magnitude /= 10;
     }
-    
-    int err = fprintf( file, "%d ", value ? 1 : 0 );
+    while( magnitude != 0 );
 
-    if( err < 0 )
+    int pos = 0;
+    if( value < 0 )
     {
-        return FML_IOERR_WRITE_ERROR;
+        text[pos++] = '-';
     }
-    
-    return FML_IOERR_NO_ERROR;
+    while( length > 0 )
+    {
+        text[pos++] = digits[--length];
+    }
+
+    return pos;
+}
+
+
+FieldmlOutputStream::FieldmlOutputStream() :
+    bufferCount( 0 ),
+    precision( 0 ),
+    closed( false )
+{
+    buffer = new char[BUFFER_SIZE];
+}
+
+
+FieldmlOutputStream::~FieldmlOutputStream()
+{
+    delete[] buffer;
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::flush()
+{
+    if( bufferCount == 0 )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+
+    int count = bufferCount;
+    bufferCount = 0;
+
+    return writeBuffer( buffer, count );
+}
+
+
+void FieldmlOutputStream::setPrecision( int significantDigits )
+{
+    precision = significantDigits;
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeDouble( double value )
+FmlIoErrorNumber FieldmlOutputStream::writeInts( const int *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "%.8g ", value );
-
-    if( err < 0 )
+    for( int i = 0; i < count; i++ )
     {
-        return FML_IOERR_WRITE_ERROR;
+        if( bufferCount > BUFFER_SIZE - NBUFFER_SIZE )
+        {
+            FmlIoErrorNumber err = flush();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+
+        bufferCount += formatInt( values[i], buffer + bufferCount );
+        buffer[bufferCount++] = ' ';
     }
-    
+
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeInt( int value )
+FmlIoErrorNumber FieldmlOutputStream::writeDoubles( const double *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "%d ", value );
-    
-    if( err < 0 )
+    for( int i = 0; i < count; i++ )
     {
-        return FML_IOERR_WRITE_ERROR;
+        if( bufferCount > BUFFER_SIZE - NBUFFER_SIZE )
+        {
+            FmlIoErrorNumber err = flush();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+
+        bufferCount += formatDouble( values[i], precision, buffer + bufferCount );
+        buffer[bufferCount++] = ' ';
     }
-    
+
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeNewline()
+FmlIoErrorNumber FieldmlOutputStream::writeBooleans( const FmlBoolean *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "\n" );
-    
-    if( err < 0 )
+    for( int i = 0; i < count; i++ )
     {
-        return FML_IOERR_WRITE_ERROR;
+        if( bufferCount > BUFFER_SIZE - NBUFFER_SIZE )
+        {
+            FmlIoErrorNumber err = flush();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+
+        buffer[bufferCount++] = values[i] ? '1' : '0';
+        buffer[bufferCount++] = ' ';
     }
-    
+
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber FileOutputStream::close()
+FmlIoErrorNumber FieldmlOutputStream::writeInt( int value )
+{
+    return writeInts( &value, 1 );
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::writeDouble( double value )
+{
+    return writeDoubles( &value, 1 );
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::writeBoolean( bool value )
+{
+    FmlBoolean booleanValue = value ? 1 : 0;
+
+    return writeBooleans( &booleanValue, 1 );
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::writeNewline()
 {
     if( closed )
     {
-        return FML_IOERR_NO_ERROR;
-    }
-    
-    closed = true;
-    if( file == NULL )
-    {
-        return FML_IOERR_NO_ERROR;
+        return FML_IOERR_RESOURCE_CLOSED;
     }
-    
-    int err = fclose( file );
-    file = NULL;
-    
-    if( err != 0 )
+
+    if( bufferCount > BUFFER_SIZE - NBUFFER_SIZE )
     {
-        return FML_IOERR_CLOSE_FAILED;
+        FmlIoErrorNumber err = flush();
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            return err;
+        }
     }
-    
+
+    buffer[bufferCount++] = '\n';
+
     return FML_IOERR_NO_ERROR;
 }
 
 
-FileOutputStream::~FileOutputStream()
+FileOutputStream::FileOutputStream( FILE *_file ) :
+    file( _file )
 {
-    if( !closed )
+}
+
+
+FieldmlOutputStream *FieldmlOutputStream::createTextFileStream( const string filename, bool append )
+{
+    FILE *file;
+
+    if( append )
     {
-        close();
+        file = fopen( filename.c_str(), "a" );
     }
+    else
+    {
+        file = fopen( filename.c_str(), "w" );
+    }
+
+    if( file == NULL )
+    {
+        return NULL;
+    }
+
+    return new FileOutputStream( file );
 }
 
 
-StringOutputStream::StringOutputStream( StreamCloseTask *_closeTask ) :
-    closeTask( _closeTask ),
-    closed( false )
+FieldmlOutputStream *FieldmlOutputStream::createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource, bool append )
 {
+    //Adding nothing checks that the resource can be written to, e.g. that it is not locked by a reader.
+    FmlErrorNumber err = append ? Fieldml_AddInlineData( session, resource, "", 0 ) : Fieldml_SetInlineData( session, resource, "", 0 );
+    if( err != FML_ERR_NO_ERROR )
+    {
+        return NULL;
+    }
+    
+    return new InlineDataOutputStream( session, resource );
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeDouble( double value )
+FmlIoErrorNumber FileOutputStream::writeBuffer( const char *text, int count )
 {
-    if( closed )
+    if( fwrite( text, 1, count, file ) != (size_t)count )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return FML_IOERR_WRITE_ERROR;
     }
 
-    buffer << value << " ";
-    
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeBoolean( bool value )
+FmlIoErrorNumber FileOutputStream::close()
 {
     if( closed )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return FML_IOERR_NO_ERROR;
+    }
+
+    if( file == NULL )
+    {
+        closed = true;
+        return FML_IOERR_NO_ERROR;
+    }
+
+    FmlIoErrorNumber flushErr = flush();
+    closed = true;
+
+    int err = fclose( file );
+    file = NULL;
+
+    if( flushErr != FML_IOERR_NO_ERROR )
+    {
+        return flushErr;
+    }
+
+    if( err != 0 )
+    {
+        return FML_IOERR_CLOSE_FAILED;
     }
 
-    buffer << (value?1:0) << " ";
-    
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeInt( int value )
+FileOutputStream::~FileOutputStream()
 {
-    if( closed )
+    if( !closed )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        close();
     }
+}
 
-    buffer << value << " ";
-    
-    return FML_IOERR_NO_ERROR;
+
+InlineDataOutputStream::InlineDataOutputStream( FmlSessionHandle _session, FmlObjectHandle _resource ) :
+    session( _session ),
+    resource( _resource )
+{
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeNewline()
+FmlIoErrorNumber InlineDataOutputStream::writeBuffer( const char *text, int count )
 {
-    if( closed )
+    if( Fieldml_AddInlineData( session, resource, text, count ) != FML_ERR_NO_ERROR )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return FML_IOERR_CORE_ERROR;
     }
 
-    buffer << "\n";
-    
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber StringOutputStream::close()
+FmlIoErrorNumber InlineDataOutputStream::close()
 {
     if( closed )
     {
         return FML_IOERR_NO_ERROR;
     }
-    
+
+    FmlIoErrorNumber err = flush();
     closed = true;
-    
-    if( closeTask == NULL )
-    {
-        return FML_IOERR_NO_ERROR;
-    }
-    else
-    {
-        return closeTask->onStreamClose( buffer.str() );
-    }
+
+    return err;
 }
 
 
-StringOutputStream::~StringOutputStream()
+InlineDataOutputStream::~InlineDataOutputStream()
 {
-    //NOTE: CPL2011/11/7 This seems reasonable. I think.
-    delete closeTask;
-    closeTask = NULL;
-    
     if( !closed )
     {
         close();
@@ -44,36 +44,70 @@
 
 #include <cstring>
 
-class StreamCloseTask
-{
-public:
-    virtual FmlIoErrorNumber onStreamClose( const std::string &info ) = 0;
-    
-    virtual ~StreamCloseTask() {}
-};
-
-
 class FieldmlOutputStream
 {
+private:
+    char *buffer;
+    int bufferCount;
+    int precision;
+
 protected:
+    bool closed;
+
     FieldmlOutputStream();
 
+    /**
+     * Passes formatted text on to the stream's destination.
+     */
+    virtual FmlIoErrorNumber writeBuffer( const char *text, int count ) = 0;
+
+    /**
+     * Passes any buffered text to writeBuffer() and empties the buffer.
+     */
+    FmlIoErrorNumber flush();
+
 public:
-    virtual FmlIoErrorNumber writeInt( int value ) = 0;
+    FmlIoErrorNumber writeInt( int value );
 
-    virtual FmlIoErrorNumber writeDouble( double value ) = 0;
+    FmlIoErrorNumber writeDouble( double value );
+    
+    FmlIoErrorNumber writeBoolean( bool value );
+    
+    /**
+     * Writes count consecutive integers. Equivalent to count calls to writeInt().
+     */
+    FmlIoErrorNumber writeInts( const int *values, int count );
     
-    virtual FmlIoErrorNumber writeBoolean( bool value ) = 0;
+    /**
+     * Writes count consecutive doubles. Equivalent to count calls to writeDouble().
+     */
+    FmlIoErrorNumber writeDoubles( const double *values, int count );
     
-    virtual FmlIoErrorNumber writeNewline() = 0;
+    /**
+     * Writes count consecutive booleans. Equivalent to count calls to writeBoolean().
+     */
+    FmlIoErrorNumber writeBooleans( const FmlBoolean *values, int count );
+    
+    FmlIoErrorNumber writeNewline();
+    
+    /**
+     * Sets the number of significant digits used when writing doubles. Zero, the default, writes just enough digits for
+     * the text to read back as exactly the same double.
+     */
+    void setPrecision( int significantDigits );
     
     virtual FmlIoErrorNumber close() = 0;
     
     virtual ~FieldmlOutputStream();
     
     static FieldmlOutputStream *createTextFileStream( const std::string filename, bool append );
-
-    static FieldmlOutputStream *createStringStream( StreamCloseTask *closeTask = NULL );
+    
+    /**
+     * Creates a stream that appends its text to the given inline data resource as it is flushed. Unless append is set,
+     * the resource's existing data is cleared first. Returns NULL if the resource cannot be written to, e.g. because
+     * it is being read.
+     */
+    static FieldmlOutputStream *createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource, bool append );
 };
 
 #endif //H_FIELDML_OUTPUT_STREAM
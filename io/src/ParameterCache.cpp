@@ -0,0 +1,322 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <algorithm>
+#include <string>
+
+#include "StringUtil.h"
+#include "fieldml_api.h"
+
+#include "FieldmlIoSession.h"
+#include "ArrayDataReader.h"
+#include "ParameterCache.h"
+
+using namespace std;
+
+//========================================================================
+//
+// ParameterArray
+//
+//========================================================================
+
+/**
+ * Orders the rows of a rank 2 integer array lexicographically.
+ */
+class RowComparator
+{
+private:
+    const int * const values;
+    
+    const int rowLength;
+    
+public:
+    RowComparator( const int *_values, int _rowLength ) :
+        values( _values ),
+        rowLength( _rowLength )
+    {
+    }
+    
+    
+    bool operator()( int row1, int row2 ) const
+    {
+        return lexicographical_compare( values + row1 * rowLength, values + ( row1 + 1 ) * rowLength,
+            values + row2 * rowLength, values + ( row2 + 1 ) * rowLength );
+    }
+};
+
+
+ParameterArray::ParameterArray( FmlSessionHandle _session, FmlObjectHandle _source, bool _isInteger ) :
+    references( 1 ),
+    isIndexed( false ),
+    session( _session ),
+    source( _source ),
+    isInteger( _isInteger ),
+    revision( -1 )
+{
+}
+
+
+void ParameterArray::indexRows()
+{
+    if( isIndexed || !isInteger || ( sizes.size() != 2 ) )
+    {
+        return;
+    }
+    
+    sortedRows.resize( sizes[0] );
+    for( int i = 0; i < sizes[0]; i++ )
+    {
+        sortedRows[i] = i;
+    }
+    stable_sort( sortedRows.begin(), sortedRows.end(), RowComparator( intValues.empty() ? NULL : &intValues[0], sizes[1] ) );
+    isIndexed = true;
+}
+
+
+int ParameterArray::findRow( const FmlEnsembleValue *key ) const
+{
+    const int rowLength = sizes[1];
+    int low = 0;
+    int high = sortedRows.size();
+    
+    while( low < high )
+    {
+        const int middle = low + ( high - low ) / 2;
+        const int *row = &intValues[sortedRows[middle] * rowLength];
+        if( lexicographical_compare( row, row + rowLength, key, key + rowLength ) )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    
+    if( low == (int)sortedRows.size() )
+    {
+        return -1;
+    }
+    
+    //Duplicate keys resolve to the first of their rows, as the sort is stable.
+    const int *row = &intValues[sortedRows[low] * rowLength];
+    return equal( row, row + rowLength, key ) ? sortedRows[low] : -1;
+}
+
+//========================================================================
+//
+// ParameterCache
+//
+//========================================================================
+
+bool ParameterCache::Key::operator<( const Key &other ) const
+{
+    if( session != other.session )
+    {
+        return session < other.session;
+    }
+    if( source != other.source )
+    {
+        return source < other.source;
+    }
+    return isInteger < other.isInteger;
+}
+
+
+/**
+ * Reads the whole of the given array data source.
+ */
+static FmlIoErrorNumber readArray( FieldmlIoContext *context, ParameterArray &array )
+{
+    FmlSessionHandle session = context->getSession();
+    
+    if( Fieldml_GetDataSourceType( session, array.source ) != FML_DATA_SOURCE_ARRAY )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    array.revision = Fieldml_GetDataRevision( session, array.source );
+    if( array.revision < 0 )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    int rank = Fieldml_GetArrayDataSourceRank( session, array.source );
+    if( rank <= 0 )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    array.sizes.resize( rank );
+    if( Fieldml_GetArrayDataSourceSizes( session, array.source, &array.sizes[0] ) != FML_ERR_NO_ERROR )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    int total = 1;
+    for( int i = 0; i < rank; i++ )
+    {
+        total *= array.sizes[i];
+    }
+    if( total == 0 )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    string root;
+    char *region_string = Fieldml_GetRegionRoot( session );
+    bool haveRoot = StringUtil::safeString( region_string, root );
+    Fieldml_FreeString( region_string );
+    if( !haveRoot )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    ArrayDataReader *reader = ArrayDataReader::create( FieldmlIoSession::getSession().createContext( session ), root, array.source );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().getLastError();
+    }
+    
+    vector<int> offsets( rank, 0 );
+    FmlIoErrorNumber error;
+    if( array.isInteger )
+    {
+        array.intValues.resize( total );
+        error = reader->readIntSlab( &offsets[0], &array.sizes[0], &array.intValues[0] );
+    }
+    else
+    {
+        array.doubleValues.resize( total );
+        error = reader->readDoubleSlab( &offsets[0], &array.sizes[0], &array.doubleValues[0] );
+    }
+    
+    reader->close();
+    delete reader;
+    
+    return error;
+}
+
+
+/**
+ * Checks that neither the source nor its resource have changed since the array was read.
+ */
+static bool isCurrent( FieldmlIoContext *context, const ParameterArray &array )
+{
+    return Fieldml_GetDataRevision( context->getSession(), array.source ) == array.revision;
+}
+
+
+ParameterCache::~ParameterCache()
+{
+    for( map<Key, ParameterArray *>::iterator i = arrays.begin(); i != arrays.end(); i++ )
+    {
+        release( i->second );
+    }
+}
+
+
+FmlIoErrorNumber ParameterCache::acquire( FieldmlIoContext *context, FmlObjectHandle source, bool isInteger, ParameterArray *&array )
+{
+    Key key;
+    key.session = context->getSession();
+    key.source = source;
+    key.isInteger = isInteger;
+    
+    map<Key, ParameterArray *>::iterator i = arrays.find( key );
+    if( ( i != arrays.end() ) && !isCurrent( context, *i->second ) )
+    {
+        release( i->second );
+        arrays.erase( i );
+        i = arrays.end();
+    }
+    if( i != arrays.end() )
+    {
+        array = i->second;
+        array->references++;
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    array = new ParameterArray( key.session, source, isInteger );
+    FmlIoErrorNumber error = readArray( context, *array );
+    if( error != FML_IOERR_NO_ERROR )
+    {
+        delete array;
+        array = NULL;
+        return error;
+    }
+    
+    arrays[key] = array;
+    array->references++;
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+void ParameterCache::release( ParameterArray *array )
+{
+    array->references--;
+    if( array->references == 0 )
+    {
+        delete array;
+    }
+}
+
+
+void ParameterCache::clear( FmlSessionHandle session )
+{
+    //Session handles are never reused, so the arrays of destroyed sessions can never be found again, and are dropped
+    //here rather than on every lookup.
+    map<Key, ParameterArray *>::iterator i = arrays.begin();
+    while( i != arrays.end() )
+    {
+        const FmlSessionHandle arraySession = i->first.session;
+        if( ( arraySession == session ) || ( Fieldml_GetLastError( arraySession ) == FML_ERR_UNKNOWN_HANDLE ) )
+        {
+            release( i->second );
+            arrays.erase( i++ );
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
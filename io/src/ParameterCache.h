@@ -0,0 +1,139 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_PARAMETER_CACHE
+#define H_PARAMETER_CACHE
+
+#include <map>
+#include <vector>
+
+#include "FieldmlIoContext.h"
+
+/**
+ * The contents of an array data source, read in full. Ensemble-valued data is held as integers, and anything else
+ * as doubles.
+ */
+class ParameterArray
+{
+private:
+    int references;
+    
+    //The rows of a rank 2 integer array in ascending order, for looking up DOK keys.
+    std::vector<int> sortedRows;
+    
+    bool isIndexed;
+    
+    friend class ParameterCache;
+    
+public:
+    const FmlSessionHandle session;
+    
+    const FmlObjectHandle source;
+    
+    const bool isInteger;
+    
+    //The source's data revision when it was read.
+    int revision;
+    
+    std::vector<int> sizes;
+    
+    std::vector<double> doubleValues;
+    
+    std::vector<int> intValues;
+    
+    ParameterArray( FmlSessionHandle _session, FmlObjectHandle _source, bool _isInteger );
+    
+    /**
+     * Sorts the rows of this array, if it is a rank 2 integer array and has not already been sorted, so that
+     * findRow() can be used. Not thread safe.
+     */
+    void indexRows();
+    
+    /**
+     * Returns the row of this array equal to the given key, or -1 if there is none. indexRows() must have been
+     * called first. Rows are found by binary search, so this is thread safe.
+     */
+    int findRow( const FmlEnsembleValue *key ) const;
+};
+
+
+/**
+ * Parameter data for evaluation, shared by all the evaluation plans created in the same session. Each array data
+ * source is read when it is first needed, and read again if its data revision has changed since. Arrays are released
+ * by their users, and kept by the cache until the session's arrays are cleared. The arrays of a destroyed session are
+ * kept until the cache is next cleared, for any session. None of the cache's methods are thread safe.
+ */
+class ParameterCache
+{
+private:
+    class Key
+    {
+    public:
+        FmlSessionHandle session;
+        
+        FmlObjectHandle source;
+        
+        bool isInteger;
+        
+        bool operator<( const Key &other ) const;
+    };
+    
+    std::map<Key, ParameterArray *> arrays;
+    
+public:
+    virtual ~ParameterCache();
+    
+    /**
+     * Returns the contents of the given array data source, reading them if they are not already cached. The caller
+     * must release the array when it is no longer needed.
+     */
+    FmlIoErrorNumber acquire( FieldmlIoContext *context, FmlObjectHandle source, bool isInteger, ParameterArray *&array );
+    
+    void release( ParameterArray *array );
+    
+    /**
+     * Drops all the arrays cached for the given session, so that they are read again when next needed, along with
+     * those of any sessions that have been destroyed. Arrays still in use remain valid until they are released.
+     */
+    void clear( FmlSessionHandle session );
+};
+
+#endif //H_PARAMETER_CACHE
@@ -40,15 +40,23 @@
  */
 
 #include <sstream>
+#include <cstdio>
+#include <sys/stat.h>
 
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
 
 #include "TextArrayDataReader.h"
 #include "InputStream.h"
 
 using namespace std;
 
+//Index at most one outermost row per this many values. Locating a row then costs at most this many skipped values.
+static const int VALUES_PER_INDEX_ENTRY = 1024;
+
+static const char * const ROW_INDEX_MAGIC = "FMLIDX1";
+
 /**
  * A pseudo-lambda class that removes the need to duplicate the slab and slice reading implementations.
  * No point in making this a template class, as we need to use a different method on stream depending on the type,
@@ -82,10 +90,8 @@ public:
     
     void read( int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            buffer[bufferPos++] = stream->readDouble();
-        }
+        stream->readDoubles( buffer + bufferPos, count );
+        bufferPos += count;
     }
 };
 
@@ -102,10 +108,8 @@ public:
     
     void read( int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            buffer[bufferPos++] = stream->readInt();
-        }
+        stream->readInts( buffer + bufferPos, count );
+        bufferPos += count;
     }
 };
 
@@ -133,6 +137,7 @@ public:
 TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source )
 {
     FieldmlInputStream *stream = NULL;
+    string filename;
     
     FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
     string format;
@@ -168,18 +173,12 @@ TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, con
             return NULL;
         }
         Fieldml_FreeString(temp_href);
-        stream = FieldmlInputStream::createTextFileStream( StringUtil::makeFilename( root, href ) );
+        filename = StringUtil::makeFilename( root, href );
+        stream = FieldmlInputStream::createTextFileStream( filename );
     }
     else if( type == FML_DATA_RESOURCE_INLINE )
     {
-        string data;
-        char *temp_inline_data = Fieldml_GetInlineData( context->getSession(), resource );
-        if( !StringUtil::safeString( temp_inline_data, data ) )
-        {
-            return NULL;
-        }
-        Fieldml_FreeString(temp_inline_data);
-        stream = FieldmlInputStream::createStringStream( data );
+        stream = FieldmlInputStream::createInlineDataStream( context->getSession(), resource );
     }
     
     if( stream == NULL )
@@ -187,11 +186,11 @@ TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, con
         return NULL;
     }
     
-    return new TextArrayDataReader( context, stream, source, rank );
+    return new TextArrayDataReader( context, stream, source, rank, filename );
 }
 
 
-TextArrayDataReader::TextArrayDataReader( FieldmlIoContext *_context, FieldmlInputStream *_stream, FmlObjectHandle _source, int rank ) :
+TextArrayDataReader::TextArrayDataReader( FieldmlIoContext *_context, FieldmlInputStream *_stream, FmlObjectHandle _source, int rank, const string filename ) :
     ArrayDataReader( _context ),
     stream( _stream ),
     source( _source ),
@@ -216,6 +215,28 @@ TextArrayDataReader::TextArrayDataReader( FieldmlIoContext *_context, FieldmlInp
     char *temp_string = Fieldml_GetArrayDataSourceLocation( context->getSession(), source );
     StringUtil::safeString( temp_string, sourceLocation );
     Fieldml_FreeString(temp_string);
+    
+    valuesPerRow = 1;
+    for( int i = 1; i < sourceRank; i++ )
+    {
+        valuesPerRow *= sourceRawSizes[i];
+    }
+    
+    rowsPerIndexEntry = ( valuesPerRow > 0 ) ? VALUES_PER_INDEX_ENTRY / valuesPerRow : 1;
+    if( rowsPerIndexEntry < 1 )
+    {
+        rowsPerIndexEntry = 1;
+    }
+    
+    persistedIndexCount = 0;
+    if( ( filename.length() > 0 ) && FieldmlIoSession::getSession().getPersistentTextIndexes() )
+    {
+        dataFilename = filename;
+        //Data sources with different row lengths can share a file and location, but not an index.
+        ostringstream indexName;
+        indexName << filename << "-" << sourceLocation << "-" << valuesPerRow << ".fmlidx";
+        indexFilename = indexName.str();
+    }
 }
 
 
@@ -270,6 +291,143 @@ FmlIoErrorNumber TextArrayDataReader::skipPreamble()
 
     startPos = stream->tell();
     
+    rowIndex.push_back( startPos );
+    loadRowIndex();
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+bool TextArrayDataReader::getDataFileStamp( long &size, long &modified )
+{
+    struct stat info;
+    if( stat( dataFilename.c_str(), &info ) != 0 )
+    {
+        return false;
+    }
+    
+    size = info.st_size;
+    modified = info.st_mtime;
+    return true;
+}
+
+
+/**
+ * The sidecar file is a cache. Anything about it that does not match the data file and this data source's
+ * layout causes it to be ignored.
+ */
+void TextArrayDataReader::loadRowIndex()
+{
+    long size, modified;
+    if( ( indexFilename.length() == 0 ) || !getDataFileStamp( size, modified ) )
+    {
+        return;
+    }
+    
+    FILE *file = fopen( indexFilename.c_str(), "r" );
+    if( file == NULL )
+    {
+        return;
+    }
+    
+    char magic[16];
+    long fileSize, fileModified;
+    int fileValuesPerRow, fileRowsPerIndexEntry, count;
+    if( ( fscanf( file, "%15s %ld %ld %d %d %d", magic, &fileSize, &fileModified, &fileValuesPerRow, &fileRowsPerIndexEntry, &count ) == 6 ) &&
+        ( string( magic ) == ROW_INDEX_MAGIC ) && ( fileSize == size ) && ( fileModified == modified ) &&
+        ( fileValuesPerRow == valuesPerRow ) && ( fileRowsPerIndexEntry == rowsPerIndexEntry ) && ( count > 0 ) )
+    {
+        vector<long> loadedIndex( count );
+        int i;
+        for( i = 0; i < count; i++ )
+        {
+            if( fscanf( file, "%ld", &loadedIndex[i] ) != 1 )
+            {
+                break;
+            }
+        }
+        
+        if( ( i == count ) && ( loadedIndex[0] == startPos ) )
+        {
+            rowIndex.swap( loadedIndex );
+            persistedIndexCount = count;
+        }
+    }
+    
+    fclose( file );
+}
+
+
+void TextArrayDataReader::saveRowIndex()
+{
+    long size, modified;
+    if( ( indexFilename.length() == 0 ) || ( rowIndex.size() <= persistedIndexCount ) || !getDataFileStamp( size, modified ) )
+    {
+        return;
+    }
+    
+    //Failure is harmless; the index will just be rebuilt next time.
+    FILE *file = fopen( indexFilename.c_str(), "w" );
+    if( file == NULL )
+    {
+        return;
+    }
+    
+    fprintf( file, "%s %ld %ld %d %d %d\n", ROW_INDEX_MAGIC, size, modified, valuesPerRow, rowsPerIndexEntry, (int)rowIndex.size() );
+    for( unsigned int i = 0; i < rowIndex.size(); i++ )
+    {
+        fprintf( file, "%ld\n", rowIndex[i] );
+    }
+    
+    fclose( file );
+    persistedIndexCount = rowIndex.size();
+}
+
+
+void TextArrayDataReader::indexRow( int row )
+{
+    if( ( row % rowsPerIndexEntry == 0 ) && ( (unsigned int)( row / rowsPerIndexEntry ) == rowIndex.size() ) )
+    {
+        rowIndex.push_back( stream->tell() );
+    }
+}
+
+
+/**
+ * Positions the stream at the start of the given outermost row, starting from either the nearest indexed row or
+ * the current position, whichever is closer.
+ */
+FmlIoErrorNumber TextArrayDataReader::seekToRow( int row )
+{
+    unsigned int entry = row / rowsPerIndexEntry;
+    if( entry >= rowIndex.size() )
+    {
+        entry = rowIndex.size() - 1;
+    }
+    
+    int currentRow = entry * rowsPerIndexEntry;
+    if( ( nextOutermostOffset >= currentRow ) && ( nextOutermostOffset <= row ) )
+    {
+        currentRow = nextOutermostOffset;
+    }
+    else
+    {
+        stream->seek( rowIndex[entry] );
+    }
+    
+    //If the read fails part-way, the stream position is unknown.
+    nextOutermostOffset = -1;
+    
+    for( ; currentRow < row; currentRow++ )
+    {
+        indexRow( currentRow );
+        stream->skipValues( valuesPerRow );
+        if( stream->eof() )
+        {
+            return context->setError( FML_IOERR_UNEXPECTED_EOF );
+        }
+    }
+    
     return FML_IOERR_NO_ERROR;
 }
 
@@ -288,10 +446,6 @@ bool TextArrayDataReader::applyOffsets( const int *offsets, const int *sizes, in
     if( isHead )
     {
         sliceCount = sourceOffsets[depth] + offsets[depth];
-        if( ( depth == 0 ) && ( nextOutermostOffset >= 0 ) && ( sliceCount >= nextOutermostOffset ) )
-        {
-            sliceCount -= nextOutermostOffset;
-        }
     }
     else
     {
@@ -303,13 +457,7 @@ bool TextArrayDataReader::applyOffsets( const int *offsets, const int *sizes, in
         return true;
     }
     
-    for( int j = 0; j < sliceCount; j++ )
-    {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->readDouble();
-        }
-    }
+    stream->skipValues( sliceCount * count );
     
     return !stream->eof();
 }
@@ -322,11 +470,6 @@ FmlIoErrorNumber TextArrayDataReader::readPreSlab( const int *offsets, const int
         return context->setError( FML_IOERR_INVALID_PARAMETER );
     }
     
-    if( ( nextOutermostOffset >= 0 ) && ( sourceOffsets[0] + offsets[0] >= nextOutermostOffset ) )
-    {
-        return FML_IOERR_NO_ERROR;
-    }
-    
     if( startPos == -1 )
     {
         int err = skipPreamble();
@@ -335,15 +478,12 @@ FmlIoErrorNumber TextArrayDataReader::readPreSlab( const int *offsets, const int
             return err;
         }
     }
-    else
-    {
-        stream->seek( startPos );
-    }
     
-    return FML_IOERR_NO_ERROR;
+    return seekToRow( sourceOffsets[0] + offsets[0] );
 }
 
 
+//NOTE: Only used for depth > 0. The outermost index is handled by readSlab, using the row index.
 FmlIoErrorNumber TextArrayDataReader::readSlice( const int *offsets, const int *sizes, int depth, BufferReader &reader )
 {
     if( !applyOffsets( offsets, sizes, depth, true ) )
@@ -372,16 +512,11 @@ FmlIoErrorNumber TextArrayDataReader::readSlice( const int *offsets, const int *
         }
     }
     
-    if( depth == 0 )
-    {
-        nextOutermostOffset = sourceOffsets[0] + offsets[0] + sizes[0];
-    }
-    else if( !applyOffsets( offsets, sizes, depth, false ) )
+    if( !applyOffsets( offsets, sizes, depth, false ) )
     {
         return context->setError( FML_IOERR_UNEXPECTED_EOF );
     }
     
-    
     return FML_IOERR_NO_ERROR;
 }
 
@@ -394,7 +529,43 @@ FmlIoErrorNumber TextArrayDataReader::readSlab( const int *offsets, const int *s
         return err;
     }
     
-    return readSlice( offsets, sizes, 0, reader );
+    const int firstRow = sourceOffsets[0] + offsets[0];
+    int i = 0;
+    while( i < sizes[0] )
+    {
+        const int row = firstRow + i;
+        indexRow( row );
+        
+        if( sourceRank == 1 )
+        {
+            //Each row is a single value, so read up to the next row that needs indexing in one go.
+            int count = rowsPerIndexEntry - ( row % rowsPerIndexEntry );
+            if( count > sizes[0] - i )
+            {
+                count = sizes[0] - i;
+            }
+            
+            reader.read( count );
+            if( stream->eof() )
+            {
+                return context->setError( FML_IOERR_UNEXPECTED_EOF );
+            }
+            i += count;
+        }
+        else
+        {
+            err = readSlice( offsets, sizes, 1, reader );
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+            i++;
+        }
+    }
+    
+    nextOutermostOffset = firstRow + sizes[0];
+    
+    return FML_IOERR_NO_ERROR;
 }
 
 
@@ -445,6 +616,8 @@ FmlIoErrorNumber TextArrayDataReader::close()
     }
     
     closed = true;
+    
+    saveRowIndex();
 
     return FML_IOERR_NO_ERROR;
 }
@@ -42,6 +42,8 @@
 #ifndef H_TEXT_ARRAY_DATA_READER
 #define H_TEXT_ARRAY_DATA_READER
 
+#include <vector>
+
 #include "FieldmlIoContext.h"
 #include "ArrayDataReader.h"
 #include "InputStream.h"
@@ -72,11 +74,36 @@ private:
     
     //The seek position of the start of the array data. This is a minor optimization to save us from having to line-skip for each read.
     long startPos;
+    
+    //The number of values in each outermost row of the raw array.
+    int valuesPerRow;
+    
+    int rowsPerIndexEntry;
+    
+    //The seek positions of every rowsPerIndexEntry'th outermost row, built up lazily as rows are read or skipped.
+    std::vector<long> rowIndex;
+    
+    //The data file, and the sidecar file the row index is persisted to. Both are empty if the index is not persisted.
+    std::string dataFilename;
+    
+    std::string indexFilename;
+    
+    unsigned int persistedIndexCount;
 
-    TextArrayDataReader( FieldmlIoContext *_context, FieldmlInputStream *_stream, FmlObjectHandle source, int _sourceRank );
+    TextArrayDataReader( FieldmlIoContext *_context, FieldmlInputStream *_stream, FmlObjectHandle source, int _sourceRank, const std::string filename );
     
     bool checkDimensions( const int *offsets, const int *sizes );
     
+    void indexRow( int row );
+    
+    FmlIoErrorNumber seekToRow( int row );
+    
+    bool getDataFileStamp( long &size, long &modified );
+    
+    void loadRowIndex();
+    
+    void saveRowIndex();
+    
     bool applyOffsets( const int *offsets, const int *sizes, int depth, bool isHead );
     
     FmlIoErrorNumber readPreSlab( const int *offsets, const int *sizes );
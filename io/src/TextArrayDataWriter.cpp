@@ -48,47 +48,6 @@
 using namespace std;
 
 
-/**
- * A pseudo-lambda class that sets/appends the result of a text-array writing operation to a string-based FieldML
- * data resource 
- */
-class SetStringResourceTask :
-    public StreamCloseTask
-{
-private:
-    const FmlSessionHandle sessionHandle;
-    const FmlObjectHandle dataResource;
-    const bool append;
-    
-public:
-    SetStringResourceTask( FmlSessionHandle _sessionHandle, FmlObjectHandle _dataResource, bool _append ) :
-        sessionHandle( _sessionHandle ),
-        dataResource( _dataResource ),
-        append( _append )
-    {
-    }
-    
-
-    FmlIoErrorNumber onStreamClose( const std::string &info )
-    {
-        FmlIoErrorNumber err;
-        
-        if( append )
-        {
-            err = Fieldml_AddInlineData( sessionHandle, dataResource, info.c_str(), info.size() );
-        }
-        else
-        {
-            err = Fieldml_SetInlineData( sessionHandle, dataResource, info.c_str(), info.size() );
-        }
-        
-        return err;
-    }
-    
-    
-    virtual ~SetStringResourceTask() {}
-};
-
 /**
  * A pseudo-lambda class that removes the need to duplicate the slab and slice writing implementations.
  * No point in making this a template class, as we need to use a different method on stream depending on the type,
@@ -106,7 +65,7 @@ public:
     
     virtual ~BufferWriter() {}
     
-    virtual void write( int count ) = 0;
+    virtual FmlIoErrorNumber write( int count ) = 0;
 };
 
 
@@ -120,12 +79,12 @@ public:
     DoubleBufferWriter( FieldmlOutputStream *_stream, const double *_buffer ) :
         BufferWriter( _stream ), buffer( _buffer ) {}
     
-    void write( int count )
+    FmlIoErrorNumber write( int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeDouble( buffer[bufferPos++] );
-        }
+        FmlIoErrorNumber err = stream->writeDoubles( buffer + bufferPos, count );
+        bufferPos += count;
+        
+        return err;
     }
 };
 
@@ -140,12 +99,12 @@ public:
     IntBufferWriter( FieldmlOutputStream *_stream, const int *_buffer ) :
         BufferWriter( _stream ), buffer( _buffer ) {}
     
-    void write( int count )
+    FmlIoErrorNumber write( int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeInt( buffer[bufferPos++] );
-        }
+        FmlIoErrorNumber err = stream->writeInts( buffer + bufferPos, count );
+        bufferPos += count;
+        
+        return err;
     }
 };
 
@@ -160,12 +119,12 @@ public:
     BooleanBufferWriter( FieldmlOutputStream *_stream, const FmlBoolean *_buffer ) :
         BufferWriter( _stream ), buffer( _buffer ) {}
     
-    void write( int count )
+    FmlIoErrorNumber write( int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeBoolean( buffer[bufferPos++] );
-        }
+        FmlIoErrorNumber err = stream->writeBooleans( buffer + bufferPos, count );
+        bufferPos += count;
+        
+        return err;
     }
 };
 
@@ -204,9 +163,10 @@ TextArrayDataWriter *TextArrayDataWriter::create( FieldmlIoContext *context, str
 
 TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int _rank ) :
     ArrayDataWriter( _context ),
+    closed( false ),
+    stream( NULL ),
     source( _source ),
-    sourceSizes( NULL ),
-    closed( false )
+    sourceSizes( NULL )
 {
     offset = 0;
     
@@ -242,8 +202,7 @@ TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const stri
     }
     else if( type == FML_DATA_RESOURCE_INLINE )
     {
-        StreamCloseTask *task = new SetStringResourceTask( context->getSession(), resource, append );
-        stream = FieldmlOutputStream::createStringStream( task );
+        stream = FieldmlOutputStream::createInlineDataStream( context->getSession(), resource, append );
     }
     
     if( stream != NULL )
@@ -257,8 +216,7 @@ FmlIoErrorNumber TextArrayDataWriter::writeSlice( const int *sizes, const int de
 {
     if( depth == sourceRank - 1 )
     {
-        writer.write( sizes[depth] );
-        return FML_IOERR_NO_ERROR;
+        return writer.write( sizes[depth] );
     }
     
     int err;
@@ -345,6 +303,19 @@ FmlIoErrorNumber TextArrayDataWriter::writeBooleanSlab( const int *offsets, cons
 }
 
 
+FmlIoErrorNumber TextArrayDataWriter::setPrecision( int significantDigits )
+{
+    if( closed )
+    {
+        return context->setError( FML_IOERR_RESOURCE_CLOSED );
+    }
+    
+    stream->setPrecision( significantDigits );
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
 FmlIoErrorNumber TextArrayDataWriter::close()
 {
     if( closed )
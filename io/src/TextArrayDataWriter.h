@@ -78,6 +78,8 @@ public:
     
     virtual FmlIoErrorNumber writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer );
     
+    virtual FmlIoErrorNumber setPrecision( int significantDigits );
+    
     virtual FmlIoErrorNumber close();
     
     virtual ~TextArrayDataWriter();
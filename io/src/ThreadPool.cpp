@@ -0,0 +1,366 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//========================================================================
+//
+// Mutex
+//
+//========================================================================
+
+#ifdef WIN32
+
+Mutex::Mutex()
+{
+    InitializeCriticalSection( &criticalSection );
+}
+
+
+Mutex::~Mutex()
+{
+    DeleteCriticalSection( &criticalSection );
+}
+
+
+void Mutex::lock()
+{
+    EnterCriticalSection( &criticalSection );
+}
+
+
+void Mutex::unlock()
+{
+    LeaveCriticalSection( &criticalSection );
+}
+
+#else
+
+Mutex::Mutex()
+{
+    pthread_mutex_init( &mutex, NULL );
+}
+
+
+Mutex::~Mutex()
+{
+    pthread_mutex_destroy( &mutex );
+}
+
+
+void Mutex::lock()
+{
+    pthread_mutex_lock( &mutex );
+}
+
+
+void Mutex::unlock()
+{
+    pthread_mutex_unlock( &mutex );
+}
+
+#endif //WIN32
+
+
+MutexLock::MutexLock( Mutex &_mutex ) :
+    mutex( _mutex )
+{
+    mutex.lock();
+}
+
+
+MutexLock::~MutexLock()
+{
+    mutex.unlock();
+}
+
+//========================================================================
+//
+// Condition
+//
+//========================================================================
+
+#ifdef WIN32
+
+Condition::Condition()
+{
+    InitializeConditionVariable( &condition );
+}
+
+
+Condition::~Condition()
+{
+}
+
+
+void Condition::wait( Mutex &mutex )
+{
+    SleepConditionVariableCS( &condition, &mutex.criticalSection, INFINITE );
+}
+
+
+void Condition::signalAll()
+{
+    WakeAllConditionVariable( &condition );
+}
+
+#else
+
+Condition::Condition()
+{
+    pthread_cond_init( &condition, NULL );
+}
+
+
+Condition::~Condition()
+{
+    pthread_cond_destroy( &condition );
+}
+
+
+void Condition::wait( Mutex &mutex )
+{
+    pthread_cond_wait( &condition, &mutex.mutex );
+}
+
+
+void Condition::signalAll()
+{
+    pthread_cond_broadcast( &condition );
+}
+
+#endif //WIN32
+
+//========================================================================
+//
+// ThreadPoolWorker
+//
+//========================================================================
+
+class ThreadPoolWorker
+{
+public:
+    ThreadPool * const pool;
+    
+    //The worker's thread index is one more than its position in the pool, as the calling thread is index 0.
+    const int threadIndex;
+    
+    //The last task generation this worker has seen.
+    int generation;
+    
+#ifdef WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+    
+    ThreadPoolWorker( ThreadPool *_pool, int _threadIndex, int _generation ) :
+        pool( _pool ),
+        threadIndex( _threadIndex ),
+        generation( _generation )
+    {
+    }
+    
+    
+#ifdef WIN32
+    static DWORD WINAPI threadMain( LPVOID parameter )
+    {
+        ThreadPoolWorker *worker = (ThreadPoolWorker *)parameter;
+        worker->pool->workerMain( worker );
+        return 0;
+    }
+#else
+    static void *threadMain( void *parameter )
+    {
+        ThreadPoolWorker *worker = (ThreadPoolWorker *)parameter;
+        worker->pool->workerMain( worker );
+        return NULL;
+    }
+#endif
+    
+    
+    bool start()
+    {
+#ifdef WIN32
+        thread = CreateThread( NULL, 0, threadMain, this, 0, NULL );
+        return thread != NULL;
+#else
+        return pthread_create( &thread, NULL, threadMain, this ) == 0;
+#endif
+    }
+    
+    
+    void join()
+    {
+#ifdef WIN32
+        WaitForSingleObject( thread, INFINITE );
+        CloseHandle( thread );
+#else
+        pthread_join( thread, NULL );
+#endif
+    }
+};
+
+//========================================================================
+//
+// ThreadPool
+//
+//========================================================================
+
+ThreadPool::ThreadPool() :
+    task( NULL ),
+    taskThreadCount( 0 ),
+    taskGeneration( 0 ),
+    runningCount( 0 ),
+    stopping( false )
+{
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    stateMutex.lock();
+    stopping = true;
+    startCondition.signalAll();
+    stateMutex.unlock();
+    
+    for( vector<ThreadPoolWorker *>::iterator i = workers.begin(); i != workers.end(); i++ )
+    {
+        (*i)->join();
+        delete *i;
+    }
+}
+
+
+void ThreadPool::workerMain( ThreadPoolWorker *worker )
+{
+    MutexLock lock( stateMutex );
+    
+    while( true )
+    {
+        while( ( worker->generation == taskGeneration ) && !stopping )
+        {
+            startCondition.wait( stateMutex );
+        }
+        if( stopping )
+        {
+            return;
+        }
+        
+        worker->generation = taskGeneration;
+        if( worker->threadIndex >= taskThreadCount )
+        {
+            continue;
+        }
+        
+        ThreadTask *currentTask = task;
+        const int threadCount = taskThreadCount;
+        stateMutex.unlock();
+        currentTask->execute( worker->threadIndex, threadCount );
+        stateMutex.lock();
+        
+        runningCount--;
+        if( runningCount == 0 )
+        {
+            finishCondition.signalAll();
+        }
+    }
+}
+
+
+void ThreadPool::run( ThreadTask &_task, int threadCount )
+{
+    MutexLock runLock( runMutex );
+    
+    //Only the calling thread is needed if no more threads can be started.
+    while( (int)workers.size() < threadCount - 1 )
+    {
+        ThreadPoolWorker *worker = new ThreadPoolWorker( this, workers.size() + 1, taskGeneration );
+        if( !worker->start() )
+        {
+            delete worker;
+            break;
+        }
+        workers.push_back( worker );
+    }
+    if( threadCount > (int)workers.size() + 1 )
+    {
+        threadCount = workers.size() + 1;
+    }
+    
+    stateMutex.lock();
+    task = &_task;
+    taskThreadCount = threadCount;
+    runningCount = threadCount - 1;
+    taskGeneration++;
+    startCondition.signalAll();
+    stateMutex.unlock();
+    
+    _task.execute( 0, threadCount );
+    
+    stateMutex.lock();
+    while( runningCount > 0 )
+    {
+        finishCondition.wait( stateMutex );
+    }
+    task = NULL;
+    stateMutex.unlock();
+}
+
+
+int ThreadPool::getProcessorCount()
+{
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    int count = info.dwNumberOfProcessors;
+#else
+    int count = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+    
+    return ( count < 1 ) ? 1 : count;
+}
@@ -0,0 +1,192 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_THREAD_POOL
+#define H_THREAD_POOL
+
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+class Mutex
+{
+private:
+#ifdef WIN32
+    CRITICAL_SECTION criticalSection;
+#else
+    pthread_mutex_t mutex;
+#endif
+
+    Mutex( const Mutex & );
+    
+    Mutex &operator=( const Mutex & );
+    
+    friend class Condition;
+    
+public:
+    Mutex();
+    
+    virtual ~Mutex();
+    
+    void lock();
+    
+    void unlock();
+};
+
+
+/**
+ * Holds a mutex locked for the lifetime of the lock object.
+ */
+class MutexLock
+{
+private:
+    Mutex &mutex;
+    
+    MutexLock( const MutexLock & );
+    
+    MutexLock &operator=( const MutexLock & );
+    
+public:
+    MutexLock( Mutex &_mutex );
+    
+    virtual ~MutexLock();
+};
+
+
+class Condition
+{
+private:
+#ifdef WIN32
+    CONDITION_VARIABLE condition;
+#else
+    pthread_cond_t condition;
+#endif
+
+    Condition( const Condition & );
+    
+    Condition &operator=( const Condition & );
+    
+public:
+    Condition();
+    
+    virtual ~Condition();
+    
+    /**
+     * Waits until signalled. The given mutex must be locked, and is locked again when this returns.
+     */
+    void wait( Mutex &mutex );
+    
+    void signalAll();
+};
+
+
+/**
+ * A task run on several threads at once by a thread pool.
+ */
+class ThreadTask
+{
+public:
+    virtual void execute( int threadIndex, int threadCount ) = 0;
+    
+    virtual ~ThreadTask() {}
+};
+
+
+class ThreadPoolWorker;
+
+/**
+ * A set of worker threads, created as they are first needed and kept until the pool is destroyed.
+ */
+class ThreadPool
+{
+private:
+    std::vector<ThreadPoolWorker *> workers;
+    
+    //Held while a task is running, so that tasks submitted from several threads take turns.
+    Mutex runMutex;
+    
+    Mutex stateMutex;
+    
+    Condition startCondition;
+    
+    Condition finishCondition;
+    
+    ThreadTask *task;
+    
+    int taskThreadCount;
+    
+    int taskGeneration;
+    
+    int runningCount;
+    
+    bool stopping;
+    
+    ThreadPool( const ThreadPool & );
+    
+    ThreadPool &operator=( const ThreadPool & );
+    
+    void workerMain( ThreadPoolWorker *worker );
+    
+    friend class ThreadPoolWorker;
+    
+public:
+    ThreadPool();
+    
+    virtual ~ThreadPool();
+    
+    /**
+     * Runs the given task on threadCount threads, one of which is the calling thread, and returns once all of them
+     * have finished. Each thread is given a different index, from 0 to threadCount - 1. If another thread is already
+     * running a task, this waits for it to finish first.
+     */
+    void run( ThreadTask &task, int threadCount );
+    
+    /**
+     * Returns the number of processors available to run threads on.
+     */
+    static int getProcessorCount();
+};
+
+#endif //H_THREAD_POOL
@@ -97,6 +97,100 @@ SIMPLE_TEST( FieldmlDataTextArrayCreateTest )
 }
 
 
+/**
+ * Ensure that inline data can be built up piecewise, viewed in place, and written to by array writers.
+ */
+SIMPLE_TEST( FieldmlDataInlineBufferTest )
+{
+    char strbuf[8];
+
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    int length = -1;
+    const char *view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( 0, length );
+    SIMPLE_ASSERT_EQUALS( string( "" ), string( view ) );
+    
+    string expected;
+    for( int i = 0; i < 1000; i++ )
+    {
+        int err = Fieldml_AddInlineData( session, resource, "0123456789", 10 );
+        SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+        expected += "0123456789";
+    }
+    
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( 10000, length );
+    SIMPLE_ASSERT_EQUALS( 10000, Fieldml_GetInlineDataLength( session, resource ) );
+    SIMPLE_ASSERT_EQUALS( expected, string( view ) );
+    
+    length = Fieldml_CopyInlineData( session, resource, strbuf, 8, 9995 );
+    SIMPLE_ASSERT_EQUALS( 5, length );
+    SIMPLE_ASSERT_EQUALS( "56789", strbuf );
+    SIMPLE_ASSERT_EQUALS( 0, Fieldml_CopyInlineData( session, resource, strbuf, 8, 10000 ) );
+    
+    //Data taken from the view may be passed back in, even though the storage moves as it grows.
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, Fieldml_AddInlineData( session, resource, view, length ) );
+    SIMPLE_ASSERT_EQUALS( 20000, Fieldml_GetInlineDataLength( session, resource ) );
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( expected + expected, string( view ) );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, Fieldml_SetInlineData( session, resource, view + 5, 3 ) );
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( string( "567" ), string( view ) );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    int sizes[1] = { 3 };
+    int offsets[1] = { 0 };
+    int values[3] = { 1, 2, 3 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    
+    //Without append, the writer replaces the existing data.
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_WriteIntSlab( writer, offsets, sizes, values ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_CloseWriter( writer ) );
+    
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    string written( view, length );
+    SIMPLE_ASSERT( written.find( '0' ) == string::npos );
+    SIMPLE_ASSERT( written.find( '3' ) != string::npos );
+    
+    //Readers parse the resource's storage in place.
+    int readValues[3] = { -1, -1, -1 };
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_ReadIntSlab( reader, offsets, sizes, readValues ) );
+    
+    //The resource cannot change under an open reader.
+    SIMPLE_ASSERT_EQUALS( FML_ERR_ACCESS_VIOLATION, Fieldml_AddInlineData( session, resource, "4", 1 ) );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_ACCESS_VIOLATION, Fieldml_SetInlineData( session, resource, "4", 1 ) );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE == Fieldml_OpenArrayWriter( session, source, realType, 1, sizes, 1 ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_CloseReader( reader ) );
+    SIMPLE_ASSERT_EQUALS( written.length(), Fieldml_GetInlineDataLength( session, resource ) );
+    SIMPLE_ASSERT_EQUALS( 1, readValues[0] );
+    SIMPLE_ASSERT_EQUALS( 3, readValues[2] );
+    
+    writer = Fieldml_OpenArrayWriter( session, source, realType, 1, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_WriteIntSlab( writer, offsets, sizes, values ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_CloseWriter( writer ) );
+    
+    view = Fieldml_GetInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT_EQUALS( (int)written.length() * 2, length );
+    SIMPLE_ASSERT_EQUALS( written + written, string( view ) );
+    
+    FmlObjectHandle hrefResource = Fieldml_CreateHrefDataResource( session, "test.href", "PLAIN_TEXT", "foo.txt" );
+    SIMPLE_ASSERT( NULL == Fieldml_GetInlineDataView( session, hrefResource, &length ) );
+    
+    Fieldml_Destroy( session );
+}
+
+
 /**
  * Ensure that various kinds of reads work with arrays based on inline text resources.
  */
@@ -176,6 +270,160 @@ SIMPLE_TEST( FieldmlDataArrayReadTest )
 }
 
 
+/**
+ * Ensure that slabs can be read from text arrays in any order.
+ */
+SIMPLE_TEST( FieldmlDataArrayRandomAccessTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    
+    const int valueCount = 5000;
+    stringstream rawStream;
+    for( int i = 0; i < valueCount; i++ )
+    {
+        rawStream << i << ( ( i % 10 == 9 ) ? "\n" : " " );
+    }
+    const string rawData = rawStream.str();
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    int sizes[1] = { valueCount };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    
+    FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    int buffer[100];
+    const int readOffsets[] = { 4900, 10, 3000, 2999, 0, 4000, 1024, 1023 };
+    for( unsigned int i = 0; i < sizeof( readOffsets ) / sizeof( int ); i++ )
+    {
+        int readSizes[1] = { 100 };
+        err = Fieldml_ReadIntSlab( reader, &readOffsets[i], readSizes, buffer );
+        SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( readOffsets[i], buffer[0] );
+        SIMPLE_ASSERT_EQUALS( readOffsets[i] + 99, buffer[99] );
+    }
+    
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that doubles written to text arrays read back exactly, and that the writer's precision can be limited.
+ */
+SIMPLE_TEST( FieldmlDataArrayWritePrecisionTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    
+    const int valueCount = 8;
+    int sizes[1] = { valueCount };
+    int offsets[1] = { 0 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    const double values[valueCount] = { 0.1, -2.5, 1.0 / 3.0, 1e-7, 1e300, 123456789, 0, 4.9406564584124654e-324 };
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    err = Fieldml_CloseWriter( writer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    char *text = Fieldml_GetInlineData( session, resource );
+    SIMPLE_ASSERT_EQUALS( "0.1 -2.5 0.3333333333333333 1e-07 1e+300 123456789 0 5e-324 \n", text );
+    Fieldml_FreeString( text );
+    
+    double buffer[valueCount];
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    for( int i = 0; i < valueCount; i++ )
+    {
+        SIMPLE_ASSERT( values[i] == buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_SetWriterPrecision( writer, FML_MAX_WRITER_PRECISION + 1 );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    err = Fieldml_SetWriterPrecision( writer, 4 );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    text = Fieldml_GetInlineData( session, resource );
+    SIMPLE_ASSERT_EQUALS( "0.1 -2.5 0.3333 1e-07 1e+300 1.235e+08 0 4.941e-324 \n", text );
+    Fieldml_FreeString( text );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that element evaluators can be assigned in bulk from array data sources.
+ */
+SIMPLE_TEST( FieldmlDataArraySetEvaluatorsTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle type = Fieldml_CreateContinuousType( session, "test.type" );
+    FmlObjectHandle evaluators[2];
+    evaluators[0] = Fieldml_CreateExternalEvaluator( session, "test.external1", type );
+    evaluators[1] = Fieldml_CreateExternalEvaluator( session, "test.external2", type );
+    FmlObjectHandle piece = Fieldml_CreatePiecewiseEvaluator( session, "test.piecewise", type );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    const string rawData = "1 1 1 2 2 0 1\n4 1\n9 2\n";
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    FmlObjectHandle denseSource = Fieldml_CreateArrayDataSource( session, "test.dense_source", resource, "1", 1 );
+    int denseSizes[1] = { 7 };
+    Fieldml_SetArrayDataSourceRawSizes( session, denseSource, denseSizes );
+    
+    err = Fieldml_SetEvaluatorsFromSource( session, piece, denseSource, 2, evaluators );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 6, Fieldml_GetEvaluatorCount( session, piece ) );
+    SIMPLE_ASSERT_EQUALS( 3, Fieldml_GetEvaluatorRangeCount( session, piece ) );
+    SIMPLE_ASSERT_EQUALS( evaluators[1], Fieldml_GetElementEvaluator( session, piece, 5, 0 ) );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_GetElementEvaluator( session, piece, 6, 0 ) );
+    
+    FmlObjectHandle pairSource = Fieldml_CreateArrayDataSource( session, "test.pair_source", resource, "2", 2 );
+    int pairSizes[2] = { 2, 2 };
+    Fieldml_SetArrayDataSourceRawSizes( session, pairSource, pairSizes );
+    
+    err = Fieldml_SetEvaluatorsFromSource( session, piece, pairSource, 2, evaluators );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 7, Fieldml_GetEvaluatorCount( session, piece ) );
+    SIMPLE_ASSERT_EQUALS( evaluators[0], Fieldml_GetElementEvaluator( session, piece, 4, 0 ) );
+    SIMPLE_ASSERT_EQUALS( evaluators[1], Fieldml_GetElementEvaluator( session, piece, 9, 0 ) );
+    
+    err = Fieldml_SetEvaluatorsFromSource( session, piece, pairSource, 1, evaluators );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    
+    Fieldml_Destroy( session );
+}
+
+
 /**
  * Ensure that newly created HDF5 data sources have the correct state.
  */
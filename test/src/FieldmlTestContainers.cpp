@@ -0,0 +1,372 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <set>
+
+#include "SimpleBitset.h"
+#include "SimpleMap.h"
+
+#include "SimpleTest.h"
+
+using namespace std;
+
+/**
+ * Ensure that bits can be set and cleared, including ones far apart.
+ */
+SIMPLE_TEST( SimpleBitsetSetTest )
+{
+    SimpleBitset bits;
+
+    SIMPLE_ASSERT_EQUALS( 0, bits.getCount() );
+    SIMPLE_ASSERT( !bits.getBit( 0 ) );
+    SIMPLE_ASSERT( !bits.getBit( -1 ) );
+
+    bits.setBit( 0, true );
+    bits.setBit( 255, true );
+    bits.setBit( 256, true );
+    bits.setBit( 100000, true );
+    bits.setBit( -5, true );
+    SIMPLE_ASSERT_EQUALS( 4, bits.getCount() );
+    SIMPLE_ASSERT( bits.getBit( 0 ) );
+    SIMPLE_ASSERT( bits.getBit( 255 ) );
+    SIMPLE_ASSERT( bits.getBit( 256 ) );
+    SIMPLE_ASSERT( bits.getBit( 100000 ) );
+    SIMPLE_ASSERT( !bits.getBit( 99999 ) );
+    SIMPLE_ASSERT( !bits.getBit( -5 ) );
+
+    //Setting a bit twice, or clearing one that was never set, changes nothing.
+    bits.setBit( 255, true );
+    bits.setBit( 1000000, false );
+    SIMPLE_ASSERT_EQUALS( 4, bits.getCount() );
+
+    bits.setBit( 255, false );
+    SIMPLE_ASSERT_EQUALS( 3, bits.getCount() );
+    SIMPLE_ASSERT( !bits.getBit( 255 ) );
+
+    bits.clear();
+    SIMPLE_ASSERT_EQUALS( 0, bits.getCount() );
+    SIMPLE_ASSERT( !bits.getBit( 0 ) );
+    SIMPLE_ASSERT( !bits.getBit( 100000 ) );
+}
+
+
+/**
+ * Ensure that ranks count the true bits before a bit, across chunks.
+ */
+SIMPLE_TEST( SimpleBitsetRankTest )
+{
+    SimpleBitset bits;
+
+    SIMPLE_ASSERT_EQUALS( 0, bits.getRank( 10 ) );
+
+    bits.setBit( 3, true );
+    bits.setBit( 31, true );
+    bits.setBit( 32, true );
+    bits.setBit( 300, true );
+    bits.setBit( 1000, true );
+
+    SIMPLE_ASSERT_EQUALS( 0, bits.getRank( -1 ) );
+    SIMPLE_ASSERT_EQUALS( 0, bits.getRank( 0 ) );
+    SIMPLE_ASSERT_EQUALS( 0, bits.getRank( 3 ) );
+    SIMPLE_ASSERT_EQUALS( 1, bits.getRank( 4 ) );
+    SIMPLE_ASSERT_EQUALS( 1, bits.getRank( 31 ) );
+    SIMPLE_ASSERT_EQUALS( 2, bits.getRank( 32 ) );
+    SIMPLE_ASSERT_EQUALS( 3, bits.getRank( 33 ) );
+    SIMPLE_ASSERT_EQUALS( 3, bits.getRank( 300 ) );
+    SIMPLE_ASSERT_EQUALS( 4, bits.getRank( 301 ) );
+    SIMPLE_ASSERT_EQUALS( 4, bits.getRank( 1000 ) );
+    SIMPLE_ASSERT_EQUALS( 5, bits.getRank( 1001 ) );
+    SIMPLE_ASSERT_EQUALS( 5, bits.getRank( 1000000 ) );
+
+    //Ranks must follow changes made after they were last asked for.
+    bits.setBit( 31, false );
+    bits.setBit( 500, true );
+    SIMPLE_ASSERT_EQUALS( 2, bits.getRank( 300 ) );
+    SIMPLE_ASSERT_EQUALS( 4, bits.getRank( 1000 ) );
+}
+
+
+/**
+ * Ensure that the n'th true bit can be found, across chunks.
+ */
+SIMPLE_TEST( SimpleBitsetTrueBitTest )
+{
+    SimpleBitset bits;
+
+    SIMPLE_ASSERT_EQUALS( -1, bits.getTrueBit( 1 ) );
+
+    bits.setBit( 7, true );
+    bits.setBit( 255, true );
+    bits.setBit( 256, true );
+    bits.setBit( 70000, true );
+
+    SIMPLE_ASSERT_EQUALS( -1, bits.getTrueBit( 0 ) );
+    SIMPLE_ASSERT_EQUALS( 7, bits.getTrueBit( 1 ) );
+    SIMPLE_ASSERT_EQUALS( 255, bits.getTrueBit( 2 ) );
+    SIMPLE_ASSERT_EQUALS( 256, bits.getTrueBit( 3 ) );
+    SIMPLE_ASSERT_EQUALS( 70000, bits.getTrueBit( 4 ) );
+    SIMPLE_ASSERT_EQUALS( -1, bits.getTrueBit( 5 ) );
+
+    bits.setBit( 255, false );
+    SIMPLE_ASSERT_EQUALS( 256, bits.getTrueBit( 2 ) );
+    SIMPLE_ASSERT_EQUALS( -1, bits.getTrueBit( 4 ) );
+}
+
+
+/**
+ * Ensure that the next true bit is found past chunks that have no true bits. Searching from an emptied chunk used
+ * to loop forever.
+ */
+SIMPLE_TEST( SimpleBitsetNextTrueBitTest )
+{
+    SimpleBitset bits;
+
+    SIMPLE_ASSERT_EQUALS( -1, bits.getNextTrueBit( 0 ) );
+
+    bits.setBit( 10, true );
+    bits.setBit( 300, true );
+    bits.setBit( 600, true );
+    bits.setBit( 1200, true );
+
+    //Chunks 1 and 2 are allocated, but no longer have any true bits.
+    bits.setBit( 300, false );
+    bits.setBit( 600, false );
+
+    SIMPLE_ASSERT_EQUALS( 10, bits.getNextTrueBit( -3 ) );
+    SIMPLE_ASSERT_EQUALS( 10, bits.getNextTrueBit( 10 ) );
+    SIMPLE_ASSERT_EQUALS( 1200, bits.getNextTrueBit( 11 ) );
+    SIMPLE_ASSERT_EQUALS( 1200, bits.getNextTrueBit( 300 ) );
+    SIMPLE_ASSERT_EQUALS( 1200, bits.getNextTrueBit( 700 ) );
+    SIMPLE_ASSERT_EQUALS( 1200, bits.getNextTrueBit( 1200 ) );
+    SIMPLE_ASSERT_EQUALS( -1, bits.getNextTrueBit( 1201 ) );
+    SIMPLE_ASSERT_EQUALS( -1, bits.getNextTrueBit( 100000 ) );
+}
+
+
+/**
+ * Ensure that random changes give the same answers as a std::set holding the same bits.
+ */
+SIMPLE_TEST( SimpleBitsetRandomTest )
+{
+    srand( 7 );
+
+    SimpleBitset bits;
+    set<int> expected;
+
+    const int RANGE = 3000;
+    for( int i = 0; i < 2000; i++ )
+    {
+        int bit = rand() % RANGE;
+        bool state = ( rand() % 3 ) != 0;
+        bits.setBit( bit, state );
+        if( state )
+        {
+            expected.insert( bit );
+        }
+        else
+        {
+            expected.erase( bit );
+        }
+
+        if( ( i % 50 ) != 0 )
+        {
+            continue;
+        }
+
+        SIMPLE_ASSERT_EQUALS( (int)expected.size(), bits.getCount() );
+
+        int query = rand() % RANGE;
+        int rank = distance( expected.begin(), expected.lower_bound( query ) );
+        SIMPLE_ASSERT_EQUALS( rank, bits.getRank( query ) );
+
+        set<int>::const_iterator next = expected.lower_bound( query );
+        SIMPLE_ASSERT_EQUALS( ( next == expected.end() ) ? -1 : *next, bits.getNextTrueBit( query ) );
+
+        if( !expected.empty() )
+        {
+            set<int>::const_iterator nth = expected.begin();
+            advance( nth, rand() % expected.size() );
+            SIMPLE_ASSERT_EQUALS( *nth, bits.getTrueBit( (int)distance( expected.begin(), nth ) + 1 ) );
+        }
+    }
+}
+
+
+/**
+ * Ensure that a map with widely spread keys finds, replaces and removes them, keeping insertion order.
+ */
+SIMPLE_TEST( SimpleMapSparseTest )
+{
+    SimpleMap<int, int> map( -1 );
+
+    for( int i = 0; i < 20; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( -1, map.set( ( i * 100000 ) - 500000, i ) );
+    }
+    SIMPLE_ASSERT_EQUALS( 20, map.size() );
+
+    for( int i = 0; i < 20; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i, map.get( ( i * 100000 ) - 500000, false ) );
+    }
+    SIMPLE_ASSERT_EQUALS( -1, map.get( 1, false ) );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( -500001, false ) );
+    SIMPLE_ASSERT_EQUALS( -200000, map.getKey( 3 ) );
+
+    SIMPLE_ASSERT_EQUALS( 3, map.set( -200000, 33 ) );
+    SIMPLE_ASSERT_EQUALS( 33, map.get( -200000, false ) );
+
+    //Setting the invalid value removes the key, and later keys move up.
+    map.set( -200000, -1 );
+    SIMPLE_ASSERT_EQUALS( 19, map.size() );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( -200000, false ) );
+    SIMPLE_ASSERT_EQUALS( -100000, map.getKey( 3 ) );
+    SIMPLE_ASSERT_EQUALS( 19, map.get( 1400000, false ) );
+
+    map.setDefault( 7 );
+    SIMPLE_ASSERT_EQUALS( 7, map.get( 1, true ) );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( 1, false ) );
+    SIMPLE_ASSERT_EQUALS( 19, map.get( 1400000, true ) );
+}
+
+
+/**
+ * Ensure that a map with contiguous keys finds them when they are added in ascending and descending order.
+ */
+SIMPLE_TEST( SimpleMapDenseTest )
+{
+    SimpleMap<int, int> map( -1 );
+
+    for( int key = 0; key < 100; key++ )
+    {
+        map.set( key, ( key * 2 ) + 1000 );
+    }
+    for( int key = -1; key >= -100; key-- )
+    {
+        map.set( key, ( key * 2 ) + 1000 );
+    }
+    SIMPLE_ASSERT_EQUALS( 200, map.size() );
+
+    for( int key = -100; key < 100; key++ )
+    {
+        SIMPLE_ASSERT_EQUALS( ( key * 2 ) + 1000, map.get( key, false ) );
+    }
+    SIMPLE_ASSERT_EQUALS( -1, map.get( -101, false ) );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( 100, false ) );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( -1000, false ) );
+
+    map.set( 50, -1 );
+    SIMPLE_ASSERT_EQUALS( -1, map.get( 50, false ) );
+    SIMPLE_ASSERT_EQUALS( 1102, map.get( 51, false ) );
+    SIMPLE_ASSERT_EQUALS( 1098, map.get( 49, false ) );
+    map.set( 50, 5 );
+    SIMPLE_ASSERT_EQUALS( 5, map.get( 50, false ) );
+
+    //A long descending run, as a mesh numbered backwards gives.
+    SimpleMap<int, int> descending( -1 );
+    const int COUNT = 100000;
+    for( int key = COUNT; key > 0; key-- )
+    {
+        descending.set( key, COUNT - key );
+    }
+    SIMPLE_ASSERT_EQUALS( COUNT, descending.size() );
+    SIMPLE_ASSERT_EQUALS( 0, descending.get( COUNT, false ) );
+    SIMPLE_ASSERT_EQUALS( COUNT - 1, descending.get( 1, false ) );
+    SIMPLE_ASSERT_EQUALS( COUNT / 2, descending.get( COUNT / 2, false ) );
+    SIMPLE_ASSERT_EQUALS( -1, descending.get( 0, false ) );
+}
+
+
+/**
+ * Ensure that random changes give the same answers as a std::map, for key spreads that make the map switch between
+ * its dense and sparse layouts.
+ */
+SIMPLE_TEST( SimpleMapRandomTest )
+{
+    srand( 11 );
+
+    const int spreads[] = { 16, 300, 100000 };
+    for( int s = 0; s < 3; s++ )
+    {
+        SimpleMap<int, int> map( -1 );
+        std::map<int, int> expected;
+
+        for( int i = 0; i < 3000; i++ )
+        {
+            int key = ( rand() % spreads[s] ) - ( spreads[s] / 2 );
+            int value = ( rand() % 4 == 0 ) ? -1 : rand() % 1000;
+            map.set( key, value );
+            if( value == -1 )
+            {
+                expected.erase( key );
+            }
+            else
+            {
+                expected[key] = value;
+            }
+
+            //Occasionally add a key far from the others, which forces the sparse layout.
+            if( i == 1500 )
+            {
+                map.set( 10000000, 1 );
+                expected[10000000] = 1;
+            }
+
+            if( ( i % 30 ) != 0 )
+            {
+                continue;
+            }
+
+            SIMPLE_ASSERT_EQUALS( (int)expected.size(), map.size() );
+
+            int query = ( rand() % spreads[s] ) - ( spreads[s] / 2 );
+            std::map<int, int>::const_iterator found = expected.find( query );
+            SIMPLE_ASSERT_EQUALS( ( found == expected.end() ) ? -1 : found->second, map.get( query, false ) );
+        }
+
+        for( std::map<int, int>::const_iterator i = expected.begin(); i != expected.end(); i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( i->second, map.get( i->first, false ) );
+        }
+    }
+}
@@ -0,0 +1,845 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "fieldml_api.h"
+#include "FieldmlIoApi.h"
+
+#include "SimpleTest.h"
+
+using namespace std;
+
+static const double TOLERANCE = 1e-12;
+
+
+static FmlObjectHandle createArrayData( FmlSessionHandle session, const char *name, FmlObjectHandle typeHandle, int rank, int *sizes, const double *doubleValues, const int *intValues )
+{
+    string resourceName = string( name ) + ".resource";
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, resourceName.c_str() );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, name, resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    int offsets[2] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, typeHandle, 0, sizes, rank );
+    if( doubleValues != NULL )
+    {
+        Fieldml_WriteDoubleSlab( writer, offsets, sizes, doubleValues );
+    }
+    else
+    {
+        Fieldml_WriteIntSlab( writer, offsets, sizes, intValues );
+    }
+    Fieldml_CloseWriter( writer );
+    
+    return source;
+}
+
+
+//The nodes of the trilinear test mesh lie on a 3x2x2 grid, mapped into space by an affine function, which
+//trilinear interpolation reproduces exactly.
+static void gridPosition( double i, double j, double k, double *x )
+{
+    x[0] = 2.0 * i + j;
+    x[1] = 3.0 * j;
+    x[2] = k + 0.5 * i;
+}
+
+
+/**
+ * Builds a two element trilinear mesh in the usual form: nodal coordinates gathered through a connectivity
+ * parameter by an aggregate over the interpolator's parameters, and an aggregate over the coordinate components.
+ */
+static FmlObjectHandle createTrilinearMesh( FmlSessionHandle session )
+{
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    FmlObjectHandle chartArgument = Fieldml_AddImport( session, importHandle, "chart.3d.argument", "chart.3d.argument" );
+    FmlObjectHandle pointsArgument = Fieldml_AddImport( session, importHandle, "trilinear.points.argument", "parameters.3d.unit.trilinearLagrange.component.argument" );
+    FmlObjectHandle parametersType = Fieldml_AddImport( session, importHandle, "trilinear.parameters", "parameters.3d.unit.trilinearLagrange" );
+    FmlObjectHandle parametersArgument = Fieldml_AddImport( session, importHandle, "trilinear.parameters.argument", "parameters.3d.unit.trilinearLagrange.argument" );
+    FmlObjectHandle interpolator = Fieldml_AddImport( session, importHandle, "trilinear.interpolator", "interpolator.3d.unit.trilinearLagrange" );
+    FmlObjectHandle coordinatesType = Fieldml_AddImport( session, importHandle, "coordinates.rc.3d", "coordinates.rc.3d" );
+    FmlObjectHandle componentArgument = Fieldml_AddImport( session, importHandle, "coordinates.rc.3d.component.argument", "coordinates.rc.3d.component.argument" );
+    
+    FmlObjectHandle nodesType = Fieldml_CreateEnsembleType( session, "test.nodes" );
+    Fieldml_SetEnsembleMembersRange( session, nodesType, 1, 12, 1 );
+    FmlObjectHandle nodesArgument = Fieldml_CreateArgumentEvaluator( session, "test.nodes.argument", nodesType );
+    
+    FmlObjectHandle meshType = Fieldml_CreateMeshType( session, "test.mesh" );
+    FmlObjectHandle elementsType = Fieldml_CreateMeshElementsType( session, meshType, "elements" );
+    Fieldml_SetEnsembleMembersRange( session, elementsType, 1, 2, 1 );
+    FmlObjectHandle chartType = Fieldml_CreateMeshChartType( session, meshType, "chart" );
+    Fieldml_CreateContinuousTypeComponents( session, chartType, "test.mesh.chart.component", 3 );
+    Fieldml_CreateArgumentEvaluator( session, "test.mesh.argument", meshType );
+    FmlObjectHandle elementsArgument = Fieldml_GetObjectByName( session, "test.mesh.argument.elements" );
+    FmlObjectHandle meshChartArgument = Fieldml_GetObjectByName( session, "test.mesh.argument.chart" );
+    
+    FmlObjectHandle dofsArgument = Fieldml_CreateArgumentEvaluator( session, "test.dofs.node.argument", realType );
+    Fieldml_AddArgument( session, dofsArgument, nodesArgument );
+    
+    int connectivity[16];
+    for( int e = 0; e < 2; e++ )
+    {
+        for( int n = 0; n < 8; n++ )
+        {
+            connectivity[e * 8 + n] = 1 + ( e + ( n & 1 ) ) + 3 * ( ( n >> 1 ) & 1 ) + 6 * ( n >> 2 );
+        }
+    }
+    int sizes[2] = { 2, 8 };
+    FmlObjectHandle connectivityData = createArrayData( session, "test.connectivity.data", nodesType, 2, sizes, NULL, connectivity );
+    FmlObjectHandle connectivityParameters = Fieldml_CreateParameterEvaluator( session, "test.connectivity", nodesType );
+    Fieldml_SetParameterDataDescription( session, connectivityParameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetDataSource( session, connectivityParameters, connectivityData );
+    Fieldml_AddDenseIndexEvaluator( session, connectivityParameters, elementsArgument, FML_INVALID_HANDLE );
+    Fieldml_AddDenseIndexEvaluator( session, connectivityParameters, pointsArgument, FML_INVALID_HANDLE );
+    
+    FmlObjectHandle elementParameters = Fieldml_CreateAggregateEvaluator( session, "test.trilinear.parameters", parametersType );
+    Fieldml_SetIndexEvaluator( session, elementParameters, 1, pointsArgument );
+    Fieldml_SetDefaultEvaluator( session, elementParameters, dofsArgument );
+    Fieldml_SetBind( session, elementParameters, nodesArgument, connectivityParameters );
+    
+    FmlObjectHandle trilinear = Fieldml_CreateReferenceEvaluator( session, "test.trilinear", interpolator );
+    Fieldml_SetBind( session, trilinear, chartArgument, meshChartArgument );
+    Fieldml_SetBind( session, trilinear, parametersArgument, elementParameters );
+    
+    FmlObjectHandle fieldTemplate = Fieldml_CreatePiecewiseEvaluator( session, "test.template", realType );
+    Fieldml_SetIndexEvaluator( session, fieldTemplate, 1, elementsArgument );
+    Fieldml_SetDefaultEvaluator( session, fieldTemplate, trilinear );
+    
+    double nodeCoordinates[36];
+    for( int k = 0; k < 2; k++ )
+    {
+        for( int j = 0; j < 2; j++ )
+        {
+            for( int i = 0; i < 3; i++ )
+            {
+                gridPosition( i, j, k, &nodeCoordinates[( i + 3 * j + 6 * k ) * 3] );
+            }
+        }
+    }
+    sizes[0] = 12;
+    sizes[1] = 3;
+    FmlObjectHandle nodeData = createArrayData( session, "test.coordinates.data", realType, 2, sizes, nodeCoordinates, NULL );
+    FmlObjectHandle nodeParameters = Fieldml_CreateParameterEvaluator( session, "test.coordinates.dofs", realType );
+    Fieldml_SetParameterDataDescription( session, nodeParameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetDataSource( session, nodeParameters, nodeData );
+    Fieldml_AddDenseIndexEvaluator( session, nodeParameters, nodesArgument, FML_INVALID_HANDLE );
+    Fieldml_AddDenseIndexEvaluator( session, nodeParameters, componentArgument, FML_INVALID_HANDLE );
+    
+    FmlObjectHandle coordinates = Fieldml_CreateAggregateEvaluator( session, "test.coordinates", coordinatesType );
+    Fieldml_SetIndexEvaluator( session, coordinates, 1, componentArgument );
+    Fieldml_SetDefaultEvaluator( session, coordinates, fieldTemplate );
+    Fieldml_SetBind( session, coordinates, dofsArgument, nodeParameters );
+    
+    return coordinates;
+}
+
+
+/**
+ * Ensure that a trilinear Lagrange field evaluates correctly, over batches spanning several blocks and with elements
+ * in any order.
+ */
+SIMPLE_TEST( FieldmlEvaluateTrilinearTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    FmlObjectHandle coordinates = createTrilinearMesh( session );
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, coordinates, FML_INVALID_HANDLE, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT( plan != FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( 3, Fieldml_GetEvaluationPlanValueCount( plan ) );
+    SIMPLE_ASSERT_EQUALS( 3, Fieldml_GetEvaluationPlanXiCount( plan ) );
+    
+    const int POINT_COUNT = 5000;
+    vector<FmlEnsembleValue> elements( POINT_COUNT );
+    vector<double> xi( POINT_COUNT * 3 );
+    vector<double> values( POINT_COUNT * 3 );
+    srand( 1 );
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        elements[i] = ( ( i % 7 ) < 3 ) ? 1 : 2;
+        for( int d = 0; d < 3; d++ )
+        {
+            xi[i * 3 + d] = (double)rand() / RAND_MAX;
+        }
+    }
+    
+    FmlIoErrorNumber err = Fieldml_EvaluatePlan( plan, POINT_COUNT, &elements[0], &xi[0], &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    int wrongCount = 0;
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        double expected[3];
+        gridPosition( elements[i] - 1 + xi[i * 3], xi[i * 3 + 1], xi[i * 3 + 2], expected );
+        for( int d = 0; d < 3; d++ )
+        {
+            if( fabs( expected[d] - values[i * 3 + d] ) > TOLERANCE )
+            {
+                wrongCount++;
+            }
+        }
+    }
+    SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+    
+    //The derivatives of an affine map are its coefficients.
+    const double derivatives[3][3] = { { 2.0, 0.0, 0.5 }, { 1.0, 3.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+    for( int direction = 0; direction < 3; direction++ )
+    {
+        err = Fieldml_EvaluatePlanDerivative( plan, direction + 1, POINT_COUNT, &elements[0], &xi[0], &values[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int i = 0; i < POINT_COUNT; i++ )
+        {
+            for( int d = 0; d < 3; d++ )
+            {
+                if( fabs( derivatives[direction][d] - values[i * 3 + d] ) > TOLERANCE )
+                {
+                    wrongCount++;
+                }
+            }
+        }
+    }
+    SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+    
+    err = Fieldml_EvaluatePlanDerivative( plan, 4, POINT_COUNT, &elements[0], &xi[0], &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    
+    //Element 3 is not in the mesh, so it has no connectivity.
+    elements[0] = 3;
+    err = Fieldml_EvaluatePlan( plan, 1, &elements[0], &xi[0], &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT( values[0] != values[0] );
+    
+    err = Fieldml_DestroyEvaluationPlan( plan );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    err = Fieldml_EvaluatePlan( plan, 1, &elements[0], &xi[0], &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, err );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that batch evaluation on several threads gives the same values as evaluation on one, for a batch with
+ * elements of differing cost and a length that is not a multiple of the block size.
+ */
+SIMPLE_TEST( FieldmlEvaluateBatchTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    FmlObjectHandle coordinates = createTrilinearMesh( session );
+    
+    //Element 3 is undefined, so is much cheaper to evaluate than the others.
+    const int POINT_COUNT = 100003;
+    vector<FmlEnsembleValue> elements( POINT_COUNT );
+    vector<double> xi( POINT_COUNT * 3 );
+    srand( 2 );
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        elements[i] = ( i < POINT_COUNT / 2 ) ? 3 : 1 + ( i % 2 );
+        for( int d = 0; d < 3; d++ )
+        {
+            xi[i * 3 + d] = (double)rand() / RAND_MAX;
+        }
+    }
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, coordinates, FML_INVALID_HANDLE, FML_INVALID_HANDLE );
+    vector<double> expected( POINT_COUNT * 3 );
+    FmlIoErrorNumber err = Fieldml_EvaluatePlan( plan, POINT_COUNT, &elements[0], &xi[0], &expected[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    const int threadCounts[] = { 1, 4, 0 };
+    for( int t = 0; t < 3; t++ )
+    {
+        err = Fieldml_SetEvaluationThreadCount( threadCounts[t] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        vector<double> values( POINT_COUNT * 3, 0.0 );
+        err = Fieldml_EvaluateBatch( session, coordinates, &elements[0], &xi[0], POINT_COUNT, &values[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        int wrongCount = 0;
+        for( int i = 0; i < POINT_COUNT * 3; i++ )
+        {
+            //NaN for the undefined points must match too.
+            if( ( values[i] != expected[i] ) && ( ( values[i] == values[i] ) || ( expected[i] == expected[i] ) ) )
+            {
+                wrongCount++;
+            }
+        }
+        SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+    }
+    
+    err = Fieldml_SetEvaluationThreadCount( -1 );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    
+    err = Fieldml_EvaluateBatch( session, coordinates, &elements[0], NULL, POINT_COUNT, &expected[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * One call to Fieldml_EvaluateBatch, made on its own thread.
+ */
+struct BatchCall
+{
+    FmlSessionHandle session;
+    FmlObjectHandle evaluator;
+    const FmlEnsembleValue *elements;
+    const double *xi;
+    int pointCount;
+    vector<double> values;
+    FmlIoErrorNumber error;
+};
+
+
+#ifdef WIN32
+static DWORD WINAPI batchCallMain( LPVOID parameter )
+#else
+static void *batchCallMain( void *parameter )
+#endif
+{
+    BatchCall *call = (BatchCall *)parameter;
+    call->error = Fieldml_EvaluateBatch( call->session, call->evaluator, call->elements, call->xi, call->pointCount, &call->values[0] );
+    return 0;
+}
+
+
+/**
+ * Ensure that several threads can call Fieldml_EvaluateBatch on the same session at the same time, and that each
+ * gets the values a single evaluation plan gives.
+ */
+SIMPLE_TEST( FieldmlEvaluateBatchConcurrentTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    FmlObjectHandle coordinates = createTrilinearMesh( session );
+    
+    const int POINT_COUNT = 20011;
+    vector<FmlEnsembleValue> elements( POINT_COUNT );
+    vector<double> xi( POINT_COUNT * 3 );
+    srand( 3 );
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        //Element 3 is undefined.
+        elements[i] = 1 + ( i % 3 );
+        for( int d = 0; d < 3; d++ )
+        {
+            xi[i * 3 + d] = (double)rand() / RAND_MAX;
+        }
+    }
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, coordinates, FML_INVALID_HANDLE, FML_INVALID_HANDLE );
+    vector<double> expected( POINT_COUNT * 3 );
+    FmlIoErrorNumber err = Fieldml_EvaluatePlan( plan, POINT_COUNT, &elements[0], &xi[0], &expected[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    err = Fieldml_SetEvaluationThreadCount( 2 );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //Each call starts at a different point, so that the calls are not all evaluating the same elements at once.
+    const int CALL_COUNT = 4;
+    BatchCall calls[CALL_COUNT];
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        const int first = c * ( POINT_COUNT / CALL_COUNT );
+        calls[c].session = session;
+        calls[c].evaluator = coordinates;
+        calls[c].elements = &elements[first];
+        calls[c].xi = &xi[first * 3];
+        calls[c].pointCount = POINT_COUNT - first;
+        calls[c].values.assign( calls[c].pointCount * 3, 0.0 );
+        calls[c].error = FML_IOERR_UNKNOWN_OBJECT;
+    }
+    
+#ifdef WIN32
+    HANDLE threads[CALL_COUNT];
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        threads[c] = CreateThread( NULL, 0, batchCallMain, &calls[c], 0, NULL );
+        SIMPLE_ASSERT( threads[c] != NULL );
+    }
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        WaitForSingleObject( threads[c], INFINITE );
+        CloseHandle( threads[c] );
+    }
+#else
+    pthread_t threads[CALL_COUNT];
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        SIMPLE_ASSERT_EQUALS( 0, pthread_create( &threads[c], NULL, batchCallMain, &calls[c] ) );
+    }
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        pthread_join( threads[c], NULL );
+    }
+#endif //WIN32
+    
+    for( int c = 0; c < CALL_COUNT; c++ )
+    {
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, calls[c].error );
+        
+        const double *callExpected = &expected[( POINT_COUNT - calls[c].pointCount ) * 3];
+        int wrongCount = 0;
+        for( int i = 0; i < calls[c].pointCount * 3; i++ )
+        {
+            //NaN for the points in the undefined element must match too.
+            if( ( calls[c].values[i] != callExpected[i] ) && ( ( calls[c].values[i] == calls[c].values[i] ) || ( callExpected[i] == callExpected[i] ) ) )
+            {
+                wrongCount++;
+            }
+        }
+        SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+    }
+    
+    Fieldml_SetEvaluationThreadCount( 0 );
+    Fieldml_Destroy( session );
+}
+
+/**
+ * Ensure that DOK parameters are found by key whatever order their keys are stored in, and that cached parameter data
+ * is reloaded by new plans once it has been rewritten.
+ */
+SIMPLE_TEST( FieldmlEvaluateDokTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    
+    const int ROW_COUNT = 50;
+    FmlObjectHandle rowsType = Fieldml_CreateEnsembleType( session, "test.rows" );
+    Fieldml_SetEnsembleMembersRange( session, rowsType, 1, ROW_COUNT, 1 );
+    FmlObjectHandle rowsArgument = Fieldml_CreateArgumentEvaluator( session, "test.rows.argument", rowsType );
+    
+    FmlObjectHandle vectorType = Fieldml_CreateContinuousType( session, "test.vector" );
+    FmlObjectHandle columnsType = Fieldml_CreateContinuousTypeComponents( session, vectorType, "test.vector.component", 4 );
+    FmlObjectHandle columnsArgument = Fieldml_CreateArgumentEvaluator( session, "test.vector.component.argument", columnsType );
+    
+    //Every row has values in columns 1 and 3, and every fifth row in column 4, stored in a scrambled order.
+    vector<int> keys;
+    vector<double> data;
+    for( int i = 0; i < ROW_COUNT; i++ )
+    {
+        const int row = 1 + ( i * 17 ) % ROW_COUNT;
+        for( int column = 1; column <= 4; column++ )
+        {
+            if( ( column == 1 ) || ( column == 3 ) || ( ( column == 4 ) && ( row % 5 == 0 ) ) )
+            {
+                keys.push_back( row );
+                keys.push_back( column );
+                data.push_back( 100.0 * row + column );
+            }
+        }
+    }
+    const int keyCount = data.size();
+    int sizes[2] = { keyCount, 2 };
+    FmlObjectHandle keyData = createArrayData( session, "test.keys.data", rowsType, 2, sizes, NULL, &keys[0] );
+    FmlObjectHandle valueData = createArrayData( session, "test.values.data", realType, 1, sizes, &data[0], NULL );
+    
+    FmlObjectHandle parameters = Fieldml_CreateParameterEvaluator( session, "test.values", realType );
+    Fieldml_SetParameterDataDescription( session, parameters, FML_DATA_DESCRIPTION_DOK_ARRAY );
+    Fieldml_SetDataSource( session, parameters, valueData );
+    Fieldml_SetKeyDataSource( session, parameters, keyData );
+    Fieldml_AddSparseIndexEvaluator( session, parameters, rowsArgument );
+    Fieldml_AddSparseIndexEvaluator( session, parameters, columnsArgument );
+    
+    FmlObjectHandle rowVector = Fieldml_CreateAggregateEvaluator( session, "test.row_vector", vectorType );
+    Fieldml_SetIndexEvaluator( session, rowVector, 1, columnsArgument );
+    Fieldml_SetDefaultEvaluator( session, rowVector, parameters );
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, rowVector, rowsArgument, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT( plan != FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( 4, Fieldml_GetEvaluationPlanValueCount( plan ) );
+    
+    FmlEnsembleValue rows[ROW_COUNT + 1];
+    double values[( ROW_COUNT + 1 ) * 4];
+    for( int i = 0; i <= ROW_COUNT; i++ )
+    {
+        rows[i] = i + 1;
+    }
+    
+    FmlIoErrorNumber err = Fieldml_EvaluatePlan( plan, ROW_COUNT + 1, rows, NULL, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    int wrongCount = 0;
+    for( int i = 0; i <= ROW_COUNT; i++ )
+    {
+        for( int column = 1; column <= 4; column++ )
+        {
+            const double value = values[i * 4 + column - 1];
+            const bool isDefined = ( rows[i] <= ROW_COUNT ) && ( ( column == 1 ) || ( column == 3 ) || ( ( column == 4 ) && ( rows[i] % 5 == 0 ) ) );
+            if( isDefined ? ( value != 100.0 * rows[i] + column ) : ( value == value ) )
+            {
+                wrongCount++;
+            }
+        }
+    }
+    SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+    
+    //Rewriting the values drops them from the cache, but the existing plan keeps the values it was created with.
+    for( int i = 0; i < keyCount; i++ )
+    {
+        data[i] = -data[i];
+    }
+    int offsets[1] = { 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, valueData, realType, 0, sizes, 1 );
+    Fieldml_WriteDoubleSlab( writer, offsets, sizes, &data[0] );
+    Fieldml_CloseWriter( writer );
+    
+    err = Fieldml_EvaluatePlan( plan, 1, rows, NULL, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 101.0, values[0] );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    plan = Fieldml_CreateEvaluationPlan( session, rowVector, rowsArgument, FML_INVALID_HANDLE );
+    err = Fieldml_EvaluatePlan( plan, 1, rows, NULL, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( -101.0, values[0] );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    err = Fieldml_ClearParameterCache( session );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    Fieldml_Destroy( session );
+}
+
+/**
+ * Ensure that new plans see parameter data changed through the core API, even when the data's sizes stay the same.
+ */
+SIMPLE_TEST( FieldmlEvaluateChangedDataTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    FmlObjectHandle ensembleType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    Fieldml_SetEnsembleMembersRange( session, ensembleType, 1, 2, 1 );
+    FmlObjectHandle argument = Fieldml_CreateArgumentEvaluator( session, "test.ensemble.argument", ensembleType );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    Fieldml_SetInlineData( session, resource, "1 2 3 4\n", 8 );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    int rawSizes[1] = { 4 };
+    int sizes[1] = { 2 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, rawSizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    FmlObjectHandle parameters = Fieldml_CreateParameterEvaluator( session, "test.parameters", realType );
+    Fieldml_SetParameterDataDescription( session, parameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetDataSource( session, parameters, source );
+    Fieldml_AddDenseIndexEvaluator( session, parameters, argument, FML_INVALID_HANDLE );
+    
+    FmlEnsembleValue elements[2] = { 1, 2 };
+    double values[2];
+    const int revision = Fieldml_GetDataRevision( session, source );
+    SIMPLE_ASSERT( revision >= 0 );
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, parameters, argument, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_EvaluatePlan( plan, 2, elements, NULL, values ) );
+    SIMPLE_ASSERT_EQUALS( 1.0, values[0] );
+    SIMPLE_ASSERT_EQUALS( 2.0, values[1] );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    int offsets[1] = { 2 };
+    Fieldml_SetArrayDataSourceOffsets( session, source, offsets );
+    SIMPLE_ASSERT( Fieldml_GetDataRevision( session, source ) != revision );
+    
+    plan = Fieldml_CreateEvaluationPlan( session, parameters, argument, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_EvaluatePlan( plan, 2, elements, NULL, values ) );
+    SIMPLE_ASSERT_EQUALS( 3.0, values[0] );
+    SIMPLE_ASSERT_EQUALS( 4.0, values[1] );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    Fieldml_SetInlineData( session, resource, "5 6 7 8\n", 8 );
+    
+    plan = Fieldml_CreateEvaluationPlan( session, parameters, argument, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_EvaluatePlan( plan, 2, elements, NULL, values ) );
+    SIMPLE_ASSERT_EQUALS( 7.0, values[0] );
+    SIMPLE_ASSERT_EQUALS( 8.0, values[1] );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    SIMPLE_ASSERT_EQUALS( -1, Fieldml_GetDataRevision( session, parameters ) );
+    
+    Fieldml_Destroy( session );
+}
+
+/**
+ * Ensure that a cubic Lagrange field evaluates correctly when its parameters are gathered by an aggregate over the
+ * parameter components, and that plans with missing or unknown inputs are rejected.
+ */
+SIMPLE_TEST( FieldmlEvaluateCubicTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    Fieldml_SetDebug( session, 0 );
+    
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    FmlObjectHandle chartArgument = Fieldml_AddImport( session, importHandle, "chart.1d.argument", "chart.1d.argument" );
+    FmlObjectHandle parametersType = Fieldml_AddImport( session, importHandle, "cubic.parameters", "parameters.1d.unit.cubicLagrange" );
+    FmlObjectHandle parametersComponentArgument = Fieldml_AddImport( session, importHandle, "cubic.parameters.component.argument", "parameters.1d.unit.cubicLagrange.component.argument" );
+    FmlObjectHandle parametersArgument = Fieldml_AddImport( session, importHandle, "cubic.parameters.argument", "parameters.1d.unit.cubicLagrange.argument" );
+    FmlObjectHandle interpolator = Fieldml_AddImport( session, importHandle, "cubic.interpolator", "interpolator.1d.unit.cubicLagrange" );
+    
+    FmlObjectHandle nodesType = Fieldml_CreateEnsembleType( session, "test.nodes" );
+    Fieldml_SetEnsembleMembersRange( session, nodesType, 1, 4, 1 );
+    FmlObjectHandle nodesArgument = Fieldml_CreateArgumentEvaluator( session, "test.nodes.argument", nodesType );
+    
+    FmlObjectHandle meshType = Fieldml_CreateMeshType( session, "test.mesh" );
+    FmlObjectHandle elementsType = Fieldml_CreateMeshElementsType( session, meshType, "elements" );
+    Fieldml_SetEnsembleMembersRange( session, elementsType, 1, 1, 1 );
+    FmlObjectHandle chartType = Fieldml_CreateMeshChartType( session, meshType, "chart" );
+    Fieldml_CreateContinuousTypeComponents( session, chartType, "test.mesh.chart.component", 1 );
+    Fieldml_CreateArgumentEvaluator( session, "test.mesh.argument", meshType );
+    FmlObjectHandle elementsArgument = Fieldml_GetObjectByName( session, "test.mesh.argument.elements" );
+    FmlObjectHandle meshChartArgument = Fieldml_GetObjectByName( session, "test.mesh.argument.chart" );
+    
+    //Node values sample x^3, which cubic interpolation reproduces exactly. The nodes are numbered in reverse.
+    int connectivity[4] = { 4, 3, 2, 1 };
+    int sizes[2] = { 1, 4 };
+    FmlObjectHandle connectivityData = createArrayData( session, "test.connectivity.data", nodesType, 2, sizes, NULL, connectivity );
+    FmlObjectHandle connectivityParameters = Fieldml_CreateParameterEvaluator( session, "test.connectivity", nodesType );
+    Fieldml_SetParameterDataDescription( session, connectivityParameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetDataSource( session, connectivityParameters, connectivityData );
+    Fieldml_AddDenseIndexEvaluator( session, connectivityParameters, elementsArgument, FML_INVALID_HANDLE );
+    Fieldml_AddDenseIndexEvaluator( session, connectivityParameters, parametersComponentArgument, FML_INVALID_HANDLE );
+    
+    double nodeValues[4];
+    for( int n = 0; n < 4; n++ )
+    {
+        double x = ( 3 - n ) / 3.0;
+        nodeValues[n] = x * x * x;
+    }
+    sizes[0] = 4;
+    FmlObjectHandle nodeData = createArrayData( session, "test.values.data", realType, 1, sizes, nodeValues, NULL );
+    FmlObjectHandle nodeParameters = Fieldml_CreateParameterEvaluator( session, "test.values", realType );
+    Fieldml_SetParameterDataDescription( session, nodeParameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetDataSource( session, nodeParameters, nodeData );
+    Fieldml_AddDenseIndexEvaluator( session, nodeParameters, nodesArgument, FML_INVALID_HANDLE );
+    
+    FmlObjectHandle localValues = Fieldml_CreateAggregateEvaluator( session, "test.local_values", parametersType );
+    Fieldml_SetIndexEvaluator( session, localValues, 1, parametersComponentArgument );
+    Fieldml_SetDefaultEvaluator( session, localValues, nodeParameters );
+    Fieldml_SetBind( session, localValues, nodesArgument, connectivityParameters );
+    
+    FmlObjectHandle cubic = Fieldml_CreateReferenceEvaluator( session, "test.cubic", interpolator );
+    Fieldml_SetBind( session, cubic, chartArgument, meshChartArgument );
+    Fieldml_SetBind( session, cubic, parametersArgument, localValues );
+    
+    FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, cubic, elementsArgument, meshChartArgument );
+    SIMPLE_ASSERT( plan != FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( 1, Fieldml_GetEvaluationPlanValueCount( plan ) );
+    SIMPLE_ASSERT_EQUALS( 1, Fieldml_GetEvaluationPlanXiCount( plan ) );
+    
+    const int POINT_COUNT = 11;
+    FmlEnsembleValue elements[POINT_COUNT];
+    double xi[POINT_COUNT];
+    double values[POINT_COUNT];
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        elements[i] = 1;
+        xi[i] = i / 10.0;
+    }
+    
+    FmlIoErrorNumber err = Fieldml_EvaluatePlan( plan, POINT_COUNT, elements, xi, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        SIMPLE_ASSERT( fabs( xi[i] * xi[i] * xi[i] - values[i] ) < TOLERANCE );
+    }
+    
+    err = Fieldml_EvaluatePlanDerivative( plan, 1, POINT_COUNT, elements, xi, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < POINT_COUNT; i++ )
+    {
+        SIMPLE_ASSERT( fabs( 3.0 * xi[i] * xi[i] - values[i] ) < TOLERANCE );
+    }
+    
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    //Without the chart, the interpolator has nothing to evaluate at.
+    plan = Fieldml_CreateEvaluationPlan( session, cubic, elementsArgument, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT( plan != FML_INVALID_HANDLE );
+    err = Fieldml_EvaluatePlan( plan, POINT_COUNT, elements, NULL, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNBOUND_ARGUMENT, err );
+    Fieldml_DestroyEvaluationPlan( plan );
+    
+    //Only the library interpolators can be evaluated.
+    FmlObjectHandle external = Fieldml_CreateExternalEvaluator( session, "test.external", realType );
+    plan = Fieldml_CreateEvaluationPlan( session, external, FML_INVALID_HANDLE, FML_INVALID_HANDLE );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, plan );
+    
+    Fieldml_Destroy( session );
+}
+
+
+//A product of one polynomial of the given order in each xi coordinate, which the Lagrange interpolator of that
+//order reproduces exactly.
+static double lagrangeTestPolynomial( int dimensions, int order, const double *x, int derivativeDirection )
+{
+    double value = 1.0;
+    for( int d = 0; d < dimensions; d++ )
+    {
+        if( d == derivativeDirection )
+        {
+            value *= 1.0 + ( d + 1 ) * order * pow( x[d], order - 1 );
+        }
+        else
+        {
+            value *= 1.0 + x[d] + ( d + 1 ) * pow( x[d], order );
+        }
+    }
+    
+    return value;
+}
+
+
+/**
+ * Ensure that each of the library Lagrange interpolators evaluates the values and derivatives of a polynomial of
+ * its order exactly, given the polynomial's values at its nodes.
+ */
+SIMPLE_TEST( FieldmlEvaluateLagrangeTest )
+{
+    const char *names[] = { "linear", "quadratic", "cubic", "bilinear", "biquadratic", "bicubic", "trilinear", "triquadratic", "tricubic" };
+    
+    for( int interpolatorIndex = 0; interpolatorIndex < 9; interpolatorIndex++ )
+    {
+        const int dimensions = 1 + interpolatorIndex / 3;
+        const int order = 1 + interpolatorIndex % 3;
+        const string suffix = string( dimensions == 1 ? "1d" : ( dimensions == 2 ? "2d" : "3d" ) ) + ".unit." + names[interpolatorIndex] + "Lagrange";
+        const string chartSuffix = string( "chart." ) + ( dimensions == 1 ? "1d" : ( dimensions == 2 ? "2d" : "3d" ) ) + ".argument";
+        
+        FmlSessionHandle session = Fieldml_Create( "", "test" );
+        Fieldml_SetDebug( session, 0 );
+        
+        int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+        FmlObjectHandle chartArgument = Fieldml_AddImport( session, importHandle, chartSuffix.c_str(), chartSuffix.c_str() );
+        FmlObjectHandle parametersType = Fieldml_AddImport( session, importHandle, ( "parameters." + suffix ).c_str(), ( "parameters." + suffix ).c_str() );
+        FmlObjectHandle parametersArgument = Fieldml_AddImport( session, importHandle, ( "parameters." + suffix + ".argument" ).c_str(), ( "parameters." + suffix + ".argument" ).c_str() );
+        FmlObjectHandle interpolator = Fieldml_AddImport( session, importHandle, ( "interpolator." + suffix ).c_str(), ( "interpolator." + suffix ).c_str() );
+        
+        //Sample the polynomial at the nodes, with the first coordinate varying fastest.
+        int basisCount = 1;
+        for( int d = 0; d < dimensions; d++ )
+        {
+            basisCount *= order + 1;
+        }
+        string literal;
+        for( int b = 0; b < basisCount; b++ )
+        {
+            double node[3];
+            int n = b;
+            for( int d = 0; d < dimensions; d++ )
+            {
+                node[d] = (double)( n % ( order + 1 ) ) / order;
+                n /= order + 1;
+            }
+            
+            char buffer[64];
+            sprintf( buffer, "%.17g ", lagrangeTestPolynomial( dimensions, order, node, -1 ) );
+            literal += buffer;
+        }
+        FmlObjectHandle nodeValues = Fieldml_CreateConstantEvaluator( session, "test.node_values", literal.c_str(), parametersType );
+        
+        FmlObjectHandle field = Fieldml_CreateReferenceEvaluator( session, "test.field", interpolator );
+        Fieldml_SetBind( session, field, parametersArgument, nodeValues );
+        
+        FmlEvaluationPlanHandle plan = Fieldml_CreateEvaluationPlan( session, field, FML_INVALID_HANDLE, chartArgument );
+        SIMPLE_ASSERT( plan != FML_INVALID_HANDLE );
+        SIMPLE_ASSERT_EQUALS( dimensions, Fieldml_GetEvaluationPlanXiCount( plan ) );
+        
+        const int POINT_COUNT = 200;
+        vector<double> xi( POINT_COUNT * dimensions );
+        vector<double> values( POINT_COUNT );
+        srand( interpolatorIndex );
+        for( int i = 0; i < POINT_COUNT * dimensions; i++ )
+        {
+            xi[i] = (double)rand() / RAND_MAX;
+        }
+        
+        int wrongCount = 0;
+        for( int direction = -1; direction < dimensions; direction++ )
+        {
+            FmlIoErrorNumber err;
+            if( direction < 0 )
+            {
+                err = Fieldml_EvaluatePlan( plan, POINT_COUNT, NULL, &xi[0], &values[0] );
+            }
+            else
+            {
+                err = Fieldml_EvaluatePlanDerivative( plan, direction + 1, POINT_COUNT, NULL, &xi[0], &values[0] );
+            }
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            
+            for( int i = 0; i < POINT_COUNT; i++ )
+            {
+                if( fabs( lagrangeTestPolynomial( dimensions, order, &xi[i * dimensions], direction ) - values[i] ) > 1e-10 )
+                {
+                    wrongCount++;
+                }
+            }
+        }
+        SIMPLE_ASSERT_EQUALS( 0, wrongCount );
+        
+        Fieldml_DestroyEvaluationPlan( plan );
+        Fieldml_Destroy( session );
+    }
+}
@@ -42,6 +42,8 @@
 #include <cstring>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
+#include <vector>
 
 #include "FieldmlIoApi.h"
 #include "fieldml_api.h"
@@ -578,6 +580,742 @@ int testCycles()
 }
 
 
+int testEvaluatorRanges()
+{
+    bool testOk = true;
+    
+    printf( "Test evaluator ranges...\n" );
+    
+    FmlSessionHandle session = Fieldml_Create( "test", "test" );
+    
+    FmlObjectHandle type = Fieldml_CreateContinuousType( session, "test.type" );
+    
+    FmlObjectHandle ensemble = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    Fieldml_SetEnsembleMembersRange( session, ensemble, 1, 100, 1 );
+    
+    FmlObjectHandle external1 = Fieldml_CreateExternalEvaluator( session, "test.external1", type );
+    FmlObjectHandle external2 = Fieldml_CreateExternalEvaluator( session, "test.external2", type );
+    
+    FmlObjectHandle piece = Fieldml_CreatePiecewiseEvaluator( session, "test.piecewise", type );
+    
+    Fieldml_SetEvaluatorRange( session, piece, 1, 100, external1 );
+    Fieldml_SetEvaluatorRange( session, piece, 41, 60, external2 );
+    
+    if( ( Fieldml_GetEvaluatorCount( session, piece ) != 100 ) || ( Fieldml_GetEvaluatorRangeCount( session, piece ) != 3 ) )
+    {
+        printf( "TestEvaluatorRanges - split range test failed\n" );
+        testOk = false;
+    }
+    if( ( Fieldml_GetEvaluatorRangeMin( session, piece, 2 ) != 41 ) || ( Fieldml_GetEvaluatorRangeMax( session, piece, 2 ) != 60 ) ||
+        ( Fieldml_GetEvaluatorRangeEvaluator( session, piece, 2 ) != external2 ) )
+    {
+        printf( "TestEvaluatorRanges - range bounds test failed\n" );
+        testOk = false;
+    }
+    if( ( Fieldml_GetElementEvaluator( session, piece, 40, 0 ) != external1 ) || ( Fieldml_GetEvaluatorElement( session, piece, 50 ) != 50 ) ||
+        ( Fieldml_GetEvaluator( session, piece, 50 ) != external2 ) )
+    {
+        printf( "TestEvaluatorRanges - element lookup test failed\n" );
+        testOk = false;
+    }
+    
+    FmlObjectHandle evaluators[20];
+    for( int i = 0; i < 20; i++ )
+    {
+        evaluators[i] = ( i < 10 ) ? external1 : FML_INVALID_HANDLE;
+    }
+    Fieldml_SetEvaluatorArray( session, piece, 41, 20, evaluators );
+    
+    if( ( Fieldml_GetEvaluatorCount( session, piece ) != 90 ) || ( Fieldml_GetEvaluatorRangeCount( session, piece ) != 2 ) ||
+        ( Fieldml_GetElementEvaluator( session, piece, 55, 0 ) != FML_INVALID_HANDLE ) )
+    {
+        printf( "TestEvaluatorRanges - array test failed\n" );
+        testOk = false;
+    }
+    
+    if( Fieldml_GetEvaluatorRangeMin( session, piece, 3 ) != -1 )
+    {
+        printf( "TestEvaluatorRanges - invalid range index test failed\n" );
+        testOk = false;
+    }
+    
+    if( ( Fieldml_SetEvaluatorArray( session, piece, 2147483647 - 5, 20, evaluators ) != FML_ERR_INVALID_PARAMETER_4 ) ||
+        ( Fieldml_SetEvaluatorRange( session, piece, -2147483647 - 1, 2147483647, external1 ) != FML_ERR_INVALID_PARAMETER_4 ) ||
+        ( Fieldml_GetEvaluatorCount( session, piece ) != 90 ) )
+    {
+        printf( "TestEvaluatorRanges - overflow test failed\n" );
+        testOk = false;
+    }
+    Fieldml_ClearErrors( session );
+    if( ( Fieldml_SetEvaluatorArray( session, piece, 2147483647 - 19, 20, evaluators ) != FML_ERR_NO_ERROR ) ||
+        ( Fieldml_GetEvaluatorRangeMin( session, piece, 3 ) != 2147483647 - 19 ) || ( Fieldml_GetEvaluatorRangeMax( session, piece, 3 ) != 2147483647 - 10 ) )
+    {
+        printf( "TestEvaluatorRanges - upper bound test failed\n" );
+        testOk = false;
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestEvaluatorRanges - ok\n" );
+    }
+    else
+    {
+        printf( "TestEvaluatorRanges - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+int testArguments()
+{
+    bool testOk = true;
+    
+    printf( "Test arguments...\n" );
+    
+    FmlSessionHandle session = Fieldml_Create( "test", "test" );
+    
+    FmlObjectHandle type = Fieldml_CreateContinuousType( session, "test.type" );
+    
+    FmlObjectHandle ensemble = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    Fieldml_SetEnsembleMembersRange( session, ensemble, 1, 10, 1 );
+    
+    FmlObjectHandle argument1 = Fieldml_CreateArgumentEvaluator( session, "test.argument1", type );
+    FmlObjectHandle argument2 = Fieldml_CreateArgumentEvaluator( session, "test.argument2", type );
+    FmlObjectHandle indexArgument = Fieldml_CreateArgumentEvaluator( session, "test.index_argument", ensemble );
+    
+    FmlObjectHandle external1 = Fieldml_CreateExternalEvaluator( session, "test.external1", type );
+    Fieldml_AddArgument( session, external1, argument1 );
+    FmlObjectHandle external2 = Fieldml_CreateExternalEvaluator( session, "test.external2", type );
+    
+    FmlObjectHandle reference = Fieldml_CreateReferenceEvaluator( session, "test.reference", external1 );
+    
+    if( ( Fieldml_GetArgumentCount( session, reference, 0, 1 ) != 1 ) || ( Fieldml_GetArgument( session, reference, 1, 0, 1 ) != argument1 ) )
+    {
+        printf( "TestArguments - unbound test failed\n" );
+        testOk = false;
+    }
+    
+    //Repeated queries are answered from the session's cache, which must follow later changes.
+    Fieldml_SetBind( session, reference, argument1, argument2 );
+    if( ( Fieldml_GetArgumentCount( session, reference, 0, 1 ) != 1 ) || ( Fieldml_GetArgument( session, reference, 1, 0, 1 ) != argument2 ) ||
+        ( Fieldml_GetArgumentCount( session, reference, 1, 1 ) != 1 ) || ( Fieldml_GetArgument( session, reference, 1, 1, 1 ) != argument1 ) )
+    {
+        printf( "TestArguments - bind test failed\n" );
+        testOk = false;
+    }
+    
+    Fieldml_AddArgument( session, argument2, indexArgument );
+    if( Fieldml_GetArgumentCount( session, reference, 0, 1 ) != 2 )
+    {
+        printf( "TestArguments - argument test failed\n" );
+        testOk = false;
+    }
+    
+    FmlObjectHandle piece = Fieldml_CreatePiecewiseEvaluator( session, "test.piecewise", type );
+    Fieldml_SetIndexEvaluator( session, piece, 1, indexArgument );
+    Fieldml_SetDefaultEvaluator( session, piece, reference );
+    if( Fieldml_GetArgumentCount( session, piece, 0, 1 ) != 2 )
+    {
+        printf( "TestArguments - piecewise test failed\n" );
+        testOk = false;
+    }
+    
+    Fieldml_SetBind( session, reference, argument1, external2 );
+    if( ( Fieldml_GetArgumentCount( session, piece, 0, 1 ) != 1 ) || ( Fieldml_GetArgument( session, piece, 1, 0, 1 ) != indexArgument ) )
+    {
+        printf( "TestArguments - delegate change test failed\n" );
+        testOk = false;
+    }
+    
+    if( Fieldml_SetBind( session, reference, argument1, reference ) != FML_ERR_CYCLIC_DEPENDENCY )
+    {
+        printf( "TestArguments - self bind test failed\n" );
+        testOk = false;
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestArguments - ok\n" );
+    }
+    else
+    {
+        printf( "TestArguments - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+int testStreamingRead()
+{
+    bool testOk = true;
+    double values[] = { 1.5, 2.5, 3.5 };
+    int sizes[1], offsets[1];
+    
+    printf( "Test streaming read...\n" );
+    
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle rc3Ensemble = Fieldml_AddImport( session, importHandle, "chart.3d.component", "chart.3d.component" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    
+    //Objects are written in creation order, so the reference evaluator and the parameters both refer forwards.
+    FmlObjectHandle argument = Fieldml_CreateArgumentEvaluator( session, "test.argument", realType );
+    FmlObjectHandle external = Fieldml_CreateExternalEvaluator( session, "test.external", realType );
+    Fieldml_AddArgument( session, external, argument );
+    FmlObjectHandle reference = Fieldml_CreateReferenceEvaluator( session, "test.reference", external );
+    
+    FmlObjectHandle parameters = Fieldml_CreateParameterEvaluator( session, "test.parameters", realType );
+    Fieldml_SetParameterDataDescription( session, parameters, FML_DATA_DESCRIPTION_DENSE_ARRAY );
+    Fieldml_SetBind( session, reference, argument, parameters );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    sizes[0] = 3;
+    offsets[0] = 0;
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    Fieldml_SetDataSource( session, parameters, source );
+    
+    FmlObjectHandle index = Fieldml_CreateArgumentEvaluator( session, "test.index", rc3Ensemble );
+    Fieldml_AddDenseIndexEvaluator( session, parameters, index, FML_INVALID_HANDLE );
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    Fieldml_CloseWriter( writer );
+    
+    int objectCount = Fieldml_GetTotalObjectCount( session );
+    Fieldml_WriteFile( session, "output/streaming.xml" );
+    Fieldml_Destroy( session );
+    
+    session = Fieldml_CreateFromFileWithOptions( "output/streaming.xml", FML_PARSE_STREAMING );
+    if( ( Fieldml_GetLastError( session ) != FML_ERR_NO_ERROR ) || ( Fieldml_GetErrorCount( session ) != 0 ) )
+    {
+        printf( "TestStreamingRead - parse test failed\n" );
+        testOk = false;
+    }
+    
+    if( Fieldml_GetTotalObjectCount( session ) != objectCount )
+    {
+        printf( "TestStreamingRead - object count test failed\n" );
+        testOk = false;
+    }
+    
+    reference = Fieldml_GetObjectByName( session, "test.reference" );
+    parameters = Fieldml_GetObjectByName( session, "test.parameters" );
+    if( ( Fieldml_GetBindCount( session, reference ) != 1 ) || ( Fieldml_GetBindEvaluator( session, reference, 1 ) != parameters ) )
+    {
+        printf( "TestStreamingRead - forward bind test failed\n" );
+        testOk = false;
+    }
+    
+    if( ( Fieldml_GetDataSource( session, parameters ) != Fieldml_GetObjectByName( session, "test.source" ) ) ||
+        ( Fieldml_GetIndexEvaluatorCount( session, parameters ) != 1 ) )
+    {
+        printf( "TestStreamingRead - forward data test failed\n" );
+        testOk = false;
+    }
+    
+    double readValues[3] = { 0, 0, 0 };
+    FmlReaderHandle reader = Fieldml_OpenReader( session, Fieldml_GetDataSource( session, parameters ) );
+    Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    Fieldml_CloseReader( reader );
+    for( int i = 0; i < 3; i++ )
+    {
+        if( readValues[i] != values[i] )
+        {
+            printf( "TestStreamingRead - inline data test failed: %d %g != %g\n", i, readValues[i], values[i] );
+            testOk = false;
+        }
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestStreamingRead - ok\n" );
+    }
+    else
+    {
+        printf( "TestStreamingRead - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+int testValidation()
+{
+    bool testOk = true;
+    const int modes[] = { FML_PARSE_DEFAULT, FML_PARSE_STREAMING };
+    
+    printf( "Test validation...\n" );
+    
+    //Well-formed, and otherwise readable, but the schema does not allow the extra attribute.
+    FILE *file = fopen( "output/invalid.xml", "w" );
+    fprintf( file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n" );
+    fprintf( file, "<Fieldml version=\"0.5.0\" xsi:noNamespaceSchemaLocation=\"http://www.fieldml.org/resources/xml/0.5/FieldML_0.5.xsd\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n" );
+    fprintf( file, " <Region name=\"test\">\n" );
+    fprintf( file, "  <BooleanType name=\"test.boolean\" colour=\"red\"/>\n" );
+    fprintf( file, " </Region>\n" );
+    fprintf( file, "</Fieldml>\n" );
+    fclose( file );
+    
+    for( int i = 0; i < 2; i++ )
+    {
+        FmlSessionHandle session = Fieldml_CreateFromFileWithOptions( "output/invalid.xml", modes[i] );
+        if( Fieldml_GetErrorCount( session ) == 0 )
+        {
+            printf( "TestValidation - invalid document accepted with options %d\n", modes[i] );
+            testOk = false;
+        }
+        //Streaming creates objects before the document is known to be invalid, but none of them may be left behind.
+        if( Fieldml_GetTotalObjectCount( session ) != 0 )
+        {
+            printf( "TestValidation - objects left from an invalid document with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+        
+        session = Fieldml_CreateFromFileWithOptions( "output/invalid.xml", modes[i] | FML_PARSE_TRUSTED );
+        if( ( Fieldml_GetErrorCount( session ) != 0 ) || ( Fieldml_GetObjectByName( session, "test.boolean" ) == FML_INVALID_HANDLE ) )
+        {
+            printf( "TestValidation - trusted document rejected with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+    }
+    
+    //Valid against the schema, but the mesh's shapes evaluator is never defined.
+    file = fopen( "output/unresolved.xml", "w" );
+    fprintf( file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n" );
+    fprintf( file, "<Fieldml version=\"0.5.0\" xsi:noNamespaceSchemaLocation=\"http://www.fieldml.org/resources/xml/0.5/FieldML_0.5.xsd\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n" );
+    fprintf( file, " <Region name=\"test\">\n" );
+    fprintf( file, "  <MeshType name=\"test.mesh\">\n" );
+    fprintf( file, "   <Elements name=\"elements\">\n" );
+    fprintf( file, "    <Members>\n" );
+    fprintf( file, "     <MemberRange min=\"1\" max=\"2\"/>\n" );
+    fprintf( file, "    </Members>\n" );
+    fprintf( file, "   </Elements>\n" );
+    fprintf( file, "   <Chart name=\"chart\">\n" );
+    fprintf( file, "    <Components name=\"test.mesh.chart.component\" count=\"1\"/>\n" );
+    fprintf( file, "   </Chart>\n" );
+    fprintf( file, "   <Shapes evaluator=\"test.shapes\"/>\n" );
+    fprintf( file, "  </MeshType>\n" );
+    fprintf( file, " </Region>\n" );
+    fprintf( file, "</Fieldml>\n" );
+    fclose( file );
+    
+    for( int i = 0; i < 2; i++ )
+    {
+        FmlSessionHandle session = Fieldml_CreateFromFileWithOptions( "output/unresolved.xml", modes[i] );
+        if( ( Fieldml_GetLastError( session ) != FML_ERR_READ_ERR ) || ( Fieldml_GetErrorCount( session ) == 0 ) ||
+            ( Fieldml_GetTotalObjectCount( session ) != 0 ) )
+        {
+            printf( "TestValidation - unresolved document accepted with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+    }
+    
+    //The schema is compiled once, so a valid document must still pass after an invalid one.
+    FmlSessionHandle session = Fieldml_CreateFromFile( "output/streaming.xml" );
+    if( Fieldml_GetErrorCount( session ) != 0 )
+    {
+        printf( "TestValidation - valid document rejected\n" );
+        testOk = false;
+    }
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestValidation - ok\n" );
+    }
+    else
+    {
+        printf( "TestValidation - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+int testLibraryImport()
+{
+    bool testOk = true;
+    int objectCounts[2];
+    
+    printf( "Test library import...\n" );
+    
+    //The second session has an object of its own, so the library's handles are different.
+    for( int i = 0; i < 2; i++ )
+    {
+        FmlSessionHandle session = Fieldml_Create( "", "test" );
+        if( i == 1 )
+        {
+            Fieldml_CreateBooleanType( session, "test.boolean" );
+        }
+        
+        int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+        FmlObjectHandle real1d = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+        FmlObjectHandle real3d = Fieldml_AddImport( session, importHandle, "real.3d", "real.3d" );
+        FmlObjectHandle component = Fieldml_AddImport( session, importHandle, "real.3d.component", "real.3d.component" );
+        FmlObjectHandle chartArgument = Fieldml_AddImport( session, importHandle, "chart.1d.argument", "chart.1d.argument" );
+        FmlObjectHandle parametersArgument = Fieldml_AddImport( session, importHandle, "parameters.argument", "parameters.1d.unit.linearLagrange.argument" );
+        FmlObjectHandle interpolator = Fieldml_AddImport( session, importHandle, "linearLagrange", "interpolator.1d.unit.linearLagrange" );
+        if( ( interpolator == FML_INVALID_HANDLE ) || ( Fieldml_GetErrorCount( session ) != 0 ) )
+        {
+            printf( "TestLibraryImport - import test failed in session %d\n", i + 1 );
+            testOk = false;
+        }
+        
+        if( ( Fieldml_GetTypeComponentEnsemble( session, real3d ) != component ) || ( Fieldml_GetTypeComponentCount( session, real3d ) != 3 ) )
+        {
+            printf( "TestLibraryImport - type test failed in session %d\n", i + 1 );
+            testOk = false;
+        }
+        
+        if( ( Fieldml_GetValueType( session, interpolator ) != real1d ) ||
+            ( Fieldml_GetArgumentCount( session, interpolator, 0, 1 ) != 2 ) ||
+            ( Fieldml_GetArgument( session, interpolator, 1, 0, 1 ) != chartArgument ) ||
+            ( Fieldml_GetArgument( session, interpolator, 2, 0, 1 ) != parametersArgument ) )
+        {
+            printf( "TestLibraryImport - evaluator test failed in session %d\n", i + 1 );
+            testOk = false;
+        }
+        
+        //Only the session's own objects are local, but imported objects can still be used locally.
+        if( ( Fieldml_GetLocalObjectCount( session ) != i ) ||
+            ( ( i == 1 ) && ( Fieldml_GetLocalObjectByIndex( session, 1 ) != Fieldml_GetObjectByName( session, "test.boolean" ) ) ) ||
+            ( Fieldml_IsObjectLocal( session, real3d, 1 ) != 0 ) || ( Fieldml_IsObjectLocal( session, real3d, 0 ) != 1 ) ||
+            ( Fieldml_IsObjectLocal( session, Fieldml_GetObjectByName( session, "real.2d" ), 0 ) != 0 ) )
+        {
+            printf( "TestLibraryImport - locality test failed in session %d\n", i + 1 );
+            testOk = false;
+        }
+        
+        objectCounts[i] = Fieldml_GetTotalObjectCount( session );
+        Fieldml_Destroy( session );
+    }
+    
+    if( objectCounts[1] != objectCounts[0] + 1 )
+    {
+        printf( "TestLibraryImport - object count test failed: %d %d\n", objectCounts[0], objectCounts[1] );
+        testOk = false;
+    }
+    
+    //The shared copy of the library is not a visible session, so destroying every other handle leaves it intact.
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    for( FmlSessionHandle otherSession = 0; otherSession < session; otherSession++ )
+    {
+        if( Fieldml_GetLastError( otherSession ) != FML_ERR_UNKNOWN_HANDLE )
+        {
+            printf( "TestLibraryImport - hidden session test failed: %d is visible\n", otherSession );
+            testOk = false;
+        }
+        Fieldml_Destroy( otherSession );
+    }
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    if( ( Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" ) == FML_INVALID_HANDLE ) || ( Fieldml_GetTotalObjectCount( session ) != objectCounts[0] ) )
+    {
+        printf( "TestLibraryImport - import after destroy test failed\n" );
+        testOk = false;
+    }
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestLibraryImport - ok\n" );
+    }
+    else
+    {
+        printf( "TestLibraryImport - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+static void writeImportingDocument( const char *filename, const char *region, const char *import1, const char *import2 )
+{
+    FILE *file = fopen( filename, "w" );
+    fprintf( file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n" );
+    fprintf( file, "<Fieldml version=\"0.5.0\" xsi:noNamespaceSchemaLocation=\"http://www.fieldml.org/resources/xml/0.5/FieldML_0.5.xsd\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xmlns:xlink=\"http://www.w3.org/1999/xlink\">\n" );
+    fprintf( file, " <Region name=\"%s\">\n", region );
+    const char *imports[] = { import1, import2 };
+    for( int i = 0; i < 2; i++ )
+    {
+        if( imports[i] != NULL )
+        {
+            fprintf( file, "  <Import xlink:href=\"%s.xml\" region=\"%s\">\n", imports[i], imports[i] );
+            fprintf( file, "   <ImportType localName=\"%s.real\" remoteName=\"%s.real\"/>\n", imports[i], imports[i] );
+            fprintf( file, "  </Import>\n" );
+        }
+    }
+    fprintf( file, "  <ContinuousType name=\"%s.real\"/>\n", region );
+    fprintf( file, " </Region>\n" );
+    fprintf( file, "</Fieldml>\n" );
+    fclose( file );
+}
+
+
+int testImportCache()
+{
+    bool testOk = true;
+    
+    printf( "Test import cache...\n" );
+    
+    //A diamond: top imports left and right, which both import common. Imports are relative to the importing file.
+    writeImportingDocument( "output/common.xml", "common", NULL, NULL );
+    writeImportingDocument( "output/left.xml", "left", "common", NULL );
+    writeImportingDocument( "output/right.xml", "right", "common", NULL );
+    writeImportingDocument( "output/top.xml", "top", "left", "right" );
+    
+    FmlSessionHandle session = Fieldml_CreateFromFile( "output/top.xml" );
+    if( Fieldml_GetErrorCount( session ) != 0 )
+    {
+        printf( "TestImportCache - parse test failed\n" );
+        testOk = false;
+    }
+    
+    //One type from each of the four documents. Without the cache, common.real would be read twice.
+    if( Fieldml_GetTotalObjectCount( session ) != 4 )
+    {
+        printf( "TestImportCache - object count test failed: %d\n", Fieldml_GetTotalObjectCount( session ) );
+        testOk = false;
+    }
+    
+    //Importing an unchanged document again uses the region already read.
+    int commonSource = Fieldml_AddImportSource( session, "common.xml", "common" );
+    FmlObjectHandle oldReal = Fieldml_GetObjectByDeclaredName( session, "common.real" );
+    if( ( commonSource <= 0 ) || ( Fieldml_GetTotalObjectCount( session ) != 4 ) )
+    {
+        printf( "TestImportCache - unchanged import test failed\n" );
+        testOk = false;
+    }
+    
+    //Rewritten within the same second, so only the size shows the change. The new reading replaces the old one.
+    FILE *file = fopen( "output/common.xml", "w" );
+    fprintf( file, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n" );
+    fprintf( file, "<Fieldml version=\"0.5.0\" xsi:noNamespaceSchemaLocation=\"http://www.fieldml.org/resources/xml/0.5/FieldML_0.5.xsd\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n" );
+    fprintf( file, " <Region name=\"common\">\n" );
+    fprintf( file, "  <ContinuousType name=\"common.real\"/>\n" );
+    fprintf( file, "  <BooleanType name=\"common.boolean\"/>\n" );
+    fprintf( file, " </Region>\n" );
+    fprintf( file, "</Fieldml>\n" );
+    fclose( file );
+    
+    int changedSource = Fieldml_AddImportSource( session, "common.xml", "common" );
+    FmlObjectHandle newReal = Fieldml_AddImport( session, changedSource, "fresh.real", "common.real" );
+    if( ( changedSource != commonSource ) || ( Fieldml_AddImport( session, changedSource, "common.boolean", "common.boolean" ) == FML_INVALID_HANDLE ) )
+    {
+        printf( "TestImportCache - changed import test failed\n" );
+        testOk = false;
+    }
+    
+    //The old objects stay valid for the documents that imported them, but declared names find the new ones.
+    if( ( newReal == FML_INVALID_HANDLE ) || ( newReal == oldReal ) ||
+        ( Fieldml_GetObjectByDeclaredName( session, "common.real" ) != newReal ) ||
+        ( Fieldml_GetObjectType( session, oldReal ) != FHT_CONTINUOUS_TYPE ) )
+    {
+        printf( "TestImportCache - replaced region test failed\n" );
+        testOk = false;
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestImportCache - ok\n" );
+    }
+    else
+    {
+        printf( "TestImportCache - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+static int appendToString( void *context, const char *buffer, int length )
+{
+    ((std::string*)context)->append( buffer, length );
+    return length;
+}
+
+
+int testWriteToBuffer()
+{
+    bool testOk = true;
+    
+    printf( "Test write to buffer...\n" );
+    
+    FmlSessionHandle session = Fieldml_Create( "", "test" );
+    int importHandle = Fieldml_AddImportSource( session, "http://www.fieldml.org/resources/xml/0.5/FieldML_Library_0.5.xml", "library" );
+    FmlObjectHandle realType = Fieldml_AddImport( session, importHandle, "real.1d", "real.1d" );
+    FmlObjectHandle argument = Fieldml_CreateArgumentEvaluator( session, "test.argument", realType );
+    FmlObjectHandle external = Fieldml_CreateExternalEvaluator( session, "test.external", realType );
+    Fieldml_AddArgument( session, external, argument );
+    FmlObjectHandle continuousType = Fieldml_CreateContinuousType( session, "test.continuous" );
+    Fieldml_CreateContinuousTypeComponents( session, continuousType, "test.continuous.component", 3 );
+    
+    Fieldml_WriteFile( session, "output/buffer.xml" );
+    std::string fileContents;
+    FILE *file = fopen( "output/buffer.xml", "rb" );
+    char readBuffer[1024];
+    for( size_t length; ( length = fread( readBuffer, 1, sizeof( readBuffer ), file ) ) > 0; )
+    {
+        fileContents.append( readBuffer, length );
+    }
+    fclose( file );
+    
+    //A buffer that is too small gives the length needed.
+    int length = Fieldml_WriteToBuffer( session, NULL, 0, FML_WRITE_DEFAULT );
+    std::vector<char> buffer( length );
+    if( ( length != (int)fileContents.length() ) ||
+        ( Fieldml_WriteToBuffer( session, &buffer[0], length, FML_WRITE_DEFAULT ) != length ) ||
+        ( std::string( &buffer[0], length ) != fileContents ) )
+    {
+        printf( "TestWriteToBuffer - buffer test failed: %d != %d\n", length, (int)fileContents.length() );
+        testOk = false;
+    }
+    
+    std::string callbackContents;
+    if( ( Fieldml_WriteToCallback( session, appendToString, &callbackContents, FML_WRITE_DEFAULT ) != FML_ERR_NO_ERROR ) ||
+        ( callbackContents != fileContents ) )
+    {
+        printf( "TestWriteToBuffer - callback test failed\n" );
+        testOk = false;
+    }
+    
+    int objectCount = Fieldml_GetTotalObjectCount( session );
+    Fieldml_WriteFileWithOptions( session, "output/unindented.xml", FML_WRITE_NO_INDENT );
+    if( Fieldml_WriteToBuffer( session, NULL, 0, FML_WRITE_NO_INDENT ) >= length )
+    {
+        printf( "TestWriteToBuffer - no indent test failed\n" );
+        testOk = false;
+    }
+    Fieldml_Destroy( session );
+    
+    session = Fieldml_CreateFromFile( "output/unindented.xml" );
+    if( ( Fieldml_GetErrorCount( session ) != 0 ) || ( Fieldml_GetTotalObjectCount( session ) != objectCount ) )
+    {
+        printf( "TestWriteToBuffer - no indent read test failed\n" );
+        testOk = false;
+    }
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestWriteToBuffer - ok\n" );
+    }
+    else
+    {
+        printf( "TestWriteToBuffer - failed\n" );
+    }
+    
+    return 0;
+}
+
+
+struct ChunkReadState
+{
+    const std::vector<char> *document;
+    
+    size_t position;
+};
+
+
+//Hands out the document a few bytes at a time, as a slow network connection might.
+static int readChunk( void *context, char *buffer, int length )
+{
+    ChunkReadState *state = (ChunkReadState*)context;
+    size_t count = state->document->size() - state->position;
+    if( count > 7 )
+    {
+        count = 7;
+    }
+    if( count > (size_t)length )
+    {
+        count = length;
+    }
+    
+    memcpy( buffer, &(*state->document)[state->position], count );
+    state->position += count;
+    
+    return (int)count;
+}
+
+
+int testReadFromBuffer()
+{
+    bool testOk = true;
+    const int modes[] = { FML_PARSE_DEFAULT, FML_PARSE_STREAMING };
+    
+    printf( "Test read from buffer...\n" );
+    
+    FmlSessionHandle session = Fieldml_CreateFromFile( "output/buffer.xml" );
+    int objectCount = Fieldml_GetTotalObjectCount( session );
+    Fieldml_Destroy( session );
+    
+    //Not null-terminated.
+    std::vector<char> document;
+    FILE *file = fopen( "output/buffer.xml", "rb" );
+    for( int c; ( c = fgetc( file ) ) != EOF; )
+    {
+        document.push_back( (char)c );
+    }
+    fclose( file );
+    
+    for( int i = 0; i < 2; i++ )
+    {
+        session = Fieldml_CreateFromBuffer( &document[0], document.size(), "output/buffer.xml", modes[i] );
+        if( ( Fieldml_GetErrorCount( session ) != 0 ) || ( Fieldml_GetTotalObjectCount( session ) != objectCount ) )
+        {
+            printf( "TestReadFromBuffer - buffer test failed with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+        
+        ChunkReadState state;
+        state.document = &document;
+        state.position = 0;
+        session = Fieldml_CreateFromCallback( readChunk, &state, NULL, modes[i] );
+        if( ( Fieldml_GetErrorCount( session ) != 0 ) || ( Fieldml_GetTotalObjectCount( session ) != objectCount ) )
+        {
+            printf( "TestReadFromBuffer - callback test failed with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+        
+        session = Fieldml_CreateFromBuffer( &document[0], document.size() / 2, NULL, modes[i] );
+        if( Fieldml_GetErrorCount( session ) == 0 )
+        {
+            printf( "TestReadFromBuffer - truncated buffer accepted with options %d\n", modes[i] );
+            testOk = false;
+        }
+        Fieldml_Destroy( session );
+    }
+    
+    if( testOk ) 
+    {
+        printf( "TestReadFromBuffer - ok\n" );
+    }
+    else
+    {
+        printf( "TestReadFromBuffer - failed\n" );
+    }
+    
+    return 0;
+}
+
+
 int testHdf5Read()
 {
     bool testOk = true;
@@ -741,6 +1479,103 @@ int testHdf5Write()
 }
 
 
+int testHdf5ExtensibleWrite()
+{
+    bool testOk = true;
+    
+    printf("Testing HDF5 extensible array write\n");
+    
+#ifndef FIELDML_HDF5_ARRAY
+    printf( "TestHdf5ExtensibleWrite - skipped, no HDF5 support\n" );
+    return 0;
+#endif //FIELDML_HDF5_ARRAY
+
+    FmlSessionHandle session = Fieldml_Create( "test", "test" );
+    
+    FmlObjectHandle cType = Fieldml_CreateContinuousType( session, "test.scalar_real" );
+    
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", "./output/test_extensible.h5" );
+    FmlObjectHandle sourceD = Fieldml_CreateArrayDataSource( session, "test.source_double", resource, "steps", 2 );
+    
+    double dataD[30];
+    for( int i = 0; i < 30; i++ )
+    {
+        dataD[i] = ( 10 * i ) + ( 0.001 * i );
+    }
+    
+    int offsets[2] = { 0, 0 };
+    int sizes[2] = { 2, 5 };
+    int chunkSizes[2] = { 1, 5 };
+    int maxSizes[2] = { FML_ARRAY_UNLIMITED_SIZE, 5 };
+
+    //Write two steps, then re-open with room for a third and append it.
+    FmlObjectHandle writer = Fieldml_OpenArrayWriterEx( session, sourceD, cType, 0, sizes, 2, chunkSizes, maxSizes, 6, 1 );
+    if( writer == FML_INVALID_HANDLE )
+    {
+        testOk = false;
+    }
+    else
+    {
+        testOk = testOk && ( Fieldml_WriteDoubleSlab( writer, offsets, sizes, dataD ) == FML_IOERR_NO_ERROR );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    offsets[0] = 2;
+    sizes[0] = 3;
+    writer = Fieldml_OpenArrayWriter( session, sourceD, cType, 1, sizes, 2 );
+    if( writer == FML_INVALID_HANDLE )
+    {
+        testOk = false;
+    }
+    else
+    {
+        sizes[0] = 1;
+        testOk = testOk && ( Fieldml_WriteDoubleSlab( writer, offsets, sizes, dataD + 10 ) == FML_IOERR_NO_ERROR );
+        
+        //The array is not extended by writes past its end.
+        offsets[0] = 3;
+        testOk = testOk && ( Fieldml_WriteDoubleSlab( writer, offsets, sizes, dataD + 15 ) == FML_IOERR_WRITE_ERROR );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    double readD[15];
+    offsets[0] = 0;
+    sizes[0] = 3;
+    FmlReaderHandle reader = Fieldml_OpenReader( session, sourceD );
+    if( reader == FML_INVALID_HANDLE )
+    {
+        testOk = false;
+    }
+    else
+    {
+        testOk = testOk && ( Fieldml_ReadDoubleSlab( reader, offsets, sizes, readD ) == FML_IOERR_NO_ERROR );
+        Fieldml_CloseReader( reader );
+        
+        for( int i = 0; testOk && ( i < 15 ); i++ )
+        {
+            if( readD[i] != dataD[i] )
+            {
+                printf( "Data mismatch in test_extensible.h5 at %d. Expecting %g, got %g\n", i, dataD[i], readD[i] );
+                testOk = false;
+            }
+        }
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( testOk ) 
+    {
+        printf( "TestHdf5ExtensibleWrite - ok\n" );
+    }
+    else
+    {
+        printf( "TestHdf5ExtensibleWrite - failed\n" );
+    }
+    
+    return 0;
+}
+
+
 int main( int argc, char **argv )
 {
     if( argc > 1 )
@@ -752,9 +1587,27 @@ int main( int argc, char **argv )
     
     testCycles();
     
+    testEvaluatorRanges();
+    
+    testArguments();
+    
+    testStreamingRead();
+    
+    testValidation();
+    
+    testLibraryImport();
+    
+    testImportCache();
+    
+    testWriteToBuffer();
+    
+    testReadFromBuffer();
+    
     testHdf5Read();
     
     testHdf5Write();
     
+    testHdf5ExtensibleWrite();
+    
     return 0;
 }